@@ -0,0 +1,675 @@
+#include <algorithm> // equal
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <utility> // move
+#include <vector>
+
+#include <boost/asio/write.hpp>
+
+#include <unistd.h> // getpid
+
+#include "lms1xx/codec.hh"
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/hex.hh"
+#include "lms1xx/lms1xx.hh"
+#include "lms1xx/parser.hh"
+#include "lms1xx/pipeline.hh"
+#include "lms1xx/player.hh"
+#include "lms1xx/scan_publisher.hh"
+#include "lms1xx/scan_view.hh"
+#include "lms1xx/sector_reduction.hh"
+
+#include "bench/corpus.hh"
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Count every allocation made by the process.
+// Replacement functions are not inlined to avoid false positives of -Wmismatched-new-delete.
+static std::atomic<unsigned long> allocations{0};
+
+__attribute__((noinline))
+void*
+operator new(std::size_t sz)
+{
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto ptr = std::malloc(sz == 0 ? 1 : sz))
+  {
+    return ptr;
+  }
+  throw std::bad_alloc{};
+}
+
+__attribute__((noinline))
+void
+operator delete(void* ptr)
+noexcept
+{
+  std::free(ptr);
+}
+
+__attribute__((noinline))
+void
+operator delete(void* ptr, std::size_t)
+noexcept
+{
+  std::free(ptr);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+using clock_type = std::chrono::steady_clock;
+
+/*------------------------------------------------------------------------------------------------*/
+
+using corpus::telegram;
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct result
+{
+  unsigned long scans;
+  unsigned long samples;
+  unsigned long allocations;
+
+  /// @brief Telegrams found invalid, or scans lost by the measured path
+  unsigned long errors;
+
+  /// @brief 1 if the last decoded scan differs from the one of parse_scan_data()
+  unsigned long mismatches;
+
+  double seconds;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+unsigned long
+nb_samples(const lms1xx::scan_data& data)
+{
+  return data.dist_len1 + data.dist_len2 + data.rssi_len1 + data.rssi_len2;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+unsigned long
+nb_samples(const lms1xx::compact_scan& data)
+{
+  return data.get(lms1xx::channel::dist1).size + data.get(lms1xx::channel::dist2).size
+       + data.get(lms1xx::channel::rssi1).size + data.get(lms1xx::channel::rssi2).size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+report(const std::string& bench, const std::string& name, const result& res)
+{
+  const auto scans = static_cast<double>(res.scans == 0 ? 1 : res.scans);
+  const auto samples = static_cast<double>(res.samples == 0 ? 1 : res.samples);
+  std::cout << std::left << std::setw(8) << bench
+            << std::setw(32) << name
+            << std::right << std::fixed
+            << std::setw(12) << std::setprecision(0) << (res.scans / res.seconds) << " scans/s"
+            << std::setw(10) << std::setprecision(2) << (res.seconds * 1e9 / samples)
+            << " ns/sample"
+            << std::setw(8) << std::setprecision(2) << (res.allocations / scans) << " allocs/scan"
+            << std::setw(8) << res.errors << " errors"
+            << std::setw(4) << res.mismatches << " mismatches"
+            << '\n';
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure a decoding repeated for a duration
+/// @param decode Decode a scan and return its number of samples
+template <typename Decode>
+result
+run_bench(std::chrono::milliseconds duration, Decode&& decode)
+{
+  auto res = result{};
+
+  const auto allocs = allocations.load();
+  const auto start = clock_type::now();
+  const auto stop = start + duration;
+  do
+  {
+    for (auto i = 0; i < 64; ++i)
+    {
+      res.samples += decode();
+    }
+    res.scans += 64;
+  }
+  while (clock_type::now() < stop);
+
+  res.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+  res.allocations = allocations.load() - allocs;
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell if a channel has other samples than the ones of a scan_data
+bool
+differs(const lms1xx::scan_data& expected, lms1xx::channel c, const lms1xx::channel_span& samples)
+{
+  const auto len = c == lms1xx::channel::dist1 ? expected.dist_len1
+                 : c == lms1xx::channel::dist2 ? expected.dist_len2
+                 : c == lms1xx::channel::rssi1 ? expected.rssi_len1
+                 :                               expected.rssi_len2;
+  const auto first = c == lms1xx::channel::dist1 ? expected.dist1
+                   : c == lms1xx::channel::dist2 ? expected.dist2
+                   : c == lms1xx::channel::rssi1 ? expected.rssi1
+                   :                               expected.rssi2;
+  return    samples.size != static_cast<std::size_t>(len)
+         or not std::equal(first, first + len, samples.data);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Compare a decoded scan with the one given by parse_scan_data()
+/// @return 1 if a channel has other samples, 0 otherwise
+unsigned long
+mismatches(const telegram& t, const lms1xx::compact_scan& data)
+{
+  auto expected = lms1xx::scan_data{};
+  lms1xx::parse_scan_data(t.bytes.data(), t.bytes.data() + t.bytes.size(), expected);
+  for (const auto c : { lms1xx::channel::dist1, lms1xx::channel::dist2, lms1xx::channel::rssi1
+                      , lms1xx::channel::rssi2})
+  {
+    if (differs(expected, c, data.get(c)))
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the decoding of a telegram, as done by get_data()
+result
+bench_parse(const telegram& t, std::chrono::milliseconds duration)
+{
+  const auto first = t.bytes.data();
+  const auto last = first + t.bytes.size();
+  auto data = lms1xx::scan_data{};
+
+  return run_bench(duration, [&]
+  {
+    lms1xx::parse_scan_data(first, last, data);
+    return nb_samples(data);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the decoding of a telegram into a reused compact_scan
+result
+bench_parse_compact(const telegram& t, std::chrono::milliseconds duration)
+{
+  const auto first = t.bytes.data();
+  const auto last = first + t.bytes.size();
+  auto data = lms1xx::compact_scan{lms1xx::max_samples};
+
+  auto res = run_bench(duration, [&]
+  {
+    lms1xx::parse_scan_data(first, last, data);
+    return nb_samples(data);
+  });
+  res.mismatches = mismatches(t, data);
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the decoding of a CoLa-B telegram by the generic parser
+result
+bench_binary(const telegram& t, std::chrono::milliseconds duration)
+{
+  const auto first = t.binary.data();
+  const auto last = first + t.binary.size();
+  auto data = lms1xx::compact_scan{lms1xx::max_samples};
+
+  auto res = run_bench(duration, [&]
+  {
+    lms1xx::parse_scan_data(first, last, data);
+    return nb_samples(data);
+  });
+  res.mismatches = mismatches(t, data);
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the decoding of a CoLa-B telegram by the routine specialized for its layout
+result
+bench_layout(const telegram& t, std::chrono::milliseconds duration)
+{
+  const auto first = t.binary.data();
+  const auto last = first + t.binary.size();
+  const auto parser = lms1xx::layout_parser{t.configuration, lms1xx::protocol::cola_b};
+  auto data = lms1xx::compact_scan{lms1xx::max_samples};
+
+  auto res = run_bench(duration, [&]
+  {
+    parser.parse(first, last, data);
+    return nb_samples(data);
+  });
+  res.mismatches = mismatches(t, data);
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the decoding of a 90 degree sector, one sample out of two, of DIST1 only
+result
+bench_filter(const telegram& t, std::chrono::milliseconds duration)
+{
+  const auto first = t.bytes.data();
+  const auto last = first + t.bytes.size();
+  const auto filter
+    = lms1xx::scan_filter{0, 900000, 2, lms1xx::channel_bit(lms1xx::channel::dist1)};
+  auto data = lms1xx::compact_scan{lms1xx::max_samples};
+
+  return run_bench(duration, [&]
+  {
+    lms1xx::parse_scan_data(first, last, data, {&filter, nullptr});
+    return nb_samples(data);
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the decoding of a telegram while DIST1 is reduced to 8 sectors of 30 degrees
+result
+bench_sectors(const telegram& t, std::chrono::milliseconds duration)
+{
+  const auto first = t.bytes.data();
+  const auto last = first + t.bytes.size();
+  auto sectors = std::vector<lms1xx::sector>{};
+  for (auto angle = -450000; angle < 1950000; angle += 300000)
+  {
+    sectors.push_back({angle, angle + 299999});
+  }
+  lms1xx::sector_reduction reduction{ std::move(sectors)
+                                    , [](const lms1xx::scan_header&, const lms1xx::sector_minimum&)
+                                      {}};
+  auto data = lms1xx::compact_scan{lms1xx::max_samples};
+
+  auto res = run_bench(duration, [&]
+  {
+    lms1xx::parse_scan_data(first, last, data, {nullptr, &reduction});
+    return nb_samples(data);
+  });
+  res.mismatches = mismatches(t, data);
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the decoding of DIST1 only, through a scan_view
+result
+bench_view(const telegram& t, std::chrono::milliseconds duration)
+{
+  const auto first = t.bytes.data();
+  const auto last = first + t.bytes.size();
+  auto view = lms1xx::scan_view{};
+
+  auto res = run_bench(duration, [&]
+  {
+    view.reset(first, last);
+    return view.get(lms1xx::channel::dist1).size;
+  });
+  auto expected = lms1xx::scan_data{};
+  lms1xx::parse_scan_data(first, last, expected);
+  res.mismatches
+    = differs(expected, lms1xx::channel::dist1, view.get(lms1xx::channel::dist1)) ? 1 : 0;
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the decoding of a scan compressed with codec::encode_scan()
+result
+bench_codec(const telegram& t, std::chrono::milliseconds duration)
+{
+  auto data = lms1xx::compact_scan{lms1xx::max_samples};
+  lms1xx::parse_scan_data(t.bytes.data(), t.bytes.data() + t.bytes.size(), data);
+  auto encoded = std::string{};
+  lms1xx::codec::encode_scan(data, encoded);
+  const auto first = encoded.data();
+  const auto last = first + encoded.size();
+
+  auto res = run_bench(duration, [&]
+  {
+    lms1xx::codec::decode_scan(first, last, data);
+    return nb_samples(data);
+  });
+  res.mismatches = mismatches(t, data);
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the non-throwing get_data(), fed by a server streaming a telegram on the loopback
+/// interface
+result
+bench_read(const telegram& t, std::chrono::milliseconds duration)
+{
+  using boost::asio::ip::tcp;
+
+  boost::asio::io_service io;
+  tcp::acceptor acceptor{io, tcp::endpoint{boost::asio::ip::address_v4::loopback(), 0}};
+  const auto port = std::to_string(acceptor.local_endpoint().port());
+
+  // Send telegrams by batches to keep the socket full.
+  auto batch = std::string{};
+  while (batch.size() < 65536)
+  {
+    batch += t.bytes;
+  }
+
+  std::thread server{[&]
+  {
+    tcp::socket socket{io};
+    acceptor.accept(socket);
+    auto ec = boost::system::error_code{};
+    while (not ec)
+    {
+      boost::asio::write(socket, boost::asio::buffer(batch), ec);
+    }
+  }};
+
+  auto res = result{};
+  {
+    lms1xx::LMS1xx laser{"127.0.0.1", port, boost::posix_time::seconds{5}};
+    auto data = lms1xx::scan_data{};
+
+    const auto allocs = allocations.load();
+    const auto start = clock_type::now();
+    const auto stop = start + duration;
+    do
+    {
+      auto ec = std::error_code{};
+      laser.get_data(data, ec);
+      if (ec == lms1xx::errc::invalid_telegram)
+      {
+        ++res.errors;
+        continue;
+      }
+      if (ec)
+      {
+        throw std::system_error{ec};
+      }
+      res.samples += nb_samples(data);
+      ++res.scans;
+    }
+    while (clock_type::now() < stop);
+
+    res.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+    res.allocations = allocations.load() - allocs;
+  }
+
+  server.join();
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure a pipeline decoding the telegrams of 4 devices on all cores, each device fed by
+/// a server streaming a telegram on the loopback interface
+///
+/// Servers send telegrams faster than they are decoded: most of them are dropped, the number of
+/// scans is the throughput of parsers.
+result
+bench_pipeline(const telegram& t, std::chrono::milliseconds duration)
+{
+  using boost::asio::ip::tcp;
+
+  const auto nb_devices = 4;
+  boost::asio::io_service io;
+  auto acceptors = std::vector<std::unique_ptr<tcp::acceptor>>{};
+  for (auto i = 0; i < nb_devices; ++i)
+  {
+    acceptors.emplace_back(
+      new tcp::acceptor{io, tcp::endpoint{boost::asio::ip::address_v4::loopback(), 0}});
+  }
+
+  auto batch = std::string{};
+  while (batch.size() < 65536)
+  {
+    batch += t.bytes;
+  }
+
+  auto servers = std::vector<std::thread>{};
+  for (auto& acceptor : acceptors)
+  {
+    servers.emplace_back([&]
+    {
+      tcp::socket socket{io};
+      acceptor->accept(socket);
+      auto ec = boost::system::error_code{};
+      while (not ec)
+      {
+        boost::asio::write(socket, boost::asio::buffer(batch), ec);
+      }
+    });
+  }
+
+  auto res = result{};
+  {
+    lms1xx::pipeline pipeline;
+    for (const auto& acceptor : acceptors)
+    {
+      pipeline.add("127.0.0.1", std::to_string(acceptor->local_endpoint().port()));
+    }
+    std::atomic<unsigned long> samples{0};
+
+    const auto allocs = allocations.load();
+    const auto start = clock_type::now();
+    pipeline.start([&](std::size_t, const lms1xx::scan_data& data)
+    {
+      samples.fetch_add(nb_samples(data), std::memory_order_relaxed);
+    });
+    std::this_thread::sleep_for(duration);
+    pipeline.stop();
+
+    const auto stats = pipeline.get_statistics();
+    res.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+    res.allocations = allocations.load() - allocs;
+    res.scans = stats.scans;
+    res.samples = samples;
+    res.errors = stats.invalid_telegrams;
+  }
+
+  for (auto& server : servers)
+  {
+    server.join();
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure streaming from a player replaying a telegram as fast as possible
+result
+bench_replay(const telegram& t, std::chrono::milliseconds duration)
+{
+  lms1xx::player replay{std::vector<std::string>{t.bytes}, 0, true};
+  lms1xx::scan_source& source = replay;
+  auto res = result{};
+
+  const auto allocs = allocations.load();
+  const auto start = clock_type::now();
+  const auto stop = start + duration;
+  source.run_stream([&](const lms1xx::scan_data& data)
+  {
+    res.samples += nb_samples(data);
+    // Don't read the clock for each scan.
+    if (++res.scans % 64 == 0 and clock_type::now() >= stop)
+    {
+      source.stop_stream();
+    }
+  });
+
+  res.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+  res.allocations = allocations.load() - allocs;
+  res.errors = source.get_statistics().framing_errors;
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Measure the scans read by a subscriber of a publisher fed by a player replaying a
+/// telegram at a fixed pace
+///
+/// Unpaced, the player would lap the subscriber whenever it gets the CPU, and overruns would only
+/// tell how threads are scheduled. At a pace the host can sustain, they are the scans a subscriber
+/// actually misses.
+result
+bench_shared(const telegram& t, std::chrono::milliseconds duration)
+{
+  // A single looped telegram isn't paced by the player, scans are paced as they are published.
+  static constexpr auto period = std::chrono::microseconds{100};
+
+  lms1xx::player replay{std::vector<std::string>{t.bytes}, 0, true};
+  lms1xx::scan_publisher publisher{"/lms1xx_bench_" + std::to_string(::getpid()), 64};
+  lms1xx::scan_subscriber subscriber{publisher.name()};
+  const auto publish = lms1xx::publish_to(publisher);
+  auto due = clock_type::now();
+  auto handler = lms1xx::scan_handler{[&](const lms1xx::scan_data& data)
+  {
+    publish(data);
+    due += period;
+    std::this_thread::sleep_until(due);
+  }};
+  auto res = result{};
+
+  const auto allocs = allocations.load();
+  const auto start = clock_type::now();
+  const auto stop = start + duration;
+  due = start;
+  replay.start_stream(std::move(handler));
+  while (clock_type::now() < stop)
+  {
+    if (const auto data = subscriber.try_acquire_read())
+    {
+      const auto samples = nb_samples(*data);
+      if (subscriber.release_read())
+      {
+        res.samples += samples;
+        ++res.scans;
+      }
+    }
+    else
+    {
+      std::this_thread::yield();
+    }
+  }
+  replay.stop_stream();
+
+  res.seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+  res.allocations = allocations.load() - allocs;
+  res.errors = subscriber.overruns();
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, char** argv)
+{
+  // Closing the client while the server is writing must not kill the benchmark.
+  std::signal(SIGPIPE, SIG_IGN);
+
+  const auto corpus_dir = std::string{argc > 1 ? argv[1] : LMS1XX_BENCH_CORPUS};
+  const auto duration = std::chrono::milliseconds{argc > 2 ? std::atoi(argv[2]) : 1000};
+
+  std::cout << "hex kernel: " << lms1xx::hex::kernel_name() << '\n';
+  std::cout << "codec kernel: " << lms1xx::codec::kernel_name() << '\n';
+
+  try
+  {
+    const auto telegrams = corpus::load(corpus_dir);
+
+    for (const auto& t : telegrams)
+    {
+      report("parse", t.name, bench_parse(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("compact", t.name, bench_parse_compact(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("binary", t.name, bench_binary(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("layout", t.name, bench_layout(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("filter", t.name, bench_filter(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("sectors", t.name, bench_sectors(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("view", t.name, bench_view(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("codec", t.name, bench_codec(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("read", t.name, bench_read(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("pipe", t.name, bench_pipeline(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("replay", t.name, bench_replay(t, duration));
+    }
+
+    for (const auto& t : telegrams)
+    {
+      report("shm", t.name, bench_shared(t, duration));
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "An error happened: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility> // pair
+#include <vector>
+
+#include "lms1xx/cola.hh"
+#include "lms1xx/lms1xx.hh"
+
+/// @file
+/// Load the telegrams of bench/corpus, for the benchmark and the tests.
+
+namespace corpus {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A telegram of the corpus
+struct telegram
+{
+  /// @brief The name of the file, without extension
+  std::string name;
+
+  /// @brief The telegram, in CoLa-A
+  std::string bytes;
+
+  /// @brief The same telegram in CoLa-B
+  std::string binary;
+
+  /// @brief The configuration which gives the layout of the telegram
+  lms1xx::scan_data_configuration configuration;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+inline
+std::string
+read_file(const std::string& path)
+{
+  std::ifstream file{path, std::ios::binary};
+  if (not file)
+  {
+    throw std::runtime_error{"Can't open " + path};
+  }
+  std::stringstream ss;
+  ss << file.rdbuf();
+  return ss.str();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Encode a CoLa-A LMDscandata telegram in CoLa-B
+/// @throw std::runtime_error if the telegram holds the position, the name or the comment of the
+/// device
+inline
+std::string
+to_cola_b(const std::string& telegram)
+{
+  std::istringstream tokens{telegram.substr(1, telegram.size() - 2)}; // Without STX and ETX
+  auto token = std::string{};
+  tokens >> token >> token; // sSN LMDscandata
+  auto out = lms1xx::cola::writer{lms1xx::protocol::cola_b, "sSN", "LMDscandata"};
+  const auto field = [&](std::size_t size)
+  {
+    tokens >> token;
+    const auto value = static_cast<std::uint32_t>(std::stoul(token, nullptr, 16));
+    out.field(value, size);
+    return value;
+  };
+
+  for (const auto size : {2, 2, 4, 1, 1, 2, 2, 4, 4, 1, 1, 1, 1, 2, 4, 4}) // Header
+  {
+    field(size);
+  }
+  for (auto i = field(2); i > 0; --i) // Encoders
+  {
+    field(4);
+    field(2);
+  }
+  for (const auto sample_size : {2, 1}) // 16-bit, then 8-bit channels
+  {
+    for (auto i = field(2); i > 0; --i)
+    {
+      tokens >> token;
+      out.text(token.c_str(), 5);
+      for (const auto size : {4, 4, 4, 2}) // Scaling, start angle and step
+      {
+        field(size);
+      }
+      for (auto j = field(2); j > 0; --j)
+      {
+        field(sample_size);
+      }
+    }
+  }
+  for (auto i = 0; i < 3; ++i) // Position, name and comment
+  {
+    if (field(2) != 0)
+    {
+      throw std::runtime_error{"Can't encode the position, the name or the comment in CoLa-B"};
+    }
+  }
+  if (field(2) != 0) // Timestamp
+  {
+    for (const auto size : {2, 1, 1, 1, 1, 1, 4})
+    {
+      field(size);
+    }
+  }
+  field(2); // Event info
+  return out.str();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Load the telegrams of the corpus
+/// @param dir The directory of the corpus
+/// @throw std::runtime_error if a telegram can't be read
+inline
+std::vector<telegram>
+load(const std::string& dir)
+{
+  // Configurations are the ones which give the layout of each telegram.
+  const auto layouts
+    = std::vector<std::pair<std::string, lms1xx::scan_data_configuration>>
+      { {"dist1_271",                  {1, false, 0, 0, false, false, false, 1}}
+      , {"dist1_rssi8_541",            {1, true,  0, 0, false, false, false, 1}}
+      , {"dist1_rssi16_541_encoder",   {1, true,  1, 1, false, false, false, 1}}
+      , {"dist12_rssi8_1082",          {3, true,  0, 0, false, false, false, 1}}
+      , {"dist12_rssi16_1082_encoder", {3, true,  1, 1, false, false, false, 1}}};
+
+  auto telegrams = std::vector<telegram>{};
+  for (const auto& layout : layouts)
+  {
+    const auto bytes = read_file(dir + "/" + layout.first + ".tel");
+    telegrams.push_back({layout.first, bytes, to_cola_b(bytes), layout.second});
+  }
+  return telegrams;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace corpus
@@ -0,0 +1,73 @@
+#include "lms1xx/buffer_pool.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+buffer_pool::buffer_pool(std::size_t block_size)
+  : m_block_size{block_size}
+  , m_mutex{}
+  , m_blocks{}
+  , m_free{}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+buffer_pool::block_size()
+const noexcept
+{
+  return m_block_size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+char*
+buffer_pool::acquire()
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  if (m_free.empty())
+  {
+    m_blocks.emplace_back(new char[m_block_size]);
+    // Make sure release() won't have to allocate.
+    m_free.reserve(m_blocks.size());
+    return m_blocks.back().get();
+  }
+  const auto block = m_free.back();
+  m_free.pop_back();
+  return block;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+buffer_pool::release(char* block)
+noexcept
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_free.push_back(block);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+buffer_pool::allocated()
+const
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_blocks.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+buffer_pool::in_use()
+const
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_blocks.size() - m_free.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
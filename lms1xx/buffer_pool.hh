@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A thread-safe pool of fixed-size receive buffers, shared by several devices
+///
+/// Blocks are allocated on demand and kept for later use, they are only freed with the pool.
+class buffer_pool final
+{
+public:
+
+  /// @brief Can't copy-construct a buffer_pool
+  buffer_pool(const buffer_pool&) = delete;
+
+  /// @brief Can't copy a buffer_pool
+  buffer_pool& operator=(const buffer_pool&) = delete;
+
+  /// @brief Constructor
+  /// @param block_size The size of each buffer, large enough for the longest telegram
+  explicit
+  buffer_pool(std::size_t block_size);
+
+  /// @brief The size of each buffer
+  std::size_t
+  block_size()
+  const noexcept;
+
+  /// @brief Get a buffer of block_size() bytes
+  char*
+  acquire();
+
+  /// @brief Give back a buffer obtained with acquire()
+  void
+  release(char* block)
+  noexcept;
+
+  /// @brief Number of buffers allocated by the pool
+  std::size_t
+  allocated()
+  const;
+
+  /// @brief Number of buffers in use
+  std::size_t
+  in_use()
+  const;
+
+private:
+
+  /// @brief The size of each buffer
+  const std::size_t m_block_size;
+
+  /// @brief Protect m_blocks and m_free
+  mutable std::mutex m_mutex;
+
+  /// @brief All allocated buffers
+  std::vector<std::unique_ptr<char[]>> m_blocks;
+
+  /// @brief Buffers not in use
+  std::vector<char*> m_free;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,507 @@
+#include <cstring> // memcpy
+#include <stdexcept>
+
+#include "lms1xx/codec.hh"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define LMS1XX_CODEC_X86 1
+# include <immintrin.h>
+#endif
+
+namespace lms1xx {
+namespace codec {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode full blocks, stop when close to last or at the first malformed block
+/// @param previous The sample preceding the first block, updated with the last decoded one
+/// @return The number of decoded samples
+using kernel_type =
+  std::size_t (*)(const char*&, const char*, std::uint16_t*, std::size_t, std::uint16_t&);
+
+/*------------------------------------------------------------------------------------------------*/
+
+[[noreturn]] void
+malformed()
+{
+  throw std::invalid_argument{"Truncated or malformed encoded samples"};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint16_t
+zigzag(std::uint16_t delta)
+noexcept
+{
+  return static_cast<std::uint16_t>((delta << 1) ^ (delta & 0x8000 ? 0xFFFF : 0));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint16_t
+unzigzag(std::uint16_t value)
+noexcept
+{
+  return static_cast<std::uint16_t>((value >> 1) ^ (value & 1 ? 0xFFFF : 0));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Number of bytes of a block of n samples packed on width bits, without its width byte
+constexpr std::size_t
+packed_size(std::size_t n, unsigned int width)
+noexcept
+{
+  return (n * width + 7) / 8;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode a block of n samples, which may be the last and incomplete one
+/// @return false if the block is truncated or malformed
+bool
+decode_block( const char*& pos, const char* last, std::uint16_t* out, std::size_t n
+            , std::uint16_t& previous)
+noexcept
+{
+  if (pos == last)
+  {
+    return false;
+  }
+  const auto width = static_cast<unsigned int>(static_cast<unsigned char>(*pos));
+  if (width > 16 or static_cast<std::size_t>(last - pos - 1) < packed_size(n, width))
+  {
+    return false;
+  }
+  ++pos;
+
+  const auto mask = (std::uint32_t{1} << width) - 1;
+  auto bits = std::uint32_t{0};
+  auto nb_bits = 0u;
+  for (auto i = std::size_t{0}; i < n; ++i)
+  {
+    while (nb_bits < width)
+    {
+      bits |= static_cast<std::uint32_t>(static_cast<unsigned char>(*pos++)) << nb_bits;
+      nb_bits += 8;
+    }
+    const auto delta = unzigzag(static_cast<std::uint16_t>(bits & mask));
+    previous = static_cast<std::uint16_t>(previous + delta);
+    out[i] = previous;
+    bits >>= width;
+    nb_bits -= width;
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+decode_scalar( const char*& pos, const char* last, std::uint16_t* out, std::size_t n
+             , std::uint16_t& previous)
+noexcept
+{
+  auto decoded = std::size_t{0};
+  while (  n - decoded >= block_size
+         and decode_block(pos, last, out + decoded, block_size, previous))
+  {
+    decoded += block_size;
+  }
+  return decoded;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef LMS1XX_CODEC_X86
+
+/// @brief How to unpack 8 samples packed on each possible width
+struct unpack_table
+{
+  /// @brief Gather in each 32-bit lane the 3 bytes which contain the bits of a sample
+  std::uint8_t shuffle[17][32];
+
+  /// @brief Shift the bits of each sample to the bottom of its lane
+  std::uint32_t shift[17][8];
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+const unpack_table&
+get_unpack_table()
+noexcept
+{
+  static const auto table = []
+  {
+    auto t = unpack_table{};
+    for (auto width = 0u; width <= 16; ++width)
+    {
+      for (auto i = 0u; i < 8; ++i)
+      {
+        const auto bit = i * width;
+        t.shift[width][i] = bit % 8;
+        for (auto k = 0u; k < 4; ++k)
+        {
+          const auto byte = bit / 8 + k;
+          // Bytes beyond the sample are zeroed, thus never read past the 8 samples.
+          t.shuffle[width][i * 4 + k] = k < 3 and byte * 8 < bit + width
+                                      ? static_cast<std::uint8_t>(byte)
+                                      : 0x80;
+        }
+      }
+    }
+    return t;
+  }();
+  return table;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Unpack 8 samples packed on width bits, then undo the zigzag and delta encodings
+__attribute__((target("avx2")))
+__m128i
+decode_avx2_half(const char* pos, unsigned int width, const unpack_table& table, __m128i previous)
+noexcept
+{
+  const auto bytes =
+    _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(pos)));
+  const auto shuffle = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.shuffle[width]));
+  const auto shift = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(table.shift[width]));
+  const auto mask = _mm256_set1_epi32(static_cast<int>((1u << width) - 1));
+  const auto lanes =
+    _mm256_and_si256(_mm256_srlv_epi32(_mm256_shuffle_epi8(bytes, shuffle), shift), mask);
+  auto v = _mm_packus_epi32(_mm256_castsi256_si128(lanes), _mm256_extracti128_si256(lanes, 1));
+
+  // Undo zigzag.
+  v = _mm_xor_si128( _mm_srli_epi16(v, 1)
+                   , _mm_sub_epi16(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi16(1))));
+
+  // Prefix sum, starting from the last sample of the previous half.
+  v = _mm_add_epi16(v, _mm_slli_si128(v, 2));
+  v = _mm_add_epi16(v, _mm_slli_si128(v, 4));
+  v = _mm_add_epi16(v, _mm_slli_si128(v, 8));
+  return _mm_add_epi16(v, _mm_shuffle_epi8(previous, _mm_set1_epi16(0x0F0E)));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+__attribute__((target("avx2")))
+std::size_t
+decode_avx2( const char*& pos, const char* last, std::uint16_t* out, std::size_t n
+           , std::uint16_t& previous)
+noexcept
+{
+  const auto& table = get_unpack_table();
+  auto prev = _mm_set1_epi16(static_cast<short>(previous));
+  auto decoded = std::size_t{0};
+  while (n - decoded >= block_size and last - pos >= 1)
+  {
+    const auto width = static_cast<unsigned int>(static_cast<unsigned char>(*pos));
+    // Each half of the block is loaded with 16 bytes, width bytes are actually used.
+    if (width > 16 or last - pos < 1 + static_cast<std::ptrdiff_t>(width) + 16)
+    {
+      break;
+    }
+    const auto low = decode_avx2_half(pos + 1, width, table, prev);
+    const auto high = decode_avx2_half(pos + 1 + width, width, table, low);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + decoded), low);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + decoded + 8), high);
+    prev = high;
+    pos += 1 + 2 * width;
+    decoded += block_size;
+  }
+  if (decoded != 0)
+  {
+    previous = out[decoded - 1];
+  }
+  return decoded;
+}
+
+#endif // LMS1XX_CODEC_X86
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct kernel
+{
+  kernel_type decode;
+  const char* name;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+const kernel&
+selected_kernel()
+noexcept
+{
+  static const auto k = []
+  {
+#ifdef LMS1XX_CODEC_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+      return kernel{decode_avx2, "avx2"};
+    }
+#endif
+    return kernel{decode_scalar, "scalar"};
+  }();
+  return k;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename T>
+void
+put(std::string& out, T value)
+{
+  out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename T>
+T
+get(const char*& pos, const char* last)
+{
+  if (static_cast<std::size_t>(last - pos) < sizeof(T))
+  {
+    malformed();
+  }
+  auto value = T{};
+  std::memcpy(&value, pos, sizeof(T));
+  pos += sizeof(T);
+  return value;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encode_header(const scan_header& header, std::string& out)
+{
+  put(out, header.version);
+  put(out, header.device_number);
+  put(out, header.serial_number);
+  put(out, header.status);
+  put(out, header.message_counter);
+  put(out, header.scan_counter);
+  put(out, header.power_up_duration);
+  put(out, header.transmission_duration);
+  put(out, header.scanning_frequency);
+  put(out, header.measurement_frequency);
+  put(out, static_cast<std::uint8_t>(header.has_timestamp));
+  put(out, header.timestamp.year);
+  put(out, header.timestamp.month);
+  put(out, header.timestamp.day);
+  put(out, header.timestamp.hour);
+  put(out, header.timestamp.minute);
+  put(out, header.timestamp.second);
+  put(out, header.timestamp.microsecond);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+decode_header(const char*& pos, const char* last, scan_header& header)
+{
+  header.version = get<std::uint16_t>(pos, last);
+  header.device_number = get<std::uint16_t>(pos, last);
+  header.serial_number = get<std::uint32_t>(pos, last);
+  header.status = get<std::uint16_t>(pos, last);
+  header.message_counter = get<std::uint16_t>(pos, last);
+  header.scan_counter = get<std::uint16_t>(pos, last);
+  header.power_up_duration = get<std::uint32_t>(pos, last);
+  header.transmission_duration = get<std::uint32_t>(pos, last);
+  header.scanning_frequency = get<std::uint32_t>(pos, last);
+  header.measurement_frequency = get<std::uint32_t>(pos, last);
+  header.has_timestamp = get<std::uint8_t>(pos, last) != 0;
+  header.timestamp.year = get<std::uint16_t>(pos, last);
+  header.timestamp.month = get<std::uint8_t>(pos, last);
+  header.timestamp.day = get<std::uint8_t>(pos, last);
+  header.timestamp.hour = get<std::uint8_t>(pos, last);
+  header.timestamp.minute = get<std::uint8_t>(pos, last);
+  header.timestamp.second = get<std::uint8_t>(pos, last);
+  header.timestamp.microsecond = get<std::uint32_t>(pos, last);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Append a channel: its number of samples, its number of encoded bytes, then its samples
+void
+encode_channel(channel_span samples, std::string& out)
+{
+  const auto start = out.size();
+  put(out, static_cast<std::uint16_t>(samples.size));
+  put(out, std::uint16_t{0});
+  out.resize(start + 4 + max_encoded_size(samples.size));
+  const auto size = encode(samples.data, samples.size, &out[start + 4]);
+  const auto encoded_size = static_cast<std::uint16_t>(size);
+  std::memcpy(&out[start + 2], &encoded_size, sizeof(encoded_size));
+  out.resize(start + 4 + size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode a channel written by encode_channel()
+/// @param prepare Called with the number of samples, returns where to store them or nullptr if
+/// there are too many
+template <typename Prepare>
+void
+decode_channel(const char*& pos, const char* last, Prepare&& prepare)
+{
+  const auto n = get<std::uint16_t>(pos, last);
+  const auto size = get<std::uint16_t>(pos, last);
+  if (static_cast<std::size_t>(last - pos) < size)
+  {
+    malformed();
+  }
+  const auto out = prepare(std::size_t{n});
+  if (out == nullptr)
+  {
+    throw std::invalid_argument{"Too many samples in encoded channel"};
+  }
+  if (decode(pos, pos + size, n, out) != pos + size)
+  {
+    malformed();
+  }
+  pos += size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+encode(const std::uint16_t* samples, std::size_t n, char* out)
+noexcept
+{
+  const auto first_out = out;
+  auto previous = std::uint16_t{0};
+  for (auto i = std::size_t{0}; i < n; i += block_size)
+  {
+    const auto count = n - i < block_size ? n - i : block_size;
+    std::uint16_t values[block_size];
+    auto all = 0u;
+    for (auto j = std::size_t{0}; j < count; ++j)
+    {
+      values[j] = zigzag(static_cast<std::uint16_t>(samples[i + j] - previous));
+      previous = samples[i + j];
+      all |= values[j];
+    }
+    const auto width = all == 0 ? 0u : 32u - static_cast<unsigned int>(__builtin_clz(all));
+    *out++ = static_cast<char>(width);
+
+    auto bits = std::uint32_t{0};
+    auto nb_bits = 0u;
+    for (auto j = std::size_t{0}; j < count; ++j)
+    {
+      bits |= static_cast<std::uint32_t>(values[j]) << nb_bits;
+      nb_bits += width;
+      while (nb_bits >= 8)
+      {
+        *out++ = static_cast<char>(bits & 0xFF);
+        bits >>= 8;
+        nb_bits -= 8;
+      }
+    }
+    if (nb_bits != 0)
+    {
+      *out++ = static_cast<char>(bits & 0xFF);
+    }
+  }
+  return static_cast<std::size_t>(out - first_out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const char*
+decode(const char* first, const char* last, std::size_t n, std::uint16_t* out)
+{
+  auto previous = std::uint16_t{0};
+  auto decoded = selected_kernel().decode(first, last, out, n, previous);
+  // Finish with the scalar kernel when the SIMD one stops close to last, and for the last block.
+  decoded += decode_scalar(first, last, out + decoded, n - decoded, previous);
+  if (  n - decoded >= block_size
+     or (decoded != n and not decode_block(first, last, out + decoded, n - decoded, previous)))
+  {
+    malformed();
+  }
+  return first;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const char*
+kernel_name()
+noexcept
+{
+  return selected_kernel().name;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encode_scan(const scan_data& data, std::string& out)
+{
+  encode_header(data.header, out);
+  encode_channel({data.dist1, static_cast<std::size_t>(data.dist_len1)}, out);
+  encode_channel({data.dist2, static_cast<std::size_t>(data.dist_len2)}, out);
+  encode_channel({data.rssi1, static_cast<std::size_t>(data.rssi_len1)}, out);
+  encode_channel({data.rssi2, static_cast<std::size_t>(data.rssi_len2)}, out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+encode_scan(const compact_scan& data, std::string& out)
+{
+  encode_header(data.header(), out);
+  for (const auto c : {channel::dist1, channel::dist2, channel::rssi1, channel::rssi2})
+  {
+    encode_channel(data.get(c), out);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const char*
+decode_scan(const char* first, const char* last, scan_data& data)
+{
+  decode_header(first, last, data.header);
+  const auto channel = [&](std::uint16_t* samples, int& len)
+  {
+    decode_channel(first, last, [&](std::size_t n) -> std::uint16_t*
+    {
+      if (n > max_samples)
+      {
+        return nullptr;
+      }
+      len = static_cast<int>(n);
+      return samples;
+    });
+  };
+  channel(data.dist1, data.dist_len1);
+  channel(data.dist2, data.dist_len2);
+  channel(data.rssi1, data.rssi_len1);
+  channel(data.rssi2, data.rssi_len2);
+  return first;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const char*
+decode_scan(const char* first, const char* last, compact_scan& data)
+{
+  data.clear();
+  decode_header(first, last, data.header());
+  for (const auto c : {channel::dist1, channel::dist2, channel::rssi1, channel::rssi2})
+  {
+    decode_channel(first, last, [&](std::size_t n){ return data.prepare(c, n); });
+  }
+  return first;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace lms1xx::codec
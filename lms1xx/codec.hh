@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+namespace codec {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Number of samples sharing the same bit width
+static constexpr auto block_size = std::size_t{16};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Upper bound of the number of bytes needed to encode n samples
+constexpr std::size_t
+max_encoded_size(std::size_t n)
+noexcept
+{
+  return 2 * n + (n + block_size - 1) / block_size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Encode samples losslessly
+/// @param samples The samples to encode
+/// @param n Number of samples
+/// @param out Where to write encoded samples, at least max_encoded_size(n) bytes
+/// @return The number of bytes written
+///
+/// Each sample is replaced by its difference with the previous one, modulo 2^16, which is then
+/// zigzag-encoded so that small negative differences become small values. Differences are grouped
+/// by blocks of block_size, each block starting with a byte giving the number of bits of its
+/// largest difference, followed by all its differences packed on this number of bits.
+std::size_t
+encode(const std::uint16_t* samples, std::size_t n, char* out)
+noexcept;
+
+/// @brief Decode samples written by encode()
+/// @param first The first encoded byte
+/// @param last The end of encoded bytes
+/// @param n Number of samples to decode
+/// @param out Where to store decoded samples
+/// @return The position after the last byte read
+/// @throw std::invalid_argument if encoded bytes are truncated or malformed
+///
+/// The SIMD kernel used is selected at the first call, depending on the CPU: AVX2 or scalar code.
+const char*
+decode(const char* first, const char* last, std::size_t n, std::uint16_t* out);
+
+/// @brief The name of the kernel used by decode(): "avx2" or "scalar"
+const char*
+kernel_name()
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Append an encoded scan, its header and all its channels, to a buffer
+///
+/// Encoded scans can be concatenated, to be stored or sent, then decoded one after the other.
+void
+encode_scan(const scan_data& data, std::string& out);
+
+/// @brief Append an encoded scan, its header and all its channels, to a buffer
+void
+encode_scan(const compact_scan& data, std::string& out);
+
+/// @brief Decode a scan written by encode_scan()
+/// @param first The first byte of the encoded scan
+/// @param last The end of encoded bytes, which may contain following scans
+/// @return The position after the decoded scan
+/// @throw std::invalid_argument if the scan is truncated or malformed, or if a channel has more
+/// than max_samples samples
+const char*
+decode_scan(const char* first, const char* last, scan_data& data);
+
+/// @brief Decode a scan written by encode_scan() into a compact scan
+/// @throw std::invalid_argument if the scan is truncated or malformed, or if a channel has more
+/// samples than the capacity of data
+const char*
+decode_scan(const char* first, const char* last, compact_scan& data);
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace lms1xx::codec
@@ -0,0 +1,377 @@
+#include <algorithm> // find
+#include <cstdlib>   // abs
+
+#include "lms1xx/cola.hh"
+
+namespace lms1xx {
+namespace cola {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Larger CoLa-B lengths are considered as garbage.
+static constexpr auto maximal_payload_size = std::uint32_t{1} << 20;
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::int32_t
+sign_extend(std::uint32_t value, std::size_t size)
+noexcept
+{
+  switch (size)
+  {
+    case 1:  return static_cast<std::int8_t>(value);
+    case 2:  return static_cast<std::int16_t>(value);
+    default: return static_cast<std::int32_t>(value);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+find_telegram( const char* first, const char* last, protocol p
+             , const char*& begin, const char*& end)
+noexcept
+{
+  if (p == protocol::cola_a)
+  {
+    begin = std::find(first, last, telegram_start);
+    if (begin == last)
+    {
+      return false;
+    }
+    end = std::find(begin + 1, last, telegram_end);
+    if (end == last)
+    {
+      return false;
+    }
+    ++end;
+    return true;
+  }
+
+  auto pos = first;
+  while (true)
+  {
+    begin = std::find(pos, last, telegram_start);
+    if (last - begin < static_cast<std::ptrdiff_t>(binary_header_size))
+    {
+      // Not enough bytes to decide if this is the beginning of a telegram.
+      return false;
+    }
+    if (is_binary(begin, last))
+    {
+      const auto len = load_be(begin + 4, 4);
+      if (len <= maximal_payload_size)
+      {
+        const auto size = binary_header_size + len + binary_checksum_size;
+        if (static_cast<std::size_t>(last - begin) < size)
+        {
+          return false;
+        }
+        end = begin + size;
+        return true;
+      }
+    }
+    pos = begin + 1;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+payload(const char* begin, const char* end, const char*& first, const char*& last)
+noexcept
+{
+  if (is_binary(begin, end))
+  {
+    if (static_cast<std::size_t>(end - begin) < binary_header_size + binary_checksum_size)
+    {
+      return false;
+    }
+    first = begin + binary_header_size;
+    last = end - binary_checksum_size;
+    if (load_be(begin + 4, 4) != static_cast<std::uint32_t>(last - first))
+    {
+      return false;
+    }
+    auto checksum = std::uint8_t{0};
+    for (auto pos = first; pos != last; ++pos)
+    {
+      checksum ^= static_cast<std::uint8_t>(*pos);
+    }
+    return checksum == static_cast<std::uint8_t>(*last);
+  }
+
+  if (end - begin < 2 or *begin != telegram_start or *(end - 1) != telegram_end)
+  {
+    return false;
+  }
+  first = begin + 1;
+  last = end - 1;
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+writer::writer(protocol p, const char* type, const char* name)
+  : m_protocol{p}
+  , m_payload{type}
+  , m_first{true}
+{
+  m_payload += ' ';
+  m_payload += name;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+writer&
+writer::field(std::uint32_t value, std::size_t size, std::size_t digits)
+{
+  separate();
+  if (m_protocol == protocol::cola_a)
+  {
+    static constexpr char hex[] = "0123456789ABCDEF";
+    char buf[8];
+    auto pos = std::size_t{8};
+    do
+    {
+      buf[--pos] = hex[value & 0xF];
+      value >>= 4;
+    }
+    while (value != 0 or 8 - pos < digits);
+    m_payload.append(buf + pos, buf + 8);
+  }
+  else
+  {
+    for (auto i = size; i > 0; --i)
+    {
+      m_payload += static_cast<char>((value >> (8 * (i - 1))) & 0xFF);
+    }
+  }
+  return *this;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+writer&
+writer::signed_field(std::int32_t value, std::size_t size)
+{
+  if (m_protocol == protocol::cola_a)
+  {
+    separate();
+    m_payload += value < 0 ? '-' : '+';
+    m_payload += std::to_string(std::abs(static_cast<long>(value)));
+    return *this;
+  }
+  return field(static_cast<std::uint32_t>(value), size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+writer&
+writer::text(const char* str, std::size_t size)
+{
+  separate();
+  m_payload.append(str, size);
+  return *this;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::string
+writer::str()
+const
+{
+  if (m_protocol == protocol::cola_a)
+  {
+    return telegram_start + m_payload + telegram_end;
+  }
+
+  auto checksum = std::uint8_t{0};
+  for (const auto c : m_payload)
+  {
+    checksum ^= static_cast<std::uint8_t>(c);
+  }
+  const auto len = static_cast<std::uint32_t>(m_payload.size());
+
+  auto telegram = std::string(4, telegram_start);
+  telegram += static_cast<char>(len >> 24);
+  telegram += static_cast<char>((len >> 16) & 0xFF);
+  telegram += static_cast<char>((len >> 8) & 0xFF);
+  telegram += static_cast<char>(len & 0xFF);
+  telegram += m_payload;
+  telegram += static_cast<char>(checksum);
+  return telegram;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+writer::separate()
+{
+  // In CoLa-B, only the command name is followed by a space.
+  if (m_protocol == protocol::cola_a or m_first)
+  {
+    m_payload += ' ';
+  }
+  m_first = false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+reader::reader(const char* begin, const char* end)
+  : m_protocol{is_binary(begin, end) ? protocol::cola_b : protocol::cola_a}
+  , m_pos{nullptr}
+  , m_last{nullptr}
+  , m_type{}
+  , m_name{}
+{
+  if (not payload(begin, end, m_pos, m_last))
+  {
+    throw invalid_telegram_error{};
+  }
+
+  auto space = std::find(m_pos, m_last, ' ');
+  m_type.assign(m_pos, space);
+  m_pos = space == m_last ? m_last : space + 1;
+
+  space = std::find(m_pos, m_last, ' ');
+  m_name.assign(m_pos, space);
+  m_pos = space == m_last ? m_last : space + 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const std::string&
+reader::type()
+const noexcept
+{
+  return m_type;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const std::string&
+reader::name()
+const noexcept
+{
+  return m_name;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint32_t
+reader::field(std::size_t size)
+{
+  return static_cast<std::uint32_t>(signed_field(size));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::int32_t
+reader::signed_field(std::size_t size)
+{
+  if (m_protocol == protocol::cola_b)
+  {
+    if (static_cast<std::size_t>(m_last - m_pos) < size)
+    {
+      throw invalid_telegram_error{};
+    }
+    const auto value = load_be(m_pos, size);
+    m_pos += size;
+    return sign_extend(value, size);
+  }
+
+  const auto len = token();
+  auto first = m_pos - len;
+  if (*first == '+' or *first == '-')
+  {
+    const auto negative = *first == '-';
+    auto value = std::int32_t{0};
+    for (++first; first != m_pos; ++first)
+    {
+      if (*first < '0' or *first > '9')
+      {
+        throw invalid_telegram_error{};
+      }
+      value = value * 10 + (*first - '0');
+    }
+    return negative ? -value : value;
+  }
+
+  auto value = std::uint32_t{0};
+  for (; first != m_pos; ++first)
+  {
+    const auto d = hex_digit(*first);
+    if (d == not_a_digit)
+    {
+      throw invalid_telegram_error{};
+    }
+    value = (value << 4) | d;
+  }
+  return sign_extend(value, size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::string
+reader::text(std::size_t size)
+{
+  if (m_protocol == protocol::cola_b)
+  {
+    if (static_cast<std::size_t>(m_last - m_pos) < size)
+    {
+      throw invalid_telegram_error{};
+    }
+    m_pos += size;
+    return std::string(m_pos - size, m_pos);
+  }
+
+  const auto len = token();
+  return std::string(m_pos - len, m_pos);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+reader::empty()
+const noexcept
+{
+  auto pos = m_pos;
+  if (m_protocol == protocol::cola_a)
+  {
+    while (pos != m_last and *pos == ' ')
+    {
+      ++pos;
+    }
+  }
+  return pos == m_last;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+reader::token()
+{
+  while (m_pos != m_last and *m_pos == ' ')
+  {
+    ++m_pos;
+  }
+  const auto first = m_pos;
+  m_pos = std::find(m_pos, m_last, ' ');
+  if (m_pos == first)
+  {
+    throw invalid_telegram_error{};
+  }
+  return static_cast<std::size_t>(m_pos - first);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cola
+} // namespace lms1xx
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <algorithm> // equal
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+namespace cola {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Telegram delimiters.
+static constexpr auto telegram_start = char{0x02};
+static constexpr auto telegram_end   = char{0x03};
+
+// A CoLa-B telegram starts with 4 STX followed by the 32-bit big-endian length of its payload.
+static constexpr auto binary_header_size = std::size_t{8};
+
+// A CoLa-B telegram ends with a 8-bit XOR checksum of its payload.
+static constexpr auto binary_checksum_size = std::size_t{1};
+
+// Value returned by hex_digit for characters which are not hexadecimal digits.
+static constexpr auto not_a_digit = std::uint8_t{0xFF};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Convert an ASCII character to its hexadecimal value
+/// @return not_a_digit if c is not an hexadecimal digit
+inline
+std::uint8_t
+hex_digit(char c)
+noexcept
+{
+  const auto u = static_cast<unsigned>(static_cast<unsigned char>(c));
+  if (u - '0' < 10u)
+  {
+    return static_cast<std::uint8_t>(u - '0');
+  }
+  const auto l = u | 0x20u; // fold to lower case
+  if (l - 'a' < 6u)
+  {
+    return static_cast<std::uint8_t>(l - 'a' + 10);
+  }
+  return not_a_digit;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Load a big-endian unsigned integer of 1, 2 or 4 bytes
+inline
+std::uint32_t
+load_be(const char* ptr, std::size_t size)
+noexcept
+{
+  const auto p = reinterpret_cast<const unsigned char*>(ptr);
+  switch (size)
+  {
+    case 1:  return p[0];
+    case 2:  return static_cast<std::uint32_t>(p[0] << 8 | p[1]);
+    default: return  static_cast<std::uint32_t>(p[0]) << 24 | static_cast<std::uint32_t>(p[1]) << 16
+                   | static_cast<std::uint32_t>(p[2]) << 8  | static_cast<std::uint32_t>(p[3]);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell if some bytes start with a CoLa-B header
+inline
+bool
+is_binary(const char* first, const char* last)
+noexcept
+{
+  return last - first >= 4
+     and first[0] == telegram_start and first[1] == telegram_start
+     and first[2] == telegram_start and first[3] == telegram_start;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell if a complete telegram is a LMDscandata event, without checking its framing
+///
+/// Cheap enough to sort each received telegram.
+inline
+bool
+is_scan_data(const char* begin, const char* end)
+noexcept
+{
+  static constexpr char prefix[] = "sSN LMDscandata ";
+  static constexpr auto prefix_size = sizeof(prefix) - 1;
+  const auto first = begin + (is_binary(begin, end) ? binary_header_size : 1);
+  return end - first >= static_cast<std::ptrdiff_t>(prefix_size)
+     and std::equal(prefix, prefix + prefix_size, first);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Locate the first complete telegram in received bytes
+/// @param first Beginning of received bytes
+/// @param last End of received bytes
+/// @param p The protocol used to frame telegrams
+/// @param begin Set to the beginning of the telegram, or of the first byte which may start a
+/// telegram when none is complete
+/// @param end Set past the end of the telegram
+/// @return true if a complete telegram was found
+bool
+find_telegram( const char* first, const char* last, protocol p
+             , const char*& begin, const char*& end)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Get the payload of a complete telegram, without its framing
+/// @return false if the telegram is not correctly framed or if the CoLa-B checksum is wrong
+bool
+payload(const char* begin, const char* end, const char*& first, const char*& last)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Build a telegram field by field
+///
+/// Numbers are written in hexadecimal in CoLa-A, unless signed, and in big-endian in CoLa-B.
+class writer
+{
+public:
+
+  /// @brief Start a telegram
+  /// @param type The command type (sRN, sMN, sSN, ...)
+  /// @param name The command name
+  writer(protocol p, const char* type, const char* name);
+
+  /// @brief Append an unsigned number
+  /// @param size Size in bytes in CoLa-B
+  /// @param digits Minimal number of digits in CoLa-A
+  writer&
+  field(std::uint32_t value, std::size_t size, std::size_t digits = 1);
+
+  /// @brief Append a signed number
+  /// @param size Size in bytes in CoLa-B
+  ///
+  /// CoLa-A uses an explicit sign and decimal digits.
+  writer&
+  signed_field(std::int32_t value, std::size_t size);
+
+  /// @brief Append a fixed size string
+  writer&
+  text(const char* str, std::size_t size);
+
+  /// @brief Get the complete telegram, with its framing
+  std::string
+  str()
+  const;
+
+private:
+
+  void
+  separate();
+
+private:
+
+  /// @brief The protocol of the telegram
+  protocol m_protocol;
+
+  /// @brief The payload
+  std::string m_payload;
+
+  /// @brief True when no field was appended yet
+  bool m_first;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Read the fields of a telegram
+class reader
+{
+public:
+
+  /// @brief Start reading a complete telegram
+  /// @throw invalid_telegram_error if the telegram is not correctly framed
+  reader(const char* begin, const char* end);
+
+  /// @brief The command type (sRA, sAN, sSN, ...)
+  const std::string&
+  type()
+  const noexcept;
+
+  /// @brief The command name
+  const std::string&
+  name()
+  const noexcept;
+
+  /// @brief Read an unsigned number
+  /// @param size Size in bytes in CoLa-B
+  /// @throw invalid_telegram_error if no number can be read
+  std::uint32_t
+  field(std::size_t size);
+
+  /// @brief Read a signed number
+  /// @param size Size in bytes in CoLa-B
+  /// @throw invalid_telegram_error if no number can be read
+  ///
+  /// In CoLa-A, the number may be in signed decimal or in hexadecimal two's complement.
+  std::int32_t
+  signed_field(std::size_t size);
+
+  /// @brief Read a fixed size string
+  /// @param size Size in bytes in CoLa-B
+  std::string
+  text(std::size_t size);
+
+  /// @brief Tell if all fields were read
+  bool
+  empty()
+  const noexcept;
+
+private:
+
+  /// @brief Go to the next CoLa-A field
+  /// @return The length of the field
+  std::size_t
+  token();
+
+private:
+
+  /// @brief The protocol of the telegram
+  protocol m_protocol;
+
+  /// @brief Current position in the payload
+  const char* m_pos;
+
+  /// @brief End of the payload
+  const char* m_last;
+
+  /// @brief The command type
+  std::string m_type;
+
+  /// @brief The command name
+  std::string m_name;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace cola
+} // namespace lms1xx
@@ -0,0 +1,146 @@
+#include <algorithm> // copy
+#include <stdexcept>
+#include <utility>   // move
+
+#include "lms1xx/compact_scan.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+nb_points(const scan_output_range& range)
+{
+  if (range.angle_resolution <= 0 or range.stop_angle < range.start_angle)
+  {
+    throw std::invalid_argument{"empty scan output range"};
+  }
+  return static_cast<std::size_t>((range.stop_angle - range.start_angle) / range.angle_resolution)
+       + 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+constexpr std::size_t compact_scan::nb_channels;
+
+/*------------------------------------------------------------------------------------------------*/
+
+compact_scan::compact_scan(std::size_t capacity)
+  : m_capacity{capacity}
+  , m_header{}
+  , m_samples{}
+  , m_sizes{0, 0, 0, 0}
+{
+  if (capacity == 0)
+  {
+    throw std::invalid_argument{"compact_scan capacity must be positive"};
+  }
+  // Samples are left uninitialized, they are only read up to the size of their channel.
+  m_samples.reset(new std::uint16_t[nb_channels * capacity]);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+compact_scan::compact_scan(const scan_output_range& range)
+  : compact_scan{nb_points(range)}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+compact_scan::compact_scan(compact_scan&& other)
+noexcept
+  : m_capacity{other.m_capacity}
+  , m_header(other.m_header)
+  , m_samples{std::move(other.m_samples)}
+  , m_sizes{other.m_sizes[0], other.m_sizes[1], other.m_sizes[2], other.m_sizes[3]}
+{
+  other.m_capacity = 0;
+  other.clear();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+compact_scan&
+compact_scan::operator=(compact_scan&& other)
+noexcept
+{
+  if (this != &other)
+  {
+    m_capacity = other.m_capacity;
+    m_header = other.m_header;
+    m_samples = std::move(other.m_samples);
+    std::copy(other.m_sizes, other.m_sizes + nb_channels, m_sizes);
+    other.m_capacity = 0;
+    other.clear();
+  }
+  return *this;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+compact_scan::capacity()
+const noexcept
+{
+  return m_capacity;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_header&
+compact_scan::header()
+const noexcept
+{
+  return m_header;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_header&
+compact_scan::header()
+noexcept
+{
+  return m_header;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+channel_span
+compact_scan::get(channel c)
+const noexcept
+{
+  const auto i = static_cast<std::size_t>(c);
+  return {m_samples.get() + i * m_capacity, m_sizes[i]};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+compact_scan::clear()
+noexcept
+{
+  for (auto& size : m_sizes)
+  {
+    size = 0;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint16_t*
+compact_scan::prepare(channel c, std::size_t size)
+noexcept
+{
+  // A moved-from scan has no buffer, and a capacity of 0.
+  if (size > m_capacity or not m_samples)
+  {
+    return nullptr;
+  }
+  const auto i = static_cast<std::size_t>(c);
+  m_sizes[i] = size;
+  return m_samples.get() + i * m_capacity;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
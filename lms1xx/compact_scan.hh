@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A read-only view on the samples of a channel
+struct channel_span
+{
+  /// @brief The first sample
+  const std::uint16_t* data;
+
+  /// @brief Number of samples, 0 if the channel is absent from the scan
+  std::size_t size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Number of points of the scans of a given output range
+/// @throw std::invalid_argument if the range is empty
+std::size_t
+nb_points(const scan_output_range& range);
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A scan stored in a single buffer sized for a given scan configuration
+///
+/// Contrary to scan_data, which always holds 4 channels of 1082 samples, the capacity of each
+/// channel is given at construction, usually from the scan output range of the device. The 4
+/// channels are stored one after the other in a contiguous buffer, which is never initialized nor
+/// reallocated. Thus, decoding a scan only touches the samples actually received.
+class compact_scan final
+{
+public:
+
+  /// @brief Number of channels
+  static constexpr auto nb_channels = std::size_t{4};
+
+  /// @brief Can't copy-construct a compact_scan
+  compact_scan(const compact_scan&) = delete;
+
+  /// @brief Can't copy a compact_scan
+  compact_scan& operator=(const compact_scan&) = delete;
+
+  /// @brief Move constructor
+  ///
+  /// The moved-from scan is left empty, with a capacity of 0: prepare() then always fails.
+  compact_scan(compact_scan&& other)
+  noexcept;
+
+  /// @brief Move operator
+  ///
+  /// The moved-from scan is left empty, with a capacity of 0: prepare() then always fails.
+  compact_scan&
+  operator=(compact_scan&& other)
+  noexcept;
+
+  /// @brief Constructor
+  /// @param capacity Maximal number of samples of each channel
+  /// @throw std::invalid_argument if capacity is 0
+  explicit
+  compact_scan(std::size_t capacity);
+
+  /// @brief Construct a scan with just enough room for a scan output range
+  /// @throw std::invalid_argument if the range is empty
+  explicit
+  compact_scan(const scan_output_range& range);
+
+  /// @brief Maximal number of samples of each channel
+  std::size_t
+  capacity()
+  const noexcept;
+
+  /// @brief Header of the telegram
+  const scan_header&
+  header()
+  const noexcept;
+
+  /// @brief Header of the telegram
+  scan_header&
+  header()
+  noexcept;
+
+  /// @brief Get the samples of a channel
+  channel_span
+  get(channel c)
+  const noexcept;
+
+  /// @brief Remove all samples
+  void
+  clear()
+  noexcept;
+
+  /// @brief Get the storage of a channel to write size samples in it
+  /// @return nullptr if size exceeds the capacity
+  ///
+  /// The previous samples of the channel are discarded.
+  std::uint16_t*
+  prepare(channel c, std::size_t size)
+  noexcept;
+
+private:
+
+  /// @brief Maximal number of samples of each channel
+  std::size_t m_capacity;
+
+  /// @brief Header of the telegram
+  scan_header m_header;
+
+  /// @brief The samples of all channels, m_capacity samples per channel
+  std::unique_ptr<std::uint16_t[]> m_samples;
+
+  /// @brief Number of samples of each channel
+  std::size_t m_sizes[nb_channels];
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
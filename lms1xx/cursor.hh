@@ -0,0 +1,488 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lms1xx/cola.hh"
+#include "lms1xx/hex.hh"
+#include "lms1xx/lms1xx.hh"
+
+/// @file
+/// Walk the fields of LMDscandata telegrams, for the parsers of the library.
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Walk the space-separated fields of a CoLa-A telegram
+///
+/// A field which can't be read makes the cursor fail: it then stays at the end of the telegram,
+/// all following fields are empty and decoded as 0. Thus, malformed telegrams are detected once
+/// at the end of decoding, without any exception.
+///
+/// A field must be followed by a delimiter: as the event info which ends LMDscandata telegrams is
+/// never decoded, a field which reaches the end of the bytes is one cut by a truncation.
+class cursor
+{
+public:
+
+  cursor(const char* first, const char* last)
+  noexcept
+    : m_pos{first}
+    , m_last{last}
+    , m_failed{false}
+  {
+    if (m_pos != m_last and *m_pos == cola::telegram_start)
+    {
+      ++m_pos;
+    }
+  }
+
+  /// @brief Go to the next field, without decoding it
+  void
+  skip()
+  noexcept
+  {
+    const auto first = begin_token();
+    while (m_pos != m_last and not is_delimiter(*m_pos))
+    {
+      ++m_pos;
+    }
+    end_token(first);
+  }
+
+  /// @brief Go over the next n fields, without decoding them
+  ///
+  /// Only delimiters are looked for, skipped fields are not validated.
+  void
+  skip(std::size_t n)
+  noexcept
+  {
+    for (auto i = hex::skip_fields(m_pos, m_last, n); i < n and not m_failed; ++i)
+    {
+      skip();
+    }
+  }
+
+  /// @brief Decode the next field as an hexadecimal number
+  std::uint32_t
+  hex()
+  noexcept
+  {
+    const auto first = begin_token();
+    auto value = std::uint32_t{0};
+    while (m_pos != m_last)
+    {
+      const auto d = cola::hex_digit(*m_pos);
+      if (d == cola::not_a_digit)
+      {
+        break;
+      }
+      value = (value << 4) | d;
+      ++m_pos;
+    }
+    end_token(first);
+    return value;
+  }
+
+  /// @brief Get the next field
+  /// @param len Set to the length of the field
+  /// @return A pointer to the beginning of the field
+  const char*
+  token(std::size_t& len)
+  noexcept
+  {
+    const auto first = begin_token();
+    while (m_pos != m_last and not is_delimiter(*m_pos))
+    {
+      ++m_pos;
+    }
+    end_token(first);
+    len = static_cast<std::size_t>(m_pos - first);
+    return first;
+  }
+
+  /// @brief Decode the next fields in bulk, as long as they are hexadecimal numbers of at most 4
+  /// digits
+  /// @return The number of decoded fields, at most n; remaining ones must be decoded with hex()
+  std::size_t
+  hex_fields(uint16_t* out, std::size_t n)
+  noexcept
+  {
+    while (m_pos != m_last and *m_pos == ' ')
+    {
+      ++m_pos;
+    }
+    return hex::decode_fields(m_pos, m_last, out, n);
+  }
+
+  /// @brief Tell if all fields have been read
+  bool
+  done()
+  noexcept
+  {
+    while (m_pos != m_last and *m_pos == ' ')
+    {
+      ++m_pos;
+    }
+    return m_pos == m_last or *m_pos == cola::telegram_end;
+  }
+
+  /// @brief Stop reading fields
+  void
+  fail()
+  noexcept
+  {
+    m_failed = true;
+    m_pos = m_last;
+  }
+
+  /// @brief Tell if a field couldn't be read
+  bool
+  failed()
+  const noexcept
+  {
+    return m_failed;
+  }
+
+  /// @brief The current position, to resume reading with a new cursor
+  const char*
+  position()
+  const noexcept
+  {
+    return m_pos;
+  }
+
+private:
+
+  static
+  bool
+  is_delimiter(char c)
+  noexcept
+  {
+    return c == ' ' or c == cola::telegram_end;
+  }
+
+  const char*
+  begin_token()
+  noexcept
+  {
+    while (m_pos != m_last and *m_pos == ' ')
+    {
+      ++m_pos;
+    }
+    if (m_pos == m_last or *m_pos == cola::telegram_end)
+    {
+      fail();
+    }
+    return m_pos;
+  }
+
+  void
+  end_token(const char* first)
+  noexcept
+  {
+    if (m_pos == first or m_pos == m_last or not is_delimiter(*m_pos))
+    {
+      fail();
+    }
+  }
+
+private:
+
+  /// @brief Current position in the telegram
+  const char* m_pos;
+
+  /// @brief End of the telegram
+  const char* m_last;
+
+  /// @brief True if a field couldn't be read
+  bool m_failed;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Walk the big-endian fields of a CoLa-B payload
+///
+/// Fails like cursor when there are not enough bytes left.
+class binary_cursor
+{
+public:
+
+  binary_cursor(const char* first, const char* last)
+  noexcept
+    : m_pos{first}
+    , m_last{last}
+    , m_failed{false}
+  {}
+
+  /// @brief Go to the next field, without decoding it
+  void
+  skip(std::size_t size)
+  noexcept
+  {
+    bytes(size);
+  }
+
+  /// @brief Decode a 8, 16 or 32-bit unsigned field
+  std::uint32_t
+  field(std::size_t size)
+  noexcept
+  {
+    const auto pos = bytes(size);
+    return pos ? cola::load_be(pos, size) : 0;
+  }
+
+  /// @brief Get the next bytes
+  /// @return nullptr if there are not enough bytes left
+  const char*
+  bytes(std::size_t size)
+  noexcept
+  {
+    if (static_cast<std::size_t>(m_last - m_pos) < size)
+    {
+      fail();
+      return nullptr;
+    }
+    m_pos += size;
+    return m_pos - size;
+  }
+
+  /// @brief Tell if all fields have been read
+  bool
+  done()
+  const noexcept
+  {
+    return m_pos == m_last;
+  }
+
+  /// @brief Stop reading fields
+  void
+  fail()
+  noexcept
+  {
+    m_failed = true;
+    m_pos = m_last;
+  }
+
+  /// @brief Tell if a field couldn't be read
+  bool
+  failed()
+  const noexcept
+  {
+    return m_failed;
+  }
+
+  /// @brief The current position, to resume reading with a new cursor
+  const char*
+  position()
+  const noexcept
+  {
+    return m_pos;
+  }
+
+private:
+
+  /// @brief Current position in the payload
+  const char* m_pos;
+
+  /// @brief End of the payload
+  const char* m_last;
+
+  /// @brief True if a field couldn't be read
+  bool m_failed;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Get the channel of a MeasuredDataContent field
+/// @return false if the channel is unknown
+inline
+bool
+content_channel(const char* content, std::size_t len, channel& c)
+noexcept
+{
+  if (len != 5 or (content[4] != '1' and content[4] != '2'))
+  {
+    return false;
+  }
+  const auto first = content[4] == '1';
+  if (content[0] == 'D' and content[1] == 'I' and content[2] == 'S' and content[3] == 'T')
+  {
+    c = first ? channel::dist1 : channel::dist2;
+    return true;
+  }
+  if (content[0] == 'R' and content[1] == 'S' and content[2] == 'S' and content[3] == 'I')
+  {
+    c = first ? channel::rssi1 : channel::rssi2;
+    return true;
+  }
+  return false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode consecutive samples
+inline
+void
+decode_samples(cursor& c, uint16_t* storage, std::size_t n)
+noexcept
+{
+  for (auto j = c.hex_fields(storage, n); j < n and not c.failed(); ++j)
+  {
+    storage[j] = static_cast<uint16_t>(c.hex());
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode the samples of a CoLa-B channel
+/// @param first The first byte of the first decoded sample
+/// @param sample_size 2 for 16-bit channels, 1 for 8-bit ones
+/// @param stride Number of samples between two decoded ones
+inline
+void
+decode_samples( const char* first, std::size_t sample_size, std::size_t stride, uint16_t* storage
+              , std::size_t n)
+noexcept
+{
+  const auto p = reinterpret_cast<const unsigned char*>(first);
+  const auto step = stride * sample_size;
+  if (sample_size == 2)
+  {
+    for (auto j = std::size_t{0}; j < n; ++j)
+    {
+      storage[j] = static_cast<uint16_t>(p[step * j] << 8 | p[step * j + 1]);
+    }
+  }
+  else
+  {
+    for (auto j = std::size_t{0}; j < n; ++j)
+    {
+      storage[j] = p[step * j];
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode the fields of a CoLa-A telegram which precede the channels
+///
+/// Encoders are skipped, the cursor is left on the number of 16-bit channels.
+inline
+void
+parse_header(cursor& c, scan_header& header)
+noexcept
+{
+  c.skip(); // Type of command
+  c.skip(); // Command
+  header.version = static_cast<uint16_t>(c.hex());
+  header.device_number = static_cast<uint16_t>(c.hex());
+  header.serial_number = c.hex();
+  header.status = static_cast<uint16_t>(c.hex() << 8);
+  header.status = static_cast<uint16_t>(header.status | c.hex());
+  header.message_counter = static_cast<uint16_t>(c.hex());
+  header.scan_counter = static_cast<uint16_t>(c.hex());
+  header.power_up_duration = c.hex();
+  header.transmission_duration = c.hex();
+  c.skip(); // InputStatus
+  c.skip(); // InputStatus
+  c.skip(); // OutputStatus
+  c.skip(); // OutputStatus
+  c.skip(); // ReservedByteA
+  header.scanning_frequency = c.hex();
+  header.measurement_frequency = c.hex();
+
+  const auto nb_encoders = c.hex(); // NumberEncoders
+  for (auto i = 0u; i < nb_encoders and not c.failed(); ++i)
+  {
+    c.skip(); // EncoderPosition
+    c.skip(); // EncoderSpeed
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode the fields of a CoLa-B payload which precede the channels
+///
+/// Encoders are skipped, the cursor is left on the number of 16-bit channels.
+inline
+void
+parse_header(binary_cursor& c, scan_header& header)
+noexcept
+{
+  c.skip(16); // "sSN LMDscandata "
+  header.version = static_cast<uint16_t>(c.field(2));
+  header.device_number = static_cast<uint16_t>(c.field(2));
+  header.serial_number = c.field(4);
+  header.status = static_cast<uint16_t>(c.field(2));
+  header.message_counter = static_cast<uint16_t>(c.field(2));
+  header.scan_counter = static_cast<uint16_t>(c.field(2));
+  header.power_up_duration = c.field(4);
+  header.transmission_duration = c.field(4);
+  c.skip(2); // InputStatus
+  c.skip(2); // OutputStatus
+  c.skip(2); // ReservedByteA
+  header.scanning_frequency = c.field(4);
+  header.measurement_frequency = c.field(4);
+
+  const auto nb_encoders = c.field(2); // NumberEncoders
+  c.skip(nb_encoders * 6); // EncoderPosition and EncoderSpeed
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode the timestamp which follows the channels of a CoLa-A telegram
+///
+/// The layout of position, name and comment isn't needed, the timestamp is only decoded when
+/// they are absent.
+inline
+void
+parse_trailer(cursor& c, scan_header& header)
+noexcept
+{
+  if (c.done() or c.hex() != 0 or c.hex() != 0 or c.hex() != 0)
+  {
+    return;
+  }
+  if (c.hex() != 0) // Time information
+  {
+    header.timestamp.year = static_cast<uint16_t>(c.hex());
+    header.timestamp.month = static_cast<uint8_t>(c.hex());
+    header.timestamp.day = static_cast<uint8_t>(c.hex());
+    header.timestamp.hour = static_cast<uint8_t>(c.hex());
+    header.timestamp.minute = static_cast<uint8_t>(c.hex());
+    header.timestamp.second = static_cast<uint8_t>(c.hex());
+    header.timestamp.microsecond = c.hex();
+    header.has_timestamp = not c.failed();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode the timestamp which follows the channels of a CoLa-B payload
+inline
+void
+parse_trailer(binary_cursor& c, scan_header& header)
+noexcept
+{
+  if (c.done() or c.field(2) != 0 or c.field(2) != 0 or c.field(2) != 0)
+  {
+    return;
+  }
+  if (c.field(2) != 0) // Time information
+  {
+    header.timestamp.year = static_cast<uint16_t>(c.field(2));
+    header.timestamp.month = static_cast<uint8_t>(c.field(1));
+    header.timestamp.day = static_cast<uint8_t>(c.field(1));
+    header.timestamp.hour = static_cast<uint8_t>(c.field(1));
+    header.timestamp.minute = static_cast<uint8_t>(c.field(1));
+    header.timestamp.second = static_cast<uint8_t>(c.field(1));
+    header.timestamp.microsecond = c.field(4);
+    header.has_timestamp = not c.failed();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
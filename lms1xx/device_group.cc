@@ -0,0 +1,186 @@
+#include "lms1xx/device_group.hh"
+#include "lms1xx/run_io.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+device_group::device_group(std::size_t nb_threads, std::size_t buffer_size)
+  : m_io{}
+  , m_pool{buffer_size}
+  , m_nb_threads{nb_threads == 0 ? 1 : nb_threads}
+  , m_devices{}
+  , m_work{}
+  , m_threads{}
+  , m_handler_error_handler{}
+  , m_handler_errors{0}
+  , m_previous{}
+  , m_previous_time{std::chrono::steady_clock::now()}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+device_group::~device_group()
+{
+  stop();
+  for (auto& device : m_devices)
+  {
+    device->disconnect();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+LMS1xx&
+device_group::add( const std::string& host, const std::string& port
+                 , const boost::posix_time::time_duration& timeout, protocol p)
+{
+  std::unique_ptr<LMS1xx> device{new LMS1xx{m_io, timeout, p, &m_pool}};
+  device->connect(host, port);
+  m_devices.push_back(std::move(device));
+  m_previous.push_back(m_devices.back()->get_statistics());
+  return *m_devices.back();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+device_group::size()
+const noexcept
+{
+  return m_devices.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+LMS1xx&
+device_group::operator[](std::size_t device)
+noexcept
+{
+  return *m_devices[device];
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+device_group::start( device_scan_handler handler, device_error_handler on_error
+                   , error_handler on_handler_error)
+{
+  if (running())
+  {
+    return;
+  }
+
+  m_handler_error_handler = std::move(on_handler_error);
+  for (auto i = std::size_t{0}; i < m_devices.size(); ++i)
+  {
+    m_devices[i]->start_stream( [handler, i](const scan_data& data)
+                                {
+                                  handler(i, data);
+                                }
+                              , [on_error, i](std::exception_ptr error)
+                                {
+                                  if (on_error)
+                                  {
+                                    on_error(i, error);
+                                  }
+                                });
+  }
+
+  m_work.reset(new boost::asio::io_service::work{m_io});
+  for (auto i = std::size_t{0}; i < m_nb_threads; ++i)
+  {
+    m_threads.emplace_back([this]
+    {
+      run_io(m_io, [this](std::exception_ptr error)
+                   {
+                     m_handler_errors.fetch_add(1, std::memory_order_relaxed);
+                     if (m_handler_error_handler)
+                     {
+                       m_handler_error_handler(error);
+                     }
+                   });
+    });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+device_group::stop()
+{
+  if (not running())
+  {
+    return;
+  }
+
+  for (auto& device : m_devices)
+  {
+    device->stop_stream();
+  }
+
+  m_work.reset();
+  m_io.stop();
+  for (auto& thread : m_threads)
+  {
+    thread.join();
+  }
+  m_threads.clear();
+  m_io.reset();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+device_group::running()
+const noexcept
+{
+  return not m_threads.empty();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const buffer_pool&
+device_group::pool()
+const noexcept
+{
+  return m_pool;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::vector<device_load>
+device_group::load()
+{
+  const auto now = std::chrono::steady_clock::now();
+  const auto elapsed = std::chrono::duration<double>(now - m_previous_time).count();
+  m_previous_time = now;
+
+  auto result = std::vector<device_load>{};
+  result.reserve(m_devices.size());
+  for (auto i = std::size_t{0}; i < m_devices.size(); ++i)
+  {
+    const auto current = m_devices[i]->get_statistics();
+    auto l = device_load{};
+    l.scans = current.scans - m_previous[i].scans;
+    l.cpu_seconds = static_cast<double>(current.cpu_time - m_previous[i].cpu_time) * 1e-9;
+    l.scans_per_second = elapsed > 0 ? static_cast<double>(l.scans) / elapsed : 0;
+    l.cpu_load = elapsed > 0 ? l.cpu_seconds / elapsed : 0;
+    result.push_back(l);
+    m_previous[i] = current;
+  }
+  return result;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+device_group::handler_errors()
+const noexcept
+{
+  return m_handler_errors.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
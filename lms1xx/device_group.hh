@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+
+#include "lms1xx/buffer_pool.hh"
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Called for each scan received by a device of a group
+using device_scan_handler = std::function<void (std::size_t device, const scan_data&)>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Called when an error stops the stream of a device of a group
+using device_error_handler = std::function<void (std::size_t device, std::exception_ptr)>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The activity of a device of a group
+struct device_load
+{
+  /// @brief Number of scans decoded during the period
+  std::uint64_t scans;
+
+  /// @brief Number of scans decoded per second
+  double scans_per_second;
+
+  /// @brief CPU time spent to receive, decode and handle scans during the period, in seconds
+  double cpu_seconds;
+
+  /// @brief Fraction of a core used by the device
+  double cpu_load;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Several devices streaming scans with a shared io_service, thread pool and buffer pool
+///
+/// Devices are configured one by one with the usual commands while the group is stopped. Once
+/// started, all devices stream their scans on the threads of the group. A device only holds a
+/// receive buffer while it has received bytes which aren't decoded yet, thus the number of
+/// buffers depends on the number of threads rather than on the number of devices.
+class device_group final
+{
+public:
+
+  /// @brief Can't copy-construct a device_group
+  device_group(const device_group&) = delete;
+
+  /// @brief Can't copy a device_group
+  device_group& operator=(const device_group&) = delete;
+
+  /// @brief Constructor
+  /// @param nb_threads Number of threads which run the devices once the group is started
+  /// @param buffer_size Size of receive buffers, large enough for the longest telegram
+  explicit
+  device_group(std::size_t nb_threads = 2, std::size_t buffer_size = 65536);
+
+  /// @brief Destructor
+  ///
+  /// Stop the group and disconnect all devices.
+  ~device_group();
+
+  /// @brief Connect to a new device
+  /// @return The new device, to configure it while the group is stopped
+  /// @note Can't be called while the group is started
+  LMS1xx&
+  add( const std::string& host, const std::string& port
+     , const boost::posix_time::time_duration& timeout = boost::posix_time::seconds{30}
+     , protocol p = protocol::cola_a);
+
+  /// @brief Number of devices
+  std::size_t
+  size()
+  const noexcept;
+
+  /// @brief Get a device
+  LMS1xx&
+  operator[](std::size_t device)
+  noexcept;
+
+  /// @brief Start streaming scans of all devices
+  /// @param handler Called for each scan, from the threads of the group
+  /// @param on_error Called when an error stops the stream of a device, others keep streaming
+  /// @param on_handler_error Called, from the threads of the group, with the exceptions thrown by
+  /// on_error; must not throw
+  ///
+  /// Continuous acquisition must have been started on each device. Handlers of a given device
+  /// never run concurrently, but handlers of different devices do. An exception thrown by
+  /// on_error doesn't stop the other devices, it's counted by handler_errors().
+  void
+  start( device_scan_handler handler, device_error_handler on_error = nullptr
+       , error_handler on_handler_error = nullptr);
+
+  /// @brief Stop streaming scans and wait for the threads of the group
+  void
+  stop();
+
+  /// @brief Tell if the group is started
+  bool
+  running()
+  const noexcept;
+
+  /// @brief The pool of receive buffers
+  const buffer_pool&
+  pool()
+  const noexcept;
+
+  /// @brief The activity of each device since the previous call, or since devices were added
+  std::vector<device_load>
+  load();
+
+  /// @brief Number of exceptions thrown by error handlers since the group was constructed
+  std::uint64_t
+  handler_errors()
+  const noexcept;
+
+private:
+
+  /// @brief Shared by all devices
+  boost::asio::io_service m_io;
+
+  /// @brief Shared by all devices
+  buffer_pool m_pool;
+
+  /// @brief Number of threads which run m_io
+  const std::size_t m_nb_threads;
+
+  /// @brief The devices
+  std::vector<std::unique_ptr<LMS1xx>> m_devices;
+
+  /// @brief Keep m_io running while the group is started
+  std::unique_ptr<boost::asio::io_service::work> m_work;
+
+  /// @brief Run m_io while the group is started
+  std::vector<std::thread> m_threads;
+
+  /// @brief Called with the exceptions thrown by error handlers
+  error_handler m_handler_error_handler;
+
+  /// @brief Number of exceptions thrown by error handlers
+  std::atomic<std::uint64_t> m_handler_errors;
+
+  /// @brief Statistics of each device at the previous call to load()
+  std::vector<statistics> m_previous;
+
+  /// @brief Time of the previous call to load()
+  std::chrono::steady_clock::time_point m_previous_time;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
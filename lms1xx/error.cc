@@ -0,0 +1,63 @@
+#include <string>
+
+#include "lms1xx/error.hh"
+
+namespace lms1xx {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+class category final
+  : public std::error_category
+{
+public:
+
+  const char*
+  name()
+  const noexcept override
+  {
+    return "lms1xx";
+  }
+
+  std::string
+  message(int e)
+  const override
+  {
+    switch (static_cast<errc>(e))
+    {
+      case errc::invalid_telegram: return "Invalid telegram";
+      case errc::timeout:          return "Timeout";
+      case errc::end_of_recording: return "End of recording";
+      case errc::command_rejected: return "Command rejected by the device";
+    }
+    return "Unknown error";
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+const std::error_category&
+error_category()
+noexcept
+{
+  static const category c{};
+  return c;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::error_code
+make_error_code(errc e)
+noexcept
+{
+  return {static_cast<int>(e), error_category()};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
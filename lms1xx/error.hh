@@ -0,0 +1,53 @@
+#pragma once
+
+#include <system_error>
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Errors reported by the library through std::error_code
+///
+/// Other errors, like the ones of the connection to the device, keep their own category.
+enum class errc
+{
+  /// @brief A telegram couldn't have been read or decoded, see invalid_telegram_error
+  invalid_telegram = 1
+  /// @brief No data have been read for a given amount of time, see timeout_error
+, timeout
+  /// @brief All recorded scans have been delivered, see end_of_recording
+, end_of_recording
+  /// @brief The device replied with an error, or refused the command
+, command_rejected
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The category of errc
+const std::error_category&
+error_category()
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Make errc usable as a std::error_code
+std::error_code
+make_error_code(errc e)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
+
+namespace std {
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <>
+struct is_error_code_enum<lms1xx::errc>
+  : true_type
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace std
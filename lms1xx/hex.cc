@@ -0,0 +1,391 @@
+#include <cstring> // memcpy
+
+#include "lms1xx/cola.hh"
+#include "lms1xx/hex.hh"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# define LMS1XX_HEX_X86 1
+# include <immintrin.h>
+#endif
+
+namespace lms1xx {
+namespace hex {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+using kernel_type = std::size_t (*)(const char*&, const char*, std::uint16_t*, std::size_t);
+
+using skip_kernel_type = std::size_t (*)(const char*&, const char*, std::size_t);
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+decode_scalar(const char*& pos, const char* last, std::uint16_t* out, std::size_t n)
+noexcept
+{
+  auto decoded = std::size_t{0};
+  auto p = pos;
+  while (decoded != n)
+  {
+    while (p != last and *p == ' ')
+    {
+      ++p;
+    }
+    auto value = std::uint32_t{0};
+    auto len = 0;
+    for (; p != last and len <= 4; ++p, ++len)
+    {
+      const auto d = cola::hex_digit(*p);
+      if (d == cola::not_a_digit)
+      {
+        break;
+      }
+      value = (value << 4) | d;
+    }
+    if (len == 0 or len > 4 or p == last or *p != ' ')
+    {
+      break;
+    }
+    out[decoded++] = static_cast<std::uint16_t>(value);
+    pos = ++p;
+  }
+  return decoded;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+skip_scalar(const char*& pos, const char* last, std::size_t n)
+noexcept
+{
+  auto skipped = std::size_t{0};
+  auto p = pos;
+  while (skipped != n)
+  {
+    while (p != last and *p == ' ')
+    {
+      ++p;
+    }
+    const auto first = p;
+    while (p != last and *p != ' ' and *p != cola::telegram_end)
+    {
+      ++p;
+    }
+    if (p == first or p == last or *p != ' ')
+    {
+      break;
+    }
+    ++skipped;
+    pos = ++p;
+  }
+  return skipped;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+#ifdef LMS1XX_HEX_X86
+
+/// @brief Decode the fields of a block, once its digits and spaces have been located
+/// @param nibbles The values of the bytes of the block taken as hexadecimal digits, preceded by 4
+/// bytes
+/// @param spaces Bit i is set if the i-th byte of the block is a space, cleared from the first
+/// byte which is neither a space nor an hexadecimal digit
+/// @return The number of bytes consumed in the block
+inline
+std::size_t
+decode_block(const std::uint8_t* nibbles, std::uint32_t spaces, std::uint16_t*& out, std::size_t& n)
+noexcept
+{
+  auto start = 0u;
+  while (spaces != 0 and n != 0)
+  {
+    const auto end = static_cast<unsigned>(__builtin_ctz(spaces));
+    spaces &= spaces - 1;
+    const auto len = end - start;
+    if (len > 4)
+    {
+      break;
+    }
+    if (len != 0)
+    {
+      // The 4 digits before the space, in memory order; bits of shorter fields are masked.
+      auto x = std::uint32_t{};
+      std::memcpy(&x, nibbles + end, 4);
+      const auto value = (x & 0xFu) << 12 | (x & 0xF00u) | (x >> 12 & 0xF0u) | (x >> 24 & 0xFu);
+      *out++ = static_cast<std::uint16_t>(value & ((1u << (4 * len)) - 1));
+      --n;
+    }
+    start = end + 1;
+  }
+  return start;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+__attribute__((target("sse4.2")))
+std::size_t
+decode_sse42(const char*& pos, const char* last, std::uint16_t* out, std::size_t n)
+noexcept
+{
+  std::uint8_t nibbles[4 + 16] = {};
+  const auto first_out = out;
+  while (n != 0 and last - pos >= 16)
+  {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const auto d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    const auto a = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const auto is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+    const auto is_alpha = _mm_cmpeq_epi8(_mm_min_epu8(a, _mm_set1_epi8(5)), a);
+    const auto is_space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+    const auto nib = _mm_blendv_epi8(_mm_add_epi8(a, _mm_set1_epi8(10)), d, is_digit);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(nibbles + 4), nib);
+
+    const auto valid = static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(is_digit, is_alpha), is_space)));
+    auto spaces = static_cast<std::uint32_t>(_mm_movemask_epi8(is_space));
+    if (valid != 0xFFFFu)
+    {
+      spaces &= (1u << __builtin_ctz(~valid)) - 1;
+    }
+
+    const auto consumed = decode_block(nibbles, spaces, out, n);
+    if (consumed == 0)
+    {
+      break;
+    }
+    pos += consumed;
+  }
+  return static_cast<std::size_t>(out - first_out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+__attribute__((target("avx2")))
+std::size_t
+decode_avx2(const char*& pos, const char* last, std::uint16_t* out, std::size_t n)
+noexcept
+{
+  std::uint8_t nibbles[4 + 32] = {};
+  const auto first_out = out;
+  while (n != 0 and last - pos >= 32)
+  {
+    const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+    const auto d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+    const auto a = _mm256_sub_epi8( _mm256_or_si256(v, _mm256_set1_epi8(0x20))
+                                  , _mm256_set1_epi8('a'));
+    const auto is_digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+    const auto is_alpha = _mm256_cmpeq_epi8(_mm256_min_epu8(a, _mm256_set1_epi8(5)), a);
+    const auto is_space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+    const auto nib = _mm256_blendv_epi8(_mm256_add_epi8(a, _mm256_set1_epi8(10)), d, is_digit);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(nibbles + 4), nib);
+
+    const auto valid = static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(_mm256_or_si256(_mm256_or_si256(is_digit, is_alpha), is_space)));
+    auto spaces = static_cast<std::uint32_t>(_mm256_movemask_epi8(is_space));
+    if (valid != 0xFFFFFFFFu)
+    {
+      spaces &= (1u << __builtin_ctz(~valid)) - 1;
+    }
+
+    const auto consumed = decode_block(nibbles, spaces, out, n);
+    if (consumed == 0)
+    {
+      break;
+    }
+    pos += consumed;
+  }
+  return static_cast<std::size_t>(out - first_out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Skip the fields which end in a block, once its spaces have been located
+/// @param ends Bit i is set if the i-th byte of the block is a space which follows a field
+/// @param n The number of fields still to skip
+/// @return The number of bytes consumed in the block if the last field to skip ends in it, 0
+/// otherwise
+inline
+std::size_t
+skip_block(std::uint32_t ends, std::size_t& n)
+noexcept
+{
+  const auto count = static_cast<std::size_t>(__builtin_popcount(ends));
+  if (count < n)
+  {
+    n -= count;
+    return 0;
+  }
+  for (; n > 1; --n)
+  {
+    ends &= ends - 1;
+  }
+  n = 0;
+  return static_cast<std::size_t>(__builtin_ctz(ends)) + 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+__attribute__((target("sse4.2")))
+std::size_t
+skip_sse42(const char*& pos, const char* last, std::size_t n)
+noexcept
+{
+  auto remaining = n;
+  // Leading spaces don't end a field.
+  auto after_space = 1u;
+  // Blocks are read from p, pos stays after the space of the last skipped field.
+  auto p = pos;
+  while (remaining != 0 and last - p >= 16)
+  {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    const auto spaces
+      = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(' '))));
+    const auto stop = static_cast<std::uint32_t>(
+      _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(cola::telegram_end))));
+    const auto ends = spaces & ~(spaces << 1 | after_space);
+
+    const auto before = remaining;
+    const auto consumed = skip_block(ends & 0xFFFFu, remaining);
+    if (consumed != 0)
+    {
+      pos = p + consumed;
+      break;
+    }
+    if (stop != 0)
+    {
+      // The end of the telegram is left to the scalar kernel.
+      remaining = before;
+      break;
+    }
+    if (ends != 0)
+    {
+      // A field which isn't followed by a space in this block is left to the next one, or to the
+      // scalar kernel.
+      pos = p + (31 - __builtin_clz(ends)) + 1;
+    }
+    p += 16;
+    after_space = spaces >> 15;
+  }
+  return n - remaining;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+__attribute__((target("avx2")))
+std::size_t
+skip_avx2(const char*& pos, const char* last, std::size_t n)
+noexcept
+{
+  auto remaining = n;
+  // Leading spaces don't end a field.
+  auto after_space = 1u;
+  // Blocks are read from p, pos stays after the space of the last skipped field.
+  auto p = pos;
+  while (remaining != 0 and last - p >= 32)
+  {
+    const auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    const auto spaces = static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '))));
+    const auto stop = static_cast<std::uint32_t>(
+      _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(cola::telegram_end))));
+    const auto ends = spaces & ~(spaces << 1 | after_space);
+
+    const auto before = remaining;
+    const auto consumed = skip_block(ends, remaining);
+    if (consumed != 0)
+    {
+      pos = p + consumed;
+      break;
+    }
+    if (stop != 0)
+    {
+      // The end of the telegram is left to the scalar kernel.
+      remaining = before;
+      break;
+    }
+    if (ends != 0)
+    {
+      // A field which isn't followed by a space in this block is left to the next one, or to the
+      // scalar kernel.
+      pos = p + (31 - __builtin_clz(ends)) + 1;
+    }
+    p += 32;
+    after_space = spaces >> 31;
+  }
+  return n - remaining;
+}
+
+#endif // LMS1XX_HEX_X86
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct kernel
+{
+  kernel_type decode;
+  skip_kernel_type skip;
+  const char* name;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+const kernel&
+selected_kernel()
+noexcept
+{
+  static const auto k = []
+  {
+#ifdef LMS1XX_HEX_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+      return kernel{decode_avx2, skip_avx2, "avx2"};
+    }
+    if (__builtin_cpu_supports("sse4.2"))
+    {
+      return kernel{decode_sse42, skip_sse42, "sse4.2"};
+    }
+#endif
+    return kernel{decode_scalar, skip_scalar, "scalar"};
+  }();
+  return k;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+decode_fields(const char*& pos, const char* last, std::uint16_t* out, std::size_t n)
+noexcept
+{
+  const auto decoded = selected_kernel().decode(pos, last, out, n);
+  // Finish with the scalar kernel when the SIMD one stops close to last.
+  return decoded + decode_scalar(pos, last, out + decoded, n - decoded);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+skip_fields(const char*& pos, const char* last, std::size_t n)
+noexcept
+{
+  const auto skipped = selected_kernel().skip(pos, last, n);
+  return skipped + skip_scalar(pos, last, n - skipped);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const char*
+kernel_name()
+noexcept
+{
+  return selected_kernel().name;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace lms1xx::hex
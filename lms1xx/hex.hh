@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace lms1xx {
+namespace hex {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode consecutive space-separated hexadecimal fields of 1 to 4 digits
+/// @param pos The beginning of the first field, advanced after the space which follows the last
+/// decoded field, and possibly after the following spaces
+/// @param last The end of the bytes to decode
+/// @param out Where to store decoded fields
+/// @param n The maximal number of fields to decode
+/// @return The number of decoded fields
+///
+/// Decoding stops at the first field which is not a run of 1 to 4 hexadecimal digits followed by
+/// a space, or which is too close to last. Such a field, and the following ones, should then be
+/// decoded one by one.
+///
+/// The SIMD kernel used is selected at the first call, depending on the CPU: AVX2, SSE 4.2, or
+/// scalar code.
+std::size_t
+decode_fields(const char*& pos, const char* last, std::uint16_t* out, std::size_t n)
+noexcept;
+
+/// @brief Go over consecutive space-separated fields, without decoding them
+/// @param pos The beginning of the first field, advanced after the space which follows the last
+/// skipped field, and possibly after the following spaces
+/// @param last The end of the bytes to skip
+/// @param n The maximal number of fields to skip
+/// @return The number of skipped fields
+///
+/// Only spaces are looked for, fields are not validated. Skipping stops before a field which is
+/// followed by the end of the telegram rather than by a space.
+std::size_t
+skip_fields(const char*& pos, const char* last, std::size_t n)
+noexcept;
+
+/// @brief The name of the kernel used by decode_fields() and skip_fields(): "avx2", "sse4.2" or
+/// "scalar"
+const char*
+kernel_name()
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+}} // namespace lms1xx::hex
@@ -1,14 +1,21 @@
-#include <algorithm> // copy
-#include <cstdlib>   // strtol
-#include <iomanip>
-#include <memory>    // unique_ptr
-#include <sstream>
+#include <algorithm> // find, min
+#include <chrono>
+#include <ctime>
+#include <future>
+#include <stdexcept>
+#include <thread>
 
 #include <boost/asio/connect.hpp>
-#include <boost/asio/read_until.hpp>
 #include <boost/asio/write.hpp>
 
+#include "lms1xx/cola.hh"
+#include "lms1xx/compact_scan.hh"
 #include "lms1xx/lms1xx.hh"
+#include "lms1xx/parser.hh"
+#include "lms1xx/projector.hh"
+#include "lms1xx/scan_ring.hh"
+#include "lms1xx/scan_view.hh"
+#include "lms1xx/sector_reduction.hh"
 
 namespace lms1xx {
 
@@ -16,44 +23,139 @@ namespace /* unnamed */ {
 
 /*------------------------------------------------------------------------------------------------*/
 
-// To ignore some values when parsing an istream.
-static auto _ = std::string{};
-
 // 256 kB of buffer for incoming data.
 static constexpr auto maximal_buffer_size = 262144ul;
 
-// Separator of ASCII commands.
-static constexpr auto space = " ";
+// Number of bytes requested to the socket by each read.
+static constexpr auto read_size = 65536ul;
+
+// Bounds of the interval between two status requests of LMS1xx::bring_up().
+static constexpr auto first_poll_interval = std::chrono::milliseconds{5};
+static constexpr auto maximal_poll_interval = std::chrono::milliseconds{200};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief CPU time consumed by the calling thread
+std::chrono::nanoseconds
+thread_cpu_time()
+noexcept
+{
+  auto ts = timespec{};
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return std::chrono::seconds{ts.tv_sec} + std::chrono::nanoseconds{ts.tv_nsec};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::string
+login_telegram(protocol p)
+{
+  return cola::writer{p, "sMN", "SetAccessMode"}.field(3, 1, 2).field(0xF4724744, 4).str();
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-// Telegram delimiters.
-static constexpr auto telegram_start = char{0x02};
-static constexpr auto telegram_end   = char{0x03};
+std::string
+scan_data_configuration_telegram(protocol p, const scan_data_configuration& cfg)
+{
+  return cola::writer{p, "sWN", "LMDscandatacfg"}
+           .field(static_cast<std::uint32_t>(cfg.output_channel), 1, 2)
+           .field(0, 1, 2)
+           .field(cfg.remission ? 1 : 0, 1)
+           .field(static_cast<std::uint32_t>(cfg.resolution), 1)
+           .field(0, 1) // Unit
+           .field(static_cast<std::uint32_t>(cfg.encoder), 1, 2)
+           .field(0, 1, 2)
+           .field(cfg.position ? 1 : 0, 1)
+           .field(cfg.device_name ? 1 : 0, 1)
+           .field(0, 1) // Comment
+           .field(cfg.timestamp ? 1 : 0, 1)
+           .signed_field(cfg.output_interval, 2)
+           .str();
+}
 
 /*------------------------------------------------------------------------------------------------*/
 
-inline
+/// @brief Throw the exception matching an error, if any
 void
-build_telegram_impl(std::stringstream& ss)
+throw_on_error(const std::error_code& ec)
 {
-  ss << telegram_end;
+  if (not ec)
+  {
+    return;
+  }
+  if (ec == errc::invalid_telegram)
+  {
+    throw invalid_telegram_error{};
+  }
+  if (ec == errc::timeout)
+  {
+    throw timeout_error{};
+  }
+  throw std::system_error{ec};
 }
 
-template <typename Arg, typename... Args>
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check that the device accepted a command
+/// @param ec Set to errc::command_rejected if the reply is an error (sFA), or reports that the
+/// login or the start of measurements failed, to errc::invalid_telegram if it's malformed
 void
-build_telegram_impl(std::stringstream& ss, Arg&& arg, Args&&... args)
+check_reply(const char* begin, const char* end, std::error_code& ec)
+{
+  try
+  {
+    auto reply = cola::reader{begin, end};
+    if (   reply.type() == "sFA"
+        or (reply.name() == "SetAccessMode" and reply.field(1) == 0)
+        or (reply.name() == "LMCstartmeas" and reply.field(1) != 0)
+        or (reply.name() == "Run" and reply.field(1) == 0))
+    {
+      ec = errc::command_rejected;
+    }
+  }
+  catch (const invalid_telegram_error&)
+  {
+    ec = errc::invalid_telegram;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode the reply to a command
+/// @return A value-initialized T if the reply is malformed, ec being set to errc::invalid_telegram
+template <typename T, typename Parse>
+T
+parse_reply(const char* begin, const char* end, std::error_code& ec, Parse&& parse)
 {
-  ss << arg;
-  build_telegram_impl(ss, std::forward<Args>(args)...);
+  try
+  {
+    auto reply = cola::reader{begin, end};
+    return parse(reply);
+  }
+  catch (const invalid_telegram_error&)
+  {
+    ec = errc::invalid_telegram;
+    return T{};
+  }
 }
 
-template <typename... Args>
-std::string
-build(Args&&... args)
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_header&
+header_of(const scan_data& data)
+noexcept
+{
+  return data.header;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_header&
+header_of(const compact_scan& data)
+noexcept
 {
-  std::stringstream ss;
-  ss << telegram_start;
-  build_telegram_impl(ss, std::forward<Args>(args)...);
-  return ss.str();
+  return data.header();
 }
 
 /*------------------------------------------------------------------------------------------------*/
@@ -62,24 +164,82 @@ build(Args&&... args)
 
 /*------------------------------------------------------------------------------------------------*/
 
-LMS1xx::LMS1xx(const boost::posix_time::time_duration& timeout)
-  : m_io{}
+struct LMS1xx::pending_command
+{
+  /// @brief The name of the command, also the name of its reply
+  std::string name;
+
+  /// @brief The complete reply telegram, or the error which prevented it
+  std::promise<std::string> reply;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::int64_t
+microseconds_since_epoch(const scan_timestamp& t)
+noexcept
+{
+  auto tm = std::tm{};
+  tm.tm_year = t.year - 1900;
+  tm.tm_mon = t.month - 1;
+  tm.tm_mday = t.day;
+  tm.tm_hour = t.hour;
+  tm.tm_min = t.minute;
+  tm.tm_sec = t.second;
+  return static_cast<std::int64_t>(timegm(&tm)) * 1000000 + t.microsecond;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+LMS1xx::LMS1xx(const boost::posix_time::time_duration& timeout, protocol p)
+  : LMS1xx{nullptr, timeout, p, nullptr}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+LMS1xx::LMS1xx( boost::asio::io_service& io, const boost::posix_time::time_duration& timeout
+              , protocol p, buffer_pool* pool)
+  : LMS1xx{&io, timeout, p, pool}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+LMS1xx::LMS1xx( boost::asio::io_service* io, const boost::posix_time::time_duration& timeout
+              , protocol p, buffer_pool* pool)
+  : m_own_io{io ? nullptr : new boost::asio::io_service}
+  , m_io(io ? *io : *m_own_io)
+  , m_strand{m_io}
   , m_socket{m_io}
-  , m_buffer(maximal_buffer_size)
+  , m_buffer{maximal_buffer_size, pool}
   , m_timer{m_io}
   , m_connected{false}
   , m_timeout{timeout}
-{
-  m_buffer.prepare(131072); // reserve 128 kB
-  m_timer.expires_at(boost::posix_time::pos_infin);
-  check_timer();
-}
+  , m_protocol{p}
+  , m_telegram_size{0}
+  , m_streaming{false}
+  , m_scan_handler{}
+  , m_error_handler{}
+  , m_stream_data{}
+  , m_ring{nullptr}
+  , m_telegram_handler{}
+  , m_stream_thread{}
+  , m_pending_commands{}
+  , m_reply{}
+  , m_routed{false}
+  , m_telemetry{}
+  , m_projector{}
+  , m_projector_outdated{true}
+  , m_filtered{false}
+  , m_filter{}
+  , m_reduction{}
+  , m_layout{}
+{}
 
 /*------------------------------------------------------------------------------------------------*/
 
 LMS1xx::LMS1xx( const std::string& host, const std::string& port
-              , const boost::posix_time::time_duration& timeout)
-  : LMS1xx::LMS1xx{timeout}
+              , const boost::posix_time::time_duration& timeout, protocol p)
+  : LMS1xx::LMS1xx{timeout, p}
 {
   connect(host, port);
 }
@@ -88,6 +248,11 @@ LMS1xx::LMS1xx( const std::string& host, const std::string& port
 
 LMS1xx::~LMS1xx()
 {
+  stop_stream();
+  if (m_stream_thread.joinable())
+  {
+    m_stream_thread.join();
+  }
   disconnect();
 }
 
@@ -100,6 +265,12 @@ LMS1xx::connect(const std::string& host, const std::string& port)
   {
     boost::asio::ip::tcp::resolver resolver{m_io};
     boost::asio::connect(m_socket, resolver.resolve({host, port}));
+    // Commands are small telegrams, each one waited for by a reply: don't delay them.
+    m_socket.set_option(boost::asio::ip::tcp::no_delay{true});
+    m_buffer.consume(m_buffer.size());
+    m_telegram_size = 0;
+    m_telemetry.restart();
+    m_projector_outdated = true;
     m_connected = true;
   }
 }
@@ -127,391 +298,1244 @@ const noexcept
 
 /*------------------------------------------------------------------------------------------------*/
 
+protocol
+LMS1xx::get_protocol()
+const noexcept
+{
+  return m_protocol;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
 void
-LMS1xx::check_timer()
+LMS1xx::read(std::error_code& ec)
 {
-  if (m_timer.expires_at() <= boost::asio::deadline_timer::traits_type::now())
+  // The timeout applies to the whole telegram, however many receives it takes.
+  const auto deadline = boost::asio::deadline_timer::traits_type::now() + m_timeout;
+  while (not next_telegram(ec) and not ec)
   {
-    auto ignored_ec = boost::system::error_code{};
-    m_socket.close(ignored_ec);
-    m_connected = false;
-    m_timer.expires_at(boost::posix_time::pos_infin);
-    throw timeout_error{};
+    receive(deadline, ec);
+    if (ec)
+    {
+      return;
+    }
   }
+}
 
-  m_timer.async_wait([this](const boost::system::error_code&)
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::receive(const boost::posix_time::ptime& deadline, std::error_code& ec)
+{
+  auto read_ec = boost::system::error_code{boost::asio::error::would_block};
+  auto len = std::size_t{0};
+  m_socket.async_read_some( receive_buffer()
+                          , [&](const boost::system::error_code& e, std::size_t n)
+                            {
+                              read_ec = e;
+                              len = n;
+                            });
+
+  auto waiting = true;
+  auto expired = false;
+  m_timer.expires_at(deadline);
+  m_timer.async_wait([&](const boost::system::error_code& e)
                      {
-                       check_timer();
+                       waiting = false;
+                       if (e != boost::asio::error::operation_aborted)
+                       {
+                         expired = true;
+                         auto ignored_ec = boost::system::error_code{};
+                         m_socket.cancel(ignored_ec);
+                       }
                      });
+  do
+  {
+    m_io.run_one();
+  }
+  while (read_ec == boost::asio::error::would_block);
+
+  // Both handlers refer to this frame, thus the wait must be complete before returning.
+  m_timer.cancel();
+  while (waiting)
+  {
+    m_io.run_one();
+  }
+  // Running out of work stopped the io_service, make it usable by the next receive or stream.
+  if (m_io.stopped())
+  {
+    m_io.reset();
+  }
+
+  if (read_ec == boost::asio::error::operation_aborted and expired)
+  {
+    auto ignored_ec = boost::system::error_code{};
+    m_socket.close(ignored_ec);
+    m_connected = false;
+    ec = errc::timeout;
+    return;
+  }
+  if (read_ec)
+  {
+    ec = read_ec;
+    return;
+  }
+  m_buffer.commit(len);
+  m_telemetry.received(len);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-void
-LMS1xx::read()
+bool
+LMS1xx::next_telegram(std::error_code& ec)
 {
-  m_buffer.consume(m_buffer.size()); // reset buffer
+  // Forget the previous telegram, but keep the bytes received after it.
+  m_buffer.consume(m_telegram_size);
+  m_telegram_size = 0;
 
-  m_timer.expires_from_now(m_timeout);
-  auto ec = boost::system::error_code{boost::asio::error::would_block};
-  boost::asio::async_read_until( m_socket, m_buffer, telegram_end
-                               , [&](const boost::system::error_code& e, std::size_t)
-                                 {
-                                   ec = e;
-                                 });
+  const auto first = m_buffer.data();
+  auto begin = first;
+  auto end = first;
+  const auto found = cola::find_telegram(first, first + m_buffer.size(), m_protocol, begin, end);
 
-  do
+  // Skip bytes which can't be part of a telegram.
+  if (begin != first)
   {
-    m_io.run_one();
+    m_telemetry.framing_error();
+    m_buffer.consume(static_cast<std::size_t>(begin - first));
+  }
+  if (found)
+  {
+    m_telegram_size = static_cast<std::size_t>(end - begin);
+    return true;
   }
-  while (ec == boost::asio::error::would_block);
 
-  if (*std::istreambuf_iterator<char>{&m_buffer} != telegram_start)
+  if (m_buffer.size() == m_buffer.max_size())
   {
-    throw invalid_telegram_error{};
+    // No complete telegram in a full buffer, start again from scratch.
+    m_telemetry.framing_error();
+    m_buffer.consume(m_buffer.size());
+    ec = errc::invalid_telegram;
   }
+  return false;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-void
-LMS1xx::write(const std::string& telegram)
+boost::asio::mutable_buffers_1
+LMS1xx::receive_buffer()
 {
-  boost::asio::write(m_socket, boost::asio::buffer(telegram));
+  return m_buffer.prepare(std::min(read_size, m_buffer.max_size() - m_buffer.size()));
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::write(const char* telegram, std::size_t len)
+LMS1xx::telegram(const char*& begin, const char*& end)
+const noexcept
 {
-  boost::asio::write(m_socket, boost::asio::buffer(telegram, len));
+  begin = m_buffer.data();
+  end = begin + m_telegram_size;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::start_measurements()
+LMS1xx::write(const std::string& telegram, std::error_code& ec)
 {
-  write(build("sMN", space, "LMCstartmeas"));
-  read();
+  auto write_ec = boost::system::error_code{};
+  boost::asio::write(m_socket, boost::asio::buffer(telegram), write_ec);
+  ec = write_ec;
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::stop_measurements()
+LMS1xx::reply(const char*& begin, const char*& end)
+const noexcept
 {
-  write(build("sMN", space, "LMCstopmeas"));
-  read();
+  if (m_routed)
+  {
+    begin = m_reply.data();
+    end = begin + m_reply.size();
+    return;
+  }
+  telegram(begin, end);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-device_status
-LMS1xx::status()
+void
+LMS1xx::command(const std::string& request, std::error_code& ec)
 {
-  write(build("sRN", space, "STlms"));
-  read();
-
-  auto st = 0;
-  std::istream buffer_stream{&m_buffer};
-  buffer_stream >> _ >> _ >> st;
+  if (m_streaming)
+  {
+    routed_command(request, ec);
+    return;
+  }
 
-  return static_cast<device_status>(st);
+  m_routed = false;
+  write(request, ec);
+  if (ec)
+  {
+    return;
+  }
+  read_reply(ec);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::login()
+LMS1xx::read_reply(std::error_code& ec)
 {
-  write(build("sMN", space, "SetAccessMode", space, "03", space, "F4724744"));
-  read();
+  // Scans sent before the reply, when continuous acquisition is on, are dropped.
+  const auto deadline = std::chrono::steady_clock::now()
+                      + std::chrono::microseconds{m_timeout.total_microseconds()};
+  auto begin = static_cast<const char*>(nullptr);
+  auto end = begin;
+  while (true)
+  {
+    read(ec);
+    if (ec)
+    {
+      return;
+    }
+    telegram(begin, end);
+    if (not cola::is_scan_data(begin, end))
+    {
+      return;
+    }
+    if (std::chrono::steady_clock::now() > deadline)
+    {
+      ec = errc::timeout;
+      return;
+    }
+  }
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-scan_configuration
-LMS1xx::get_configuration()
+void
+LMS1xx::routed_command(const std::string& request, std::error_code& ec)
 {
-  write(build("sRN", space, "LMPscancfg"));
-  read();
+  auto pending = std::make_shared<pending_command>();
+  try
+  {
+    pending->name = cola::reader{request.data(), request.data() + request.size()}.name();
+  }
+  catch (const invalid_telegram_error&)
+  {
+    ec = errc::invalid_telegram;
+    return;
+  }
+  auto reply = pending->reply.get_future();
+
+  // The socket is only written from the strand, which also reads the replies.
+  m_strand.post([this, request, pending]
+                {
+                  auto write_ec = std::error_code{};
+                  if (not m_streaming)
+                  {
+                    write_ec = std::make_error_code(std::errc::operation_canceled);
+                  }
+                  else
+                  {
+                    write(request, write_ec);
+                  }
+                  if (write_ec)
+                  {
+                    pending->reply.set_exception(
+                      std::make_exception_ptr(std::system_error{write_ec}));
+                    return;
+                  }
+                  m_pending_commands.push_back(pending);
+                });
+
+  const auto timeout = std::chrono::microseconds{m_timeout.total_microseconds()};
+  if (reply.wait_for(timeout) != std::future_status::ready)
+  {
+    m_strand.post([this, pending]
+                  {
+                    const auto it = std::find( m_pending_commands.begin()
+                                             , m_pending_commands.end(), pending);
+                    if (it != m_pending_commands.end())
+                    {
+                      m_pending_commands.erase(it);
+                    }
+                  });
+    ec = errc::timeout;
+    return;
+  }
+
+  try
+  {
+    m_reply = reply.get();
+    m_routed = true;
+    ec.clear();
+  }
+  catch (const std::system_error& e)
+  {
+    ec = e.code();
+  }
+}
 
-  auto scaning_frequency = unsigned{};
-  auto angle_resolution = unsigned{};
-  auto start_angle = unsigned{};
-  auto stop_angle = unsigned{};
+/*------------------------------------------------------------------------------------------------*/
 
-  /// @todo Check if parsing went OK
-  std::istream{&m_buffer}
-    >> _
-    >> _
-    >> std::hex >> scaning_frequency
-    >> _
-    >> std::hex >> angle_resolution
-    >> std::hex >> start_angle
-    >> std::hex >> stop_angle;
+bool
+LMS1xx::route_reply()
+{
+  auto begin = static_cast<const char*>(nullptr);
+  auto end = begin;
+  telegram(begin, end);
+  if (cola::is_scan_data(begin, end))
+  {
+    return false;
+  }
 
-  return { static_cast<int>(scaning_frequency)
-         , static_cast<int>(angle_resolution)
-         , static_cast<int>(start_angle)
-         , static_cast<int>(stop_angle)};
+  try
+  {
+    const auto r = cola::reader{begin, end};
+    // Errors (sFA) don't tell which command failed, they answer the oldest one.
+    auto it = m_pending_commands.begin();
+    if (r.type() != "sFA")
+    {
+      while (it != m_pending_commands.end() and (*it)->name != r.name())
+      {
+        ++it;
+      }
+    }
+    if (it == m_pending_commands.end())
+    {
+      return false;
+    }
+    (*it)->reply.set_value(std::string{begin, end});
+    m_pending_commands.erase(it);
+    return true;
+  }
+  catch (const invalid_telegram_error&)
+  {
+    return false;
+  }
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::set_scan_configuration(const scan_configuration& cfg)
+LMS1xx::cancel_commands(const std::error_code& ec)
+noexcept
 {
-  /// @todo Use build
-  char buf[512];
-  sprintf(buf, "%c%s %X +1 %X %X %X%c", telegram_start, "sMN mLMPsetscancfg",
-          cfg.scaning_frequency, cfg.angle_resolution, cfg.start_angle,
-          cfg.stop_angle, telegram_end);
-
-  write(buf, strlen(buf));
-  read();
+  for (const auto& pending : m_pending_commands)
+  {
+    pending->reply.set_exception(std::make_exception_ptr(std::system_error{ec}));
+  }
+  m_pending_commands.clear();
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::set_scan_data_configuration(const scan_data_configuration& cfg)
+LMS1xx::pipeline(const std::string& telegrams, std::size_t nb_replies, std::error_code& ec)
 {
-  /// @todo Use build
-  char buf[512];
-  sprintf(buf, "%c%s %02X 00 %d %d 0 %02X 00 %d %d 0 %d +%d%c", telegram_start,
-      "sWN LMDscandatacfg", cfg.output_channel, cfg.remission ? 1 : 0,
-      cfg.resolution, cfg.encoder, cfg.position ? 1 : 0,
-      cfg.device_name ? 1 : 0, cfg.timestamp ? 1 : 0, cfg.output_interval, telegram_end);
+  // While streaming, the socket is read by the strand, which routes replies one command at a time.
+  if (m_streaming)
+  {
+    ec = std::make_error_code(std::errc::operation_in_progress);
+    return;
+  }
 
-  write(buf, strlen(buf));
-  read();
+  m_routed = false;
+  write(telegrams, ec);
+  for (auto i = std::size_t{0}; i < nb_replies and not ec; ++i)
+  {
+    read_reply(ec);
+    if (not ec)
+    {
+      auto begin = static_cast<const char*>(nullptr);
+      auto end = begin;
+      telegram(begin, end);
+      check_reply(begin, end, ec);
+    }
+  }
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-scan_output_range
-LMS1xx::get_scan_output_range()
+void
+LMS1xx::start_measurements()
 {
-  write(build("sRN", space, "LMPoutputRange"));
-  read();
+  auto ec = std::error_code{};
+  start_measurements(ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
 
-  auto angle_resolution = unsigned{};
-  auto start_angle = unsigned{};
-  auto stop_angle = unsigned{};  
+void
+LMS1xx::start_measurements(std::error_code& ec)
+{
+  command(cola::writer{m_protocol, "sMN", "LMCstartmeas"}.str(), ec);
+}
 
-  /// @todo Check if parsing went OK
-  std::istream{&m_buffer}
-    >> _
-    >> _
-    >> _
-    >> std::hex >> angle_resolution
-    >> std::hex >> start_angle
-    >> std::hex >> stop_angle;
+/*------------------------------------------------------------------------------------------------*/
 
-  return { static_cast<int>(angle_resolution)
-         , static_cast<int>(start_angle)
-         , static_cast<int>(stop_angle)};
+void
+LMS1xx::stop_measurements()
+{
+  auto ec = std::error_code{};
+  stop_measurements(ec);
+  throw_on_error(ec);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::scan_continous(bool start)
+LMS1xx::stop_measurements(std::error_code& ec)
 {
-  write(build("sEN", space, "LMDscandata", space, start ? 1 : 0));
-  read();
+  command(cola::writer{m_protocol, "sMN", "LMCstopmeas"}.str(), ec);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
-scan_data
-LMS1xx::get_data()
+device_status
+LMS1xx::status()
 {
-  read();
-
-  /// @todo Directly read from the streambuf
-  const auto sz = m_buffer.size();
-  auto buf = std::unique_ptr<char[]>(new char[sz]);
-  std::copy(std::istreambuf_iterator<char>{&m_buffer}, std::istreambuf_iterator<char>{}, buf.get());
-  buf[sz - 1] = '\0';
-
-  /// @todo Rewrite parsing
-  char* tok;
-
-  strtok(buf.get(), " "); //Type of command
-  strtok(NULL, " "); //Command
-  strtok(NULL, " "); //VersionNumber
-  strtok(NULL, " "); //DeviceNumber
-  strtok(NULL, " "); //Serial number
-  strtok(NULL, " "); //DeviceStatus
-  strtok(NULL, " "); //MessageCounter
-  strtok(NULL, " "); //ScanCounter
-  strtok(NULL, " "); //PowerUpDuration
-  strtok(NULL, " "); //TransmissionDuration
-  strtok(NULL, " "); //InputStatus
-  strtok(NULL, " "); //OutputStatus
-  strtok(NULL, " "); //ReservedByteA
-  strtok(NULL, " "); //ScanningFrequency
-  strtok(NULL, " "); //MeasurementFrequency
-  strtok(NULL, " ");
-  strtok(NULL, " ");
-  strtok(NULL, " ");
-  tok = strtok(NULL, " "); //NumberEncoders
-  int NumberEncoders;
-  sscanf(tok, "%d", &NumberEncoders);
-
-  for (auto i = 0; i < NumberEncoders; ++i)
-  {
-    strtok(NULL, " "); //EncoderPosition
-    strtok(NULL, " "); //EncoderSpeed
-  }
-
-  tok = strtok(NULL, " "); //NumberChannels16Bit
-  int NumberChannels16Bit;
-  sscanf(tok, "%d", &NumberChannels16Bit);
+  auto ec = std::error_code{};
+  const auto result = status(ec);
+  throw_on_error(ec);
+  return result;
+}
 
-  auto data = scan_data{};
+/*------------------------------------------------------------------------------------------------*/
 
-  for (auto i = 0; i < NumberChannels16Bit; ++i)
+device_status
+LMS1xx::status(std::error_code& ec)
+{
+  command(cola::writer{m_protocol, "sRN", "STlms"}.str(), ec);
+  if (ec)
   {
-    int type = -1; // 0 DIST1 1 DIST2 2 RSSI1 3 RSSI2
-    char content[6];
-    tok = strtok(NULL, " "); //MeasuredDataContent
-    sscanf(tok, "%s", content);
-    if (!strcmp(content, "DIST1"))
-    {
-      type = 0;
-    }
-    else if (!strcmp(content, "DIST2"))
-    {
-      type = 1;
-    }
-    else if (!strcmp(content, "RSSI1"))
-    {
-      type = 2;
-    }
-    else if (!strcmp(content, "RSSI2"))
-    {
-      type = 3;
-    }
-    strtok(NULL, " "); //ScalingFactor
-    strtok(NULL, " "); //ScalingOffset
-    strtok(NULL, " "); //Starting angle
-    strtok(NULL, " "); //Angular step width
-    tok = strtok(NULL, " "); //NumberData
-    int NumberData;
-    sscanf(tok, "%X", &NumberData);
-
-    if (type == 0)
-    {
-      data.dist_len1 = NumberData;
-    }
-    else if (type == 1)
-    {
-      data.dist_len2 = NumberData;
-    }
-    else if (type == 2)
-    {
-      data.rssi_len1 = NumberData;
-    }
-    else if (type == 3)
-    {
-      data.rssi_len2 = NumberData;
-    }
+    return device_status::undefined;
+  }
 
-    for (auto i = 0; i < NumberData; ++i)
-    {
-      char* end;
-      tok = strtok(NULL, " "); //data
-      const auto dat = ::strtol(tok, &end, 16);
-
-      if (type == 0) {
-        data.dist1[i] = dat;
-      } else if (type == 1) {
-        data.dist2[i] = dat;
-      } else if (type == 2) {
-        data.rssi1[i] = dat;
-      } else if (type == 3) {
-        data.rssi2[i] = dat;
-      }
+  auto begin = static_cast<const char*>(nullptr);
+  auto end = begin;
+  reply(begin, end);
+  return parse_reply<device_status>(begin, end, ec, [](cola::reader& reply)
+                                    {
+                                      return static_cast<device_status>(reply.field(2));
+                                    });
+}
 
-    }
-  }
+/*------------------------------------------------------------------------------------------------*/
 
-  tok = strtok(NULL, " "); //NumberChannels8Bit
-  int NumberChannels8Bit;
-  sscanf(tok, "%d", &NumberChannels8Bit);
-
-  for (int i = 0; i < NumberChannels8Bit; i++) {
-    int type = -1;
-    char content[6];
-    tok = strtok(NULL, " "); //MeasuredDataContent
-    sscanf(tok, "%s", content);
-    if (!strcmp(content, "DIST1")) {
-      type = 0;
-    } else if (!strcmp(content, "DIST2")) {
-      type = 1;
-    } else if (!strcmp(content, "RSSI1")) {
-      type = 2;
-    } else if (!strcmp(content, "RSSI2")) {
-      type = 3;
-    }
-    strtok(NULL, " "); //ScalingFactor
-    strtok(NULL, " "); //ScalingOffset
-    strtok(NULL, " "); //Starting angle
-    strtok(NULL, " "); //Angular step width
-    tok = strtok(NULL, " "); //NumberData
-    int NumberData;
-    sscanf(tok, "%X", &NumberData);
-
-    if (type == 0) {
-      data.dist_len1 = NumberData;
-    } else if (type == 1) {
-      data.dist_len2 = NumberData;
-    } else if (type == 2) {
-      data.rssi_len1 = NumberData;
-    } else if (type == 3) {
-      data.rssi_len2 = NumberData;
-    }
-    for (int i = 0; i < NumberData; i++) {
-      int dat;
-      tok = strtok(NULL, " "); //data
-      sscanf(tok, "%X", &dat);
-
-      if (type == 0) {
-        data.dist1[i] = dat;
-      } else if (type == 1) {
-        data.dist2[i] = dat;
-      } else if (type == 2) {
-        data.rssi1[i] = dat;
-      } else if (type == 3) {
-        data.rssi2[i] = dat;
-      }
-    }
+void
+LMS1xx::login()
+{
+  auto ec = std::error_code{};
+  login(ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::login(std::error_code& ec)
+{
+  command(login_telegram(m_protocol), ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_configuration
+LMS1xx::get_configuration()
+{
+  auto ec = std::error_code{};
+  const auto cfg = get_configuration(ec);
+  throw_on_error(ec);
+  return cfg;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_configuration
+LMS1xx::get_configuration(std::error_code& ec)
+{
+  command(cola::writer{m_protocol, "sRN", "LMPscancfg"}.str(), ec);
+  if (ec)
+  {
+    return {};
   }
 
-  return data;
+  auto begin = static_cast<const char*>(nullptr);
+  auto end = begin;
+  reply(begin, end);
+  return parse_reply<scan_configuration>(begin, end, ec, [](cola::reader& reply)
+                                         {
+                                           auto cfg = scan_configuration{};
+                                           cfg.scaning_frequency = static_cast<int>(reply.field(4));
+                                           reply.signed_field(2); // Number of sectors
+                                           cfg.angle_resolution = static_cast<int>(reply.field(4));
+                                           cfg.start_angle = reply.signed_field(4);
+                                           cfg.stop_angle = reply.signed_field(4);
+                                           return cfg;
+                                         });
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::save_configuration()
+LMS1xx::set_scan_configuration(const scan_configuration& cfg)
 {
-  write(build("sMN", space, "mEEwriteall"));
-  read();
+  auto ec = std::error_code{};
+  set_scan_configuration(cfg, ec);
+  throw_on_error(ec);
 }
 
 /*------------------------------------------------------------------------------------------------*/
 
 void
-LMS1xx::start_device()
+LMS1xx::set_scan_configuration(const scan_configuration& cfg, std::error_code& ec)
 {
-  write(build("sMN", space, "Run"));
-  read();
+  command(cola::writer{m_protocol, "sMN", "mLMPsetscancfg"}
+            .field(static_cast<std::uint32_t>(cfg.scaning_frequency), 4)
+            .signed_field(1, 2) // Number of sectors
+            .field(static_cast<std::uint32_t>(cfg.angle_resolution), 4)
+            .field(static_cast<std::uint32_t>(cfg.start_angle), 4)
+            .field(static_cast<std::uint32_t>(cfg.stop_angle), 4)
+            .str()
+         , ec);
+  // Even if the reply is lost, the configuration may have been applied.
+  m_projector_outdated = true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::set_scan_data_configuration(const scan_data_configuration& cfg)
+{
+  auto ec = std::error_code{};
+  set_scan_data_configuration(cfg, ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::set_scan_data_configuration(const scan_data_configuration& cfg, std::error_code& ec)
+{
+  command(scan_data_configuration_telegram(m_protocol, cfg), ec);
+  if (not ec)
+  {
+    auto begin = static_cast<const char*>(nullptr);
+    auto end = begin;
+    reply(begin, end);
+    check_reply(begin, end, ec);
+  }
+  set_layout(cfg, ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::set_layout(const scan_data_configuration& cfg, const std::error_code& ec)
+{
+  // Without a reply, the layout of telegrams is unknown.
+  auto layout = ec ? nullptr : std::make_shared<const layout_parser>(cfg, m_protocol);
+  if (m_streaming)
+  {
+    // Scans are decoded on the strand while streaming.
+    m_strand.post([this, layout]{ m_layout = layout; });
+  }
+  else
+  {
+    m_layout = std::move(layout);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_output_range
+LMS1xx::get_scan_output_range()
+{
+  auto ec = std::error_code{};
+  const auto range = get_scan_output_range(ec);
+  throw_on_error(ec);
+  return range;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_output_range
+LMS1xx::get_scan_output_range(std::error_code& ec)
+{
+  command(cola::writer{m_protocol, "sRN", "LMPoutputRange"}.str(), ec);
+  if (ec)
+  {
+    return {};
+  }
+
+  auto begin = static_cast<const char*>(nullptr);
+  auto end = begin;
+  reply(begin, end);
+  return parse_reply<scan_output_range>(begin, end, ec, [](cola::reader& reply)
+                                        {
+                                          auto range = scan_output_range{};
+                                          reply.field(2); // Number of sectors
+                                          range.angle_resolution = static_cast<int>(reply.field(4));
+                                          range.start_angle = reply.signed_field(4);
+                                          range.stop_angle = reply.signed_field(4);
+                                          return range;
+                                        });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const projector&
+LMS1xx::get_projector()
+{
+  if (m_projector_outdated or not m_projector)
+  {
+    const auto range = m_filtered ? filter_range(get_scan_output_range(), m_filter)
+                                  : get_scan_output_range();
+    if (m_projector)
+    {
+      m_projector->set_range(range);
+    }
+    else
+    {
+      m_projector.reset(new projector{range});
+    }
+    m_projector_outdated = false;
+  }
+  return *m_projector;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::scan_continous(bool start)
+{
+  auto ec = std::error_code{};
+  scan_continous(start, ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::scan_continous(bool start, std::error_code& ec)
+{
+  command(cola::writer{m_protocol, "sEN", "LMDscandata"}.field(start ? 1 : 0, 1).str(), ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::set_scan_filter(const scan_filter& filter)
+{
+  m_filter = filter;
+  m_filtered = true;
+  m_projector_outdated = true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::clear_scan_filter()
+{
+  m_filtered = false;
+  m_projector_outdated = true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const sector_reduction&
+LMS1xx::set_sector_reduction(std::vector<sector> sectors, sector_handler handler)
+{
+  m_reduction.reset(new sector_reduction{std::move(sectors), std::move(handler)});
+  return *m_reduction;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::clear_sector_reduction()
+{
+  m_reduction.reset();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::shared_ptr<const layout_parser>
+LMS1xx::get_layout_parser()
+const noexcept
+{
+  return m_layout;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Scan>
+void
+LMS1xx::decode(Scan& data, std::error_code& ec)
+{
+  auto begin = static_cast<const char*>(nullptr);
+  auto end = begin;
+  telegram(begin, end);
+
+  const auto start = std::chrono::steady_clock::now();
+  if (m_layout and not m_reduction and not m_filtered)
+  {
+    m_layout->parse(begin, end, data, ec);
+  }
+  else
+  {
+    const auto options = parse_options{m_filtered ? &m_filter : nullptr, m_reduction.get()};
+    parse_scan_data(begin, end, data, options, ec);
+  }
+  if (ec)
+  {
+    m_telemetry.framing_error();
+    return;
+  }
+  m_telemetry.scan(header_of(data), std::chrono::steady_clock::now() - start);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_data
+LMS1xx::get_data()
+{
+  auto data = scan_data{};
+  get_data(data);
+  return data;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::get_data(scan_data& data)
+{
+  auto ec = std::error_code{};
+  get_data(data, ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::get_data(compact_scan& data)
+{
+  auto ec = std::error_code{};
+  get_data(data, ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::get_data(scan_data& data, std::error_code& ec)
+{
+  read(ec);
+  if (not ec)
+  {
+    decode(data, ec);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::get_data(compact_scan& data, std::error_code& ec)
+{
+  read(ec);
+  if (not ec)
+  {
+    decode(data, ec);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::get_data(scan_view& view)
+{
+  auto ec = std::error_code{};
+  get_data(view, ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::get_data(scan_view& view, std::error_code& ec)
+{
+  read(ec);
+  if (ec)
+  {
+    return;
+  }
+
+  auto begin = static_cast<const char*>(nullptr);
+  auto end = begin;
+  telegram(begin, end);
+
+  const auto start = std::chrono::steady_clock::now();
+  view.reset(begin, end, ec);
+  if (ec)
+  {
+    m_telemetry.framing_error();
+    return;
+  }
+  m_telemetry.scan(view.header(), std::chrono::steady_clock::now() - start);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::start_stream(scan_handler handler, error_handler on_error)
+{
+  m_scan_handler = std::move(handler);
+  m_ring = nullptr;
+  m_telegram_handler = nullptr;
+  start_stream_thread(std::move(on_error));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::start_stream(scan_ring& ring, error_handler on_error)
+{
+  if (ring.policy() == overflow_policy::block and not m_own_io)
+  {
+    throw std::logic_error{"A blocking scan_ring can't be used with an external io_service"};
+  }
+  m_scan_handler = nullptr;
+  m_ring = &ring;
+  m_telegram_handler = nullptr;
+  start_stream_thread(std::move(on_error));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::start_telegram_stream(telegram_handler handler, error_handler on_error)
+{
+  m_scan_handler = nullptr;
+  m_ring = nullptr;
+  m_telegram_handler = std::move(handler);
+  start_stream_thread(std::move(on_error));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::start_stream_thread(error_handler on_error)
+{
+  if (m_stream_thread.joinable())
+  {
+    m_stream_thread.join();
+  }
+
+  m_error_handler = std::move(on_error);
+  m_streaming = true;
+  m_strand.post([this]{ stream_receive(); });
+
+  if (not m_own_io)
+  {
+    return;
+  }
+
+  m_stream_thread = std::thread{[this]
+  {
+    try
+    {
+      m_io.run();
+    }
+    catch (...)
+    {
+      stream_error(std::current_exception());
+    }
+    m_io.reset();
+  }};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::run_stream(scan_handler handler)
+{
+  if (not m_own_io)
+  {
+    throw std::logic_error{"run_stream() can't be used with an external io_service"};
+  }
+
+  auto error = std::exception_ptr{};
+  m_scan_handler = std::move(handler);
+  m_ring = nullptr;
+  m_telegram_handler = nullptr;
+  m_error_handler = [&error](std::exception_ptr e){ error = e; };
+  m_streaming = true;
+  m_strand.post([this]{ stream_receive(); });
+
+  try
+  {
+    m_io.run();
+  }
+  catch (...)
+  {
+    m_streaming = false;
+    m_io.reset();
+    throw;
+  }
+  m_io.reset();
+
+  if (error)
+  {
+    std::rethrow_exception(error);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::stop_stream()
+{
+  if (m_own_io)
+  {
+    // The I/O thread is also joined when an error has already stopped streaming.
+    if (m_streaming)
+    {
+      m_strand.post([this]{ halt_stream(); });
+    }
+    if (m_stream_thread.joinable() and m_stream_thread.get_id() != std::this_thread::get_id())
+    {
+      m_stream_thread.join();
+    }
+    return;
+  }
+
+  if (not m_streaming)
+  {
+    return;
+  }
+
+  if (m_strand.running_in_this_thread() or m_io.stopped())
+  {
+    halt_stream();
+    return;
+  }
+
+  // Wait for a thread of the external io_service to stop the stream.
+  auto halted = std::promise<void>{};
+  m_strand.post([this, &halted]
+                {
+                  halt_stream();
+                  halted.set_value();
+                });
+  halted.get_future().wait();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::stream_error(std::exception_ptr error)
+{
+  if (halt_stream() and m_error_handler)
+  {
+    m_error_handler(error);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+LMS1xx::halt_stream()
+noexcept
+{
+  // Streaming may have been stopped by an error in the meantime.
+  if (not m_streaming.exchange(false))
+  {
+    return false;
+  }
+
+  cancel_commands(std::make_error_code(std::errc::operation_canceled));
+  auto ignored_ec = boost::system::error_code{};
+  m_socket.cancel(ignored_ec);
+  m_timer.cancel(ignored_ec);
+  if (m_own_io)
+  {
+    m_io.stop();
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+LMS1xx::streaming()
+const noexcept
+{
+  return m_streaming;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::stream_receive()
+{
+  const auto cpu_start = thread_cpu_time();
+  try
+  {
+    while (m_streaming)
+    {
+      auto ec = std::error_code{};
+      if (not next_telegram(ec))
+      {
+        if (ec)
+        {
+          continue;
+        }
+        break;
+      }
+      // Replies are only looked for while commands are pending.
+      if (not m_pending_commands.empty() and route_reply())
+      {
+        continue;
+      }
+      if (m_telegram_handler)
+      {
+        deliver_telegram();
+        continue;
+      }
+      // An invalid telegram leaves the slot of the ring to the next one.
+      decode(m_ring ? m_ring->acquire_write() : m_stream_data, ec);
+      if (ec)
+      {
+        continue;
+      }
+
+      if (m_ring)
+      {
+        m_ring->commit_write();
+      }
+      else
+      {
+        m_scan_handler(m_stream_data);
+      }
+    }
+  }
+  catch (...)
+  {
+    // Thrown by the scan handler.
+    stream_error(std::current_exception());
+  }
+  m_telemetry.cpu_time(thread_cpu_time() - cpu_start);
+
+  if (not m_streaming)
+  {
+    return;
+  }
+
+  // Each wait has its own deadline, cancelled as soon as bytes are available.
+  m_timer.expires_from_now(m_timeout);
+  m_timer.async_wait(m_strand.wrap([this](const boost::system::error_code& ec)
+                     {
+                       // The deadline may have been moved by a following wait before this
+                       // handler could run.
+                       const auto now = boost::asio::deadline_timer::traits_type::now();
+                       if (not m_streaming or ec == boost::asio::error::operation_aborted
+                           or m_timer.expires_at() > now)
+                       {
+                         return;
+                       }
+                       auto ignored_ec = boost::system::error_code{};
+                       m_socket.close(ignored_ec);
+                       m_connected = false;
+                       stream_error(std::make_exception_ptr(timeout_error{}));
+                     }));
+
+  // Storage is only taken from the buffer pool once bytes are available.
+  m_socket.async_wait( boost::asio::ip::tcp::socket::wait_read
+                     , m_strand.wrap([this](boost::system::error_code ec)
+                       {
+                         // Waits are cancelled by stop_stream().
+                         if (not m_streaming or ec == boost::asio::error::operation_aborted)
+                         {
+                           return;
+                         }
+                         auto ignored_ec = boost::system::error_code{};
+                         m_timer.cancel(ignored_ec);
+                         auto n = std::size_t{0};
+                         if (not ec)
+                         {
+                           n = m_socket.read_some(receive_buffer(), ec);
+                         }
+                         if (ec)
+                         {
+                           stream_error(std::make_exception_ptr(std::system_error{ec}));
+                           return;
+                         }
+                         m_buffer.commit(n);
+                         m_telemetry.received(n);
+                         stream_receive();
+                       }));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::deliver_telegram()
+{
+  auto begin = static_cast<const char*>(nullptr);
+  auto end = begin;
+  telegram(begin, end);
+  // Any other telegram would fail to decode.
+  if (not cola::is_scan_data(begin, end))
+  {
+    m_telemetry.framing_error();
+    return;
+  }
+  m_telegram_handler(begin, end);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+statistics
+LMS1xx::get_statistics()
+const noexcept
+{
+  return m_telemetry.snapshot();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::reset_statistics()
+noexcept
+{
+  m_telemetry.reset();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::save_configuration()
+{
+  auto ec = std::error_code{};
+  save_configuration(ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::save_configuration(std::error_code& ec)
+{
+  command(cola::writer{m_protocol, "sMN", "mEEwriteall"}.str(), ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::start_device()
+{
+  auto ec = std::error_code{};
+  start_device(ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+LMS1xx::start_device(std::error_code& ec)
+{
+  command(cola::writer{m_protocol, "sMN", "Run"}.str(), ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+LMS1xx::wait_ready(const boost::posix_time::time_duration& timeout, std::error_code& ec)
+{
+  const auto deadline
+    = std::chrono::steady_clock::now() + std::chrono::microseconds{timeout.total_microseconds()};
+  auto interval = first_poll_interval;
+  auto polls = std::size_t{0};
+  while (true)
+  {
+    ++polls;
+    if (status(ec) == device_status::ready_for_measurement or ec)
+    {
+      return polls;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= deadline)
+    {
+      ec = errc::timeout;
+      return polls;
+    }
+    // Don't sleep past the deadline, it would delay the last request.
+    std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>( interval
+                                                                              , deadline - now));
+    interval = std::min(interval * 2, maximal_poll_interval);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bring_up_report
+LMS1xx::bring_up( const scan_data_configuration& cfg
+                , const boost::posix_time::time_duration& ready_timeout)
+{
+  auto ec = std::error_code{};
+  const auto report = bring_up(cfg, ec, ready_timeout);
+  throw_on_error(ec);
+  return report;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bring_up_report
+LMS1xx::bring_up( const scan_data_configuration& cfg, std::error_code& ec
+                , const boost::posix_time::time_duration& ready_timeout)
+{
+  auto report = bring_up_report{};
+  const auto start = std::chrono::steady_clock::now();
+  auto phase_start = start;
+  const auto end_phase = [&](std::chrono::nanoseconds& phase)
+  {
+    const auto now = std::chrono::steady_clock::now();
+    phase = now - phase_start;
+    report.total = now - start;
+    phase_start = now;
+  };
+
+  // The device handles commands in order, thus the configuration is applied before measurements
+  // are started, even if they are sent without waiting for the replies.
+  pipeline( login_telegram(m_protocol)
+          + scan_data_configuration_telegram(m_protocol, cfg)
+          + cola::writer{m_protocol, "sMN", "LMCstartmeas"}.str()
+          , 3, ec);
+  set_layout(cfg, ec);
+  end_phase(report.configuration);
+  if (ec)
+  {
+    return report;
+  }
+
+  report.status_polls = wait_ready(ready_timeout, ec);
+  end_phase(report.ready);
+  if (ec)
+  {
+    return report;
+  }
+
+  pipeline( cola::writer{m_protocol, "sMN", "Run"}.str()
+          + cola::writer{m_protocol, "sEN", "LMDscandata"}.field(1, 1).str()
+          , 2, ec);
+  end_phase(report.start);
+  return report;
 }
 
 /*------------------------------------------------------------------------------------------------*/
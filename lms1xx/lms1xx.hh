@@ -1,13 +1,27 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
 #include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
 
 #include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/io_context_strand.hpp>
 #include <boost/asio/io_service.hpp>
-#include <boost/asio/streambuf.hpp>
 #include <boost/asio/ip/tcp.hpp>
 
+#include "lms1xx/error.hh"
+#include "lms1xx/telegram_buffer.hh"
+#include "lms1xx/telemetry.hh"
+
 namespace lms1xx {
 
 /*------------------------------------------------------------------------------------------------*/
@@ -78,32 +92,112 @@ struct scan_data_configuration
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Maximal number of samples of a channel
+///
+/// 0.25 degree resolution over 270 degrees, plus one point.
+static constexpr auto max_samples = std::size_t{1082};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Date and time of a scan, as given by the clock of the device
+struct scan_timestamp
+{
+  uint16_t year;
+  uint8_t month;
+  uint8_t day;
+  uint8_t hour;
+  uint8_t minute;
+  uint8_t second;
+  uint32_t microsecond;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Microseconds elapsed since epoch at a timestamp, which is in UTC
+std::int64_t
+microseconds_since_epoch(const scan_timestamp& t)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Structure containing the fields of a scan message which precede and follow measurements
+struct scan_header
+{
+  /// @brief Version of the telegram
+  uint16_t version;
+
+  /// @brief Device number, as defined by the user
+  uint16_t device_number;
+
+  /// @brief Serial number of the device
+  uint32_t serial_number;
+
+  /// @brief Device status, first byte in the high bits
+  uint16_t status;
+
+  /// @brief Number of telegrams sent by the device since it started measuring
+  ///
+  /// Wraps around after 65535.
+  uint16_t message_counter;
+
+  /// @brief Number of scans made by the device, including the ones not output
+  ///
+  /// Wraps around after 65535.
+  uint16_t scan_counter;
+
+  /// @brief Time since power-up when the scan was completed, in microseconds
+  uint32_t power_up_duration;
+
+  /// @brief Time since power-up when the telegram was sent, in microseconds
+  uint32_t transmission_duration;
+
+  /// @brief Scanning frequency in 1/100 Hz
+  uint32_t scanning_frequency;
+
+  /// @brief Measurement frequency in 100 Hz
+  uint32_t measurement_frequency;
+
+  /// @brief True if timestamp is set
+  ///
+  /// Set when timestamps are enabled in the scan data configuration. Not decoded when the
+  /// telegram also contains the position, the name or the comment of the device.
+  bool has_timestamp;
+
+  /// @brief Time of the scan
+  scan_timestamp timestamp;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @brief Structure containing single scan message.
 struct scan_data
 {
+  /// @brief Header of the telegram
+  scan_header header;
+
   /// @brief Number of samples in dist1.
   int dist_len1;
 
   /// @brief Radial distance for the first reflected pulse
-  uint16_t dist1[1082];
+  uint16_t dist1[max_samples];
 
   /// @brief Number of samples in dist2.
   int dist_len2;
 
   /// @brief Radial distance for the second reflected pulse
-  uint16_t dist2[1082];
+  uint16_t dist2[max_samples];
 
   /// @brief Number of samples in rssi1.
   int rssi_len1;
 
   /// @brief Remission values for the first reflected pulse
-  uint16_t rssi1[1082];
+  uint16_t rssi1[max_samples];
 
   /// @brief Number of samples in rssi2.
   int rssi_len2;
 
   /// @brief Remission values for the second reflected pulse
-  uint16_t rssi2[1082];
+  uint16_t rssi2[max_samples];
 };
 
 /*------------------------------------------------------------------------------------------------*/
@@ -123,6 +217,97 @@ struct scan_output_range
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief The measured data channels of a scan
+enum class channel
+{
+  /// @brief Radial distance for the first reflected pulse
+  dist1 = 0
+  /// @brief Radial distance for the second reflected pulse
+, dist2 = 1
+  /// @brief Remission values for the first reflected pulse
+, rssi1 = 2
+  /// @brief Remission values for the second reflected pulse
+, rssi2 = 3
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The bit of a channel in scan_filter::channels
+constexpr
+unsigned
+channel_bit(channel c)
+noexcept
+{
+  return 1u << static_cast<unsigned>(c);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief All bits of scan_filter::channels
+static constexpr auto all_channels = 0xFu;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Select the samples of scans to decode
+///
+/// Samples outside the angular window, between the samples kept by the stride, and the ones of
+/// channels absent from the mask are skipped without being decoded. A kept channel thus holds
+/// the samples at start + i * stride, start being the first sample of the window.
+struct scan_filter
+{
+  /// @brief Angle of the first kept sample, in 1/10000 degree
+  int start_angle;
+
+  /// @brief Angle of the last kept sample, in 1/10000 degree
+  int stop_angle;
+
+  /// @brief Keep one sample every stride samples, 0 is the same as 1
+  unsigned stride;
+
+  /// @brief Channels to decode, as a combination of channel_bit()
+  unsigned channels;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief An angular sector, bounds included
+struct sector
+{
+  /// @brief First angle of the sector, in 1/10000 degree as in scan_output_range
+  int start_angle;
+
+  /// @brief Last angle of the sector, in 1/10000 degree as in scan_output_range
+  int stop_angle;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The closest echo of DIST1 in a sector
+struct sector_minimum
+{
+  /// @brief Index of the sector in the configuration of the reduction
+  std::size_t sector;
+
+  /// @brief Smallest distance, 0 if no sample of the sector has an echo
+  std::uint16_t distance;
+
+  /// @brief Index of the closest sample in the decoded DIST1 channel, if distance isn't 0
+  std::size_t sample;
+
+  /// @brief Angle of the closest sample in 1/10000 degree, if distance isn't 0
+  int angle;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Called for each sector as soon as its samples are decoded
+///
+/// The header is complete, except for the timestamp which follows the samples in the telegram.
+/// Called while the telegram is decoded, thus must not throw.
+using sector_handler = std::function<void (const scan_header&, const sector_minimum&)>;
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @brief Describe LMS1xx possible statuses
 enum class device_status
 {
@@ -138,6 +323,38 @@ enum class device_status
 
 /*------------------------------------------------------------------------------------------------*/
 
+/// @brief Time spent in each phase of LMS1xx::bring_up()
+struct bring_up_report
+{
+  /// @brief Login, scan data configuration and start of measurements, sent at once
+  std::chrono::nanoseconds configuration;
+
+  /// @brief Waiting for the device to be ready for measurement
+  std::chrono::nanoseconds ready;
+
+  /// @brief Number of status requests sent while waiting for the device
+  std::size_t status_polls;
+
+  /// @brief Return to the measurement mode and start of continuous acquisition, sent at once
+  std::chrono::nanoseconds start;
+
+  /// @brief Whole bring-up
+  std::chrono::nanoseconds total;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Protocols used to communicate with the device
+enum class protocol
+{
+  /// @brief ASCII telegrams, delimited by STX and ETX
+  cola_a
+  /// @brief Binary telegrams, prefixed by their length and followed by a checksum
+, cola_b
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @brief Thrown when a telegram couldn't have been read
 ///
 /// Gene
@@ -154,8 +371,115 @@ class timeout_error final
 
 /*------------------------------------------------------------------------------------------------*/
 
+class buffer_pool;
+class compact_scan;
+class layout_parser;
+class projector;
+class sector_reduction;
+class scan_ring;
+class scan_view;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Called for each scan received while streaming
+///
+/// The scan is only valid during the call.
+using scan_handler = std::function<void (const scan_data&)>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Called when an error stops streaming
+using error_handler = std::function<void (std::exception_ptr)>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Called for each LMDscandata telegram received while streaming, before it is decoded
+///
+/// The bytes of the telegram are only valid during the call.
+using telegram_handler = std::function<void (const char* first, const char* last)>;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Something which delivers scans, either a device or a replay of recorded scans
+///
+/// Lets the same code process live scans, or recorded ones at a controlled pace.
+class scan_source
+{
+public:
+
+  /// @brief Destructor
+  virtual
+  ~scan_source() = default;
+
+  /// @brief Get the next scan
+  virtual
+  scan_data
+  get_data() = 0;
+
+  /// @brief Get the next scan into an existing scan
+  virtual
+  void
+  get_data(scan_data& data) = 0;
+
+  /// @brief Get the next scan into a compact scan
+  virtual
+  void
+  get_data(compact_scan& data) = 0;
+
+  /// @brief Get the next scan into an existing scan, reporting errors through ec
+  virtual
+  void
+  get_data(scan_data& data, std::error_code& ec) = 0;
+
+  /// @brief Get the next scan into a compact scan, reporting errors through ec
+  virtual
+  void
+  get_data(compact_scan& data, std::error_code& ec) = 0;
+
+  /// @brief Deliver scans asynchronously, from a background thread
+  virtual
+  void
+  start_stream(scan_handler handler, error_handler on_error = nullptr) = 0;
+
+  /// @brief Decode scans asynchronously into a ring, from a background thread
+  virtual
+  void
+  start_stream(scan_ring& ring, error_handler on_error = nullptr) = 0;
+
+  /// @brief Deliver scans on the calling thread, until stop_stream() is called
+  virtual
+  void
+  run_stream(scan_handler handler) = 0;
+
+  /// @brief Stop delivering scans
+  virtual
+  void
+  stop_stream() = 0;
+
+  /// @brief Tell if scans are being delivered asynchronously
+  virtual
+  bool
+  streaming()
+  const noexcept = 0;
+
+  /// @brief Get statistics about delivered scans
+  virtual
+  statistics
+  get_statistics()
+  const noexcept = 0;
+
+  /// @brief Reset statistics about delivered scans
+  virtual
+  void
+  reset_statistics()
+  noexcept = 0;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
 /// @brief Class responsible for communicating with LMS1xx device.
 class LMS1xx final
+  : public scan_source
 {
 public:
 
@@ -172,11 +496,28 @@ public:
   LMS1xx& operator=(LMS1xx&&) = delete;
 
   /// @brief Default constructor
-  LMS1xx(const boost::posix_time::time_duration& timeout = boost::posix_time::seconds{30});
+  /// @param timeout Time to wait for a telegram
+  /// @param p Protocol used for commands and scans
+  LMS1xx( const boost::posix_time::time_duration& timeout = boost::posix_time::seconds{30}
+        , protocol p = protocol::cola_a);
 
   /// @brief Construct that connects to a given device
   LMS1xx( const std::string& host, const std::string& port
-        , const boost::posix_time::time_duration& timeout = boost::posix_time::seconds{30});
+        , const boost::posix_time::time_duration& timeout = boost::posix_time::seconds{30}
+        , protocol p = protocol::cola_a);
+
+  /// @brief Construct a device driven by an external io_service, shared with other devices
+  /// @param io Runs the I/O of the device
+  /// @param timeout Time to wait for a telegram
+  /// @param p Protocol used for commands and scans
+  /// @param pool Where to get the receive buffer from, nullptr to allocate it
+  ///
+  /// Handlers of a device never run concurrently, even if several threads run io. Commands must
+  /// only be sent while no other thread runs io. When the device is destroyed, its pending
+  /// operations are left in io, which must not be run anymore.
+  LMS1xx( boost::asio::io_service& io
+        , const boost::posix_time::time_duration& timeout = boost::posix_time::seconds{30}
+        , protocol p = protocol::cola_a, buffer_pool* pool = nullptr);
 
   /// @brief Destructor.
   ///
@@ -200,26 +541,48 @@ public:
   connected()
   const noexcept;
 
+  /// @brief Get the protocol used to communicate with the device
+  protocol
+  get_protocol()
+  const noexcept;
+
   /// @brief Start measurements
   ///
   /// After receiving this command LMS1xx unit starts spinning laser and measuring.
   void
   start_measurements();
 
+  /// @brief Start measurements, reporting errors through ec
+  void
+  start_measurements(std::error_code& ec);
+
   /// @brief Stop measurements
   ///
   /// After receiving this command LMS1xx unit stop spinning laser and measuring.
   void stop_measurements();
 
+  /// @brief Stop measurements, reporting errors through ec
+  void
+  stop_measurements(std::error_code& ec);
+
   /// @brief Get current status of LMS1xx device
   device_status
   status();
 
+  /// @brief Get current status of LMS1xx device, reporting errors through ec
+  /// @return device_status::undefined on error
+  device_status
+  status(std::error_code& ec);
+
   /// @brief Log into LMS1xx unit.
   ///
   /// Increase privilege level, giving ability to change device configuration.
   void login();
 
+  /// @brief Log into LMS1xx unit, reporting errors through ec
+  void
+  login(std::error_code& ec);
+
   /// @brief Get current scan configuration
   ///
   /// Get scan configuration :
@@ -230,6 +593,10 @@ public:
   scan_configuration
   get_configuration();
 
+  /// @brief Get current scan configuration, reporting errors through ec
+  scan_configuration
+  get_configuration(std::error_code& ec);
+
   /// @brief Set scan configuration
   ///
   /// Get scan configuration :
@@ -240,16 +607,43 @@ public:
   void
   set_scan_configuration(const scan_configuration &cfg);
 
+  /// @brief Set scan configuration, reporting errors through ec
+  void
+  set_scan_configuration(const scan_configuration& cfg, std::error_code& ec);
+
   /// @brief Set scan data configuration
   ///
-  /// Set format of scan message returned by device.
+  /// Set format of scan message returned by device. Once the device accepted the configuration,
+  /// CoLa-B scans are decoded by a routine specialized for the layout of its telegrams (see
+  /// layout_parser).
+  /// @throw std::system_error if the device refuses the configuration
   void
   set_scan_data_configuration(const scan_data_configuration &cfg);
 
+  /// @brief Set scan data configuration, reporting errors through ec
+  /// @param ec Set to errc::command_rejected if the device refuses the configuration, which then
+  /// isn't used to decode scans
+  void
+  set_scan_data_configuration(const scan_data_configuration& cfg, std::error_code& ec);
+
   /// @brief Get current output range configuration
   scan_output_range
   get_scan_output_range();
 
+  /// @brief Get current output range configuration, reporting errors through ec
+  scan_output_range
+  get_scan_output_range(std::error_code& ec);
+
+  /// @brief Get a projector for the scans of the device
+  ///
+  /// The scan output range is queried the first time, then only after set_scan_configuration() or
+  /// a new connection. Thus, tables of angles are kept as long as the geometry of scans is the
+  /// same.
+  /// With a scan filter, the projector covers the kept samples.
+  /// The projector stays valid until the next call.
+  const projector&
+  get_projector();
+
   /// @brief Start or stop continuous data acquisition
   ///
   /// After reception of this command device start or stop continuous data stream containing scan
@@ -257,9 +651,153 @@ public:
   void
   scan_continous(bool start);
 
+  /// @brief Start or stop continuous data acquisition, reporting errors through ec
+  void
+  scan_continous(bool start, std::error_code& ec);
+
+  /// @brief The parser selected by the last accepted scan data configuration
+  /// @return nullptr if no configuration was accepted
+  ///
+  /// Must not be called while streaming.
+  std::shared_ptr<const layout_parser>
+  get_layout_parser()
+  const noexcept;
+
+  /// @brief Decode only some samples of the following scans
+  ///
+  /// Applies to get_data() and to streaming. Samples are skipped while telegrams are parsed, thus
+  /// the cost of decoding scales with the number of kept samples.
+  void
+  set_scan_filter(const scan_filter& filter);
+
+  /// @brief Decode all samples of the following scans
+  void
+  clear_scan_filter();
+
+  /// @brief Reduce DIST1 of the following scans to its closest echo in each sector
+  /// @param sectors Angles of the sectors, in 1/10000 degree
+  /// @param handler Called for each sector as soon as its samples are decoded, before the rest of
+  /// the telegram, from the thread which decodes scans; must not throw
+  /// @return The reduction, which keeps the closest echoes of the last scan
+  /// @throw std::invalid_argument if a sector is empty
+  ///
+  /// Applies to get_data() into a scan_data or a compact_scan, and to streaming. With a scan
+  /// filter, sectors are reduced over the kept samples. Must not be called while streaming.
+  const sector_reduction&
+  set_sector_reduction(std::vector<sector> sectors, sector_handler handler);
+
+  /// @brief Stop reducing DIST1 of the following scans
+  void
+  clear_sector_reduction();
+
   /// @brief Receive single scan message
   scan_data
-  get_data();
+  get_data() override;
+
+  /// @brief Receive single scan message into an existing scan
+  /// @throw invalid_telegram_error if a channel has more than max_samples samples
+  /// @throw timeout_error if the telegram isn't complete after the timeout
+  /// @throw std::system_error if the connection fails
+  ///
+  /// Avoid the initialization and the copy of a new scan_data for each telegram.
+  void
+  get_data(scan_data& data) override;
+
+  /// @brief Receive single scan message into a compact scan
+  /// @throw invalid_telegram_error if a channel has more samples than the capacity of data
+  void
+  get_data(compact_scan& data) override;
+
+  /// @brief Receive single scan message into an existing scan, without throwing
+  /// @param ec Set to errc::invalid_telegram, errc::timeout or to the error of the connection,
+  /// cleared on success
+  ///
+  /// The connection is closed after a timeout.
+  void
+  get_data(scan_data& data, std::error_code& ec) override;
+
+  /// @brief Receive single scan message into a compact scan, without throwing
+  void
+  get_data(compact_scan& data, std::error_code& ec) override;
+
+  /// @brief Receive single scan message, decoding only its header
+  /// @throw invalid_telegram_error if the header of the telegram is malformed
+  ///
+  /// The view refers to the receive buffer, it is valid until the next call which reads from the
+  /// device. Channels are decoded when accessed through the view. The scan filter doesn't apply.
+  void
+  get_data(scan_view& view);
+
+  /// @brief Receive single scan message, decoding only its header, without throwing
+  void
+  get_data(scan_view& view, std::error_code& ec);
+
+  /// @brief Deliver scans asynchronously, from a background I/O thread
+  /// @param handler Called for each scan, as soon as its telegram is complete
+  /// @param on_error Called when an error (timeout, lost connection, ...) stops streaming
+  ///
+  /// Continuous acquisition must have been started with scan_continous(true). Commands can be
+  /// sent from another thread while streaming, one at a time: their replies are picked out of the
+  /// stream, which isn't interrupted. No other method should be called until stop_stream(), and
+  /// commands must not be sent from the handlers. Invalid telegrams are skipped.
+  /// With an external io_service, no thread is started: handlers are called from the threads
+  /// which run it.
+  void
+  start_stream(scan_handler handler, error_handler on_error = nullptr) override;
+
+  /// @brief Decode scans asynchronously into a ring, from a background I/O thread
+  /// @param ring Scans are decoded in place in the slots of the ring, the calling thread is the
+  /// consumer
+  /// @param on_error Called when an error (timeout, lost connection, ...) stops streaming
+  ///
+  /// Same as start_stream(scan_handler, error_handler), without any copy of scans.
+  /// @throw std::logic_error if the ring blocks (overflow_policy::block) and the io_service is
+  /// external: waiting for the consumer would stall the other handlers of the io_service
+  void
+  start_stream(scan_ring& ring, error_handler on_error = nullptr) override;
+
+  /// @brief Deliver telegrams asynchronously, without decoding them, from a background I/O thread
+  /// @param handler Called for each LMDscandata telegram, as soon as it is complete
+  /// @param on_error Called when an error (timeout, lost connection, ...) stops streaming
+  ///
+  /// Same as start_stream(scan_handler, error_handler), decoding is left to the handler: the
+  /// statistics of the device only count received bytes and framing errors.
+  void
+  start_telegram_stream(telegram_handler handler, error_handler on_error = nullptr);
+
+  /// @brief Deliver scans on the calling thread, until stop_stream() is called
+  /// @param handler Called for each scan, as soon as its telegram is complete
+  ///
+  /// Errors stopping the stream are thrown. Invalid telegrams are skipped. Commands can be sent
+  /// from another thread, as with start_stream().
+  /// @throw std::logic_error with an external io_service
+  void
+  run_stream(scan_handler handler) override;
+
+  /// @brief Stop delivering scans
+  ///
+  /// Wait for the I/O thread, unless called from a handler, even if an error already stopped
+  /// streaming. With an external io_service, wait until the stream is stopped by one of the threads
+  /// which run it.
+  void
+  stop_stream() override;
+
+  /// @brief Tell if scans are being delivered asynchronously
+  bool
+  streaming()
+  const noexcept override;
+
+  /// @brief Get statistics about received scans
+  ///
+  /// Cheap enough to be polled periodically, from any thread, even while streaming.
+  statistics
+  get_statistics()
+  const noexcept override;
+
+  /// @brief Reset statistics about received scans
+  void
+  reset_statistics()
+  noexcept override;
 
   /// @brief Save data permanently
   /// Parameters are saved in the EEPROM of the LMS and will also be available after the device is
@@ -267,39 +805,189 @@ public:
   void
   save_configuration();
 
+  /// @brief Save data permanently, reporting errors through ec
+  void
+  save_configuration(std::error_code& ec);
+
   /// @brief The device is returned to the measurement mode after configuration
   void
   start_device();
 
+  /// @brief Return to the measurement mode, reporting errors through ec
+  void
+  start_device(std::error_code& ec);
+
+  /// @brief Configure the device and start continuous acquisition
+  /// @param cfg The scan data configuration
+  /// @param ready_timeout Time to wait for the device to be ready for measurement
+  /// @throw timeout_error if the device isn't ready after ready_timeout
+  /// @throw std::system_error if the device refuses a command, or if it's streaming
+  ///
+  /// Same as login(), set_scan_data_configuration(), start_measurements(), waiting for
+  /// device_status::ready_for_measurement, start_device() and scan_continous(true). Commands which
+  /// don't depend on each other are sent at once, thus each group costs a single round trip. The
+  /// status is polled at an interval growing from a few milliseconds, so a device which is already
+  /// spinning is started immediately.
+  bring_up_report
+  bring_up( const scan_data_configuration& cfg
+          , const boost::posix_time::time_duration& ready_timeout = boost::posix_time::seconds{30});
+
+  /// @brief Configure the device and start continuous acquisition, reporting errors through ec
+  /// @param ec Set to errc::timeout if the device isn't ready after ready_timeout, to
+  /// errc::command_rejected if the device refuses a command, or to std::errc::operation_in_progress
+  /// if the device is streaming
+  /// @return The time spent in the phases completed before an error
+  bring_up_report
+  bring_up( const scan_data_configuration& cfg, std::error_code& ec
+          , const boost::posix_time::time_duration& ready_timeout = boost::posix_time::seconds{30});
+
 private:
 
   /// @brief Read a telegram from the device
-  /// @note m_buffer is reset before each read
-  /// Result will be available in m_buffer.
+  /// @param ec Set to errc::timeout if the telegram isn't complete before the timeout, to
+  /// errc::invalid_telegram if m_buffer is full without any complete telegram, or to the error of
+  /// the connection
+  ///
+  /// The previous telegram is removed from m_buffer, and bytes received after it are kept. Thus,
+  /// when a single receive brings several telegrams, the following ones are read without any
+  /// system call. Bytes which can't be part of a telegram are skipped.
+  /// Result will be available at the beginning of m_buffer, m_telegram_size bytes long.
   void
-  read();
+  read(std::error_code& ec);
 
+  /// @brief Receive bytes from the device, until a deadline
+  /// @param deadline Given by read() for the whole telegram
   void
-  write(const std::string& telegram);
+  receive(const boost::posix_time::ptime& deadline, std::error_code& ec);
 
+  /// @brief Look for a complete telegram in m_buffer
+  /// @return false if more bytes are needed
+  /// @param ec Set to errc::invalid_telegram if m_buffer is full without any complete telegram
+  bool
+  next_telegram(std::error_code& ec);
+
+  /// @brief Space to receive bytes from the device
+  boost::asio::mutable_buffers_1
+  receive_buffer();
+
+  /// @brief Receive scans asynchronously, for start_stream(), start_telegram_stream() and
+  /// run_stream()
+  void
+  stream_receive();
+
+  /// @brief Give the current telegram to m_telegram_handler, for start_telegram_stream()
   void
-  write(const char* telegram, std::size_t len);
+  deliver_telegram();
 
+  /// @brief Start the I/O thread of start_stream(), if the io_service isn't external
   void
-  check_timer();
+  start_stream_thread(error_handler on_error);
+
+  /// @brief Stop streaming because of an error, and report it
+  void
+  stream_error(std::exception_ptr error);
+
+  /// @brief Stop streaming
+  /// @return false if streaming was already stopped
+  bool
+  halt_stream()
+  noexcept;
+
+  /// @brief Decode the telegram read by the last call to read(), and record its statistics
+  template <typename Scan>
+  void
+  decode(Scan& data, std::error_code& ec);
+
+  /// @brief Get the telegram read by the last call to read()
+  void
+  telegram(const char*& begin, const char*& end)
+  const noexcept;
+
+  /// @brief Get the reply to the last call to command()
+  void
+  reply(const char*& begin, const char*& end)
+  const noexcept;
+
+  void
+  write(const std::string& telegram, std::error_code& ec);
+
+  /// @brief Send a command and read its reply
+  ///
+  /// Scans received before the reply are dropped. While streaming, the command is sent by
+  /// routed_command() instead.
+  void
+  command(const std::string& request, std::error_code& ec);
+
+  /// @brief Read the reply of a command which was sent
+  ///
+  /// Scans received before the reply are dropped.
+  void
+  read_reply(std::error_code& ec);
+
+  /// @brief Select the parser of the layout of a scan data configuration
+  /// @param ec The result of the command which applied the configuration; on error, scans are
+  /// decoded by the generic parser
+  void
+  set_layout(const scan_data_configuration& cfg, const std::error_code& ec);
+
+  /// @brief Send a command from the strand of the stream, and wait for its reply
+  /// @param ec Set to errc::timeout if the reply doesn't come before the timeout, the connection
+  /// is kept
+  ///
+  /// The reply is stored in m_reply.
+  void
+  routed_command(const std::string& request, std::error_code& ec);
+
+  /// @brief Give the telegram read by the stream to the pending command it replies to, if any
+  /// @return false if the telegram isn't a reply to a pending command
+  bool
+  route_reply();
+
+  /// @brief Make all pending commands fail
+  void
+  cancel_commands(const std::error_code& ec)
+  noexcept;
+
+  /// @brief Send several commands at once, then read their replies
+  /// @param telegrams The concatenated commands
+  /// @param nb_replies The number of commands
+  /// @param ec Set to std::errc::operation_in_progress while streaming, or to the error of the
+  /// first reply which can't be read, errc::command_rejected if it refuses its command
+  ///
+  /// Scans received before each reply are dropped.
+  void
+  pipeline(const std::string& telegrams, std::size_t nb_replies, std::error_code& ec);
+
+  /// @brief Poll the status until the device is ready for measurement
+  /// @return The number of status requests
+  std::size_t
+  wait_ready(const boost::posix_time::time_duration& timeout, std::error_code& ec);
+
+  /// @brief Common constructor
+  LMS1xx( boost::asio::io_service* io, const boost::posix_time::time_duration& timeout, protocol p
+        , buffer_pool* pool);
 
 private:
 
+  /// @brief A command sent while streaming, waiting for its reply
+  struct pending_command;
+
+  /// @brief The io_service of the device, if it isn't external
+  std::unique_ptr<boost::asio::io_service> m_own_io;
+
   /// @brief Manage I/O
-  boost::asio::io_service m_io;
+  boost::asio::io_service& m_io;
+
+  /// @brief Serialize the handlers of the device
+  boost::asio::io_service::strand m_strand;
 
   /// @brief The connection to the device
   boost::asio::ip::tcp::socket m_socket;
 
   /// @brief The buffer of received telegrams
-  boost::asio::streambuf m_buffer;
+  telegram_buffer m_buffer;
 
-  /// @brief Track timeouts
+  /// @brief Deadline of the current read or wait
   boost::asio::deadline_timer m_timer;
 
   /// @brief True if the device is connected
@@ -307,6 +995,64 @@ private:
 
   /// @brief Time to wait before throwing a timeout exception
   boost::posix_time::time_duration m_timeout;
+
+  /// @brief The protocol used to communicate with the device
+  protocol m_protocol;
+
+  /// @brief The size of the last read telegram
+  std::size_t m_telegram_size;
+
+  /// @brief True while scans are delivered asynchronously
+  std::atomic<bool> m_streaming;
+
+  /// @brief Called for each scan while streaming
+  scan_handler m_scan_handler;
+
+  /// @brief Called when an error stops streaming
+  error_handler m_error_handler;
+
+  /// @brief The scan given to m_scan_handler, reused for each telegram
+  scan_data m_stream_data;
+
+  /// @brief Where to decode scans while streaming, instead of m_stream_data
+  scan_ring* m_ring;
+
+  /// @brief Called for each telegram while streaming, instead of decoding it, if set
+  telegram_handler m_telegram_handler;
+
+  /// @brief Run m_io for start_stream()
+  std::thread m_stream_thread;
+
+  /// @brief Commands sent while streaming, in the order they were sent, only used on m_strand
+  std::deque<std::shared_ptr<pending_command>> m_pending_commands;
+
+  /// @brief The reply to the last command sent while streaming
+  std::string m_reply;
+
+  /// @brief True if the last command was sent while streaming, its reply being in m_reply
+  bool m_routed;
+
+  /// @brief Statistics about received scans
+  telemetry m_telemetry;
+
+  /// @brief Convert scans to points, created by get_projector()
+  std::unique_ptr<projector> m_projector;
+
+  /// @brief True if the scan output range may have changed since m_projector was updated
+  bool m_projector_outdated;
+
+  /// @brief True if m_filter applies to scans
+  bool m_filtered;
+
+  /// @brief The samples to decode
+  scan_filter m_filter;
+
+  /// @brief Reduce DIST1 while decoding, if set
+  std::unique_ptr<sector_reduction> m_reduction;
+
+  /// @brief Decode scans of the last accepted scan data configuration, if set, only changed on
+  /// m_strand while streaming
+  std::shared_ptr<const layout_parser> m_layout;
 };
 
 /*------------------------------------------------------------------------------------------------*/
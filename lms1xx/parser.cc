@@ -0,0 +1,694 @@
+#include <algorithm> // equal, min
+#include <cstdint>
+
+#include "lms1xx/cola.hh"
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/cursor.hh"
+#include "lms1xx/parser.hh"
+#include "lms1xx/sector_reduction.hh"
+
+namespace lms1xx {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The samples of a channel kept by a filter
+struct window
+{
+  /// @brief Index of the first kept sample
+  std::size_t first;
+
+  /// @brief Number of kept samples
+  std::size_t size;
+
+  /// @brief Distance between two kept samples
+  std::size_t stride;
+
+  /// @brief Number of samples up to the last kept one, included
+  std::size_t
+  span()
+  const noexcept
+  {
+    return size == 0 ? first : first + (size - 1) * stride + 1;
+  }
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Select the samples of a channel within the angular window of a filter
+/// @param start_angle Angle of the first sample of the channel, in 1/10000 degree
+/// @param step Angle between two samples, in 1/10000 degree
+/// @param nb_data Number of samples of the channel
+window
+filter_window( std::int32_t start_angle, std::uint32_t step, std::size_t nb_data
+             , const scan_filter& f)
+noexcept
+{
+  auto w = window{0, 0, f.stride == 0 ? 1 : f.stride};
+  const auto lo = static_cast<std::int64_t>(f.start_angle) - start_angle;
+  const auto hi = static_cast<std::int64_t>(f.stop_angle) - start_angle;
+  if (nb_data == 0 or hi < 0 or hi < lo)
+  {
+    return w;
+  }
+  auto first = std::size_t{0};
+  auto last = nb_data - 1;
+  if (step == 0)
+  {
+    // All samples have the same angle.
+    if (lo > 0)
+    {
+      return w;
+    }
+  }
+  else
+  {
+    first = lo <= 0 ? 0 : static_cast<std::size_t>((lo + step - 1) / step);
+    last = std::min(last, static_cast<std::size_t>(hi / step));
+  }
+  if (first <= last)
+  {
+    w.first = first;
+    w.size = (last - first) / w.stride + 1;
+  }
+  return w;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Store decoded channels in a scan_data
+class scan_data_sink
+{
+public:
+
+  using data_type = scan_data;
+
+  explicit
+  scan_data_sink(scan_data& data)
+  noexcept
+    : m_data(data)
+  {}
+
+  void
+  clear()
+  noexcept
+  {
+    m_data.dist_len1 = 0;
+    m_data.dist_len2 = 0;
+    m_data.rssi_len1 = 0;
+    m_data.rssi_len2 = 0;
+  }
+
+  scan_header&
+  header()
+  noexcept
+  {
+    return m_data.header;
+  }
+
+  /// @return nullptr if size exceeds max_samples
+  uint16_t*
+  prepare(channel c, std::size_t size)
+  noexcept
+  {
+    if (size > max_samples)
+    {
+      return nullptr;
+    }
+    const auto len = static_cast<int>(size);
+    switch (c)
+    {
+      case channel::dist1: m_data.dist_len1 = len; return m_data.dist1;
+      case channel::dist2: m_data.dist_len2 = len; return m_data.dist2;
+      case channel::rssi1: m_data.rssi_len1 = len; return m_data.rssi1;
+      default:             m_data.rssi_len2 = len; return m_data.rssi2;
+    }
+  }
+
+private:
+
+  scan_data& m_data;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Store decoded channels in a compact_scan
+class compact_scan_sink
+{
+public:
+
+  using data_type = compact_scan;
+
+  explicit
+  compact_scan_sink(compact_scan& data)
+  noexcept
+    : m_data(data)
+  {}
+
+  void
+  clear()
+  noexcept
+  {
+    m_data.clear();
+  }
+
+  scan_header&
+  header()
+  noexcept
+  {
+    return m_data.header();
+  }
+
+  /// @return nullptr if size exceeds the capacity of the scan
+  uint16_t*
+  prepare(channel c, std::size_t size)
+  noexcept
+  {
+    return m_data.prepare(c, size);
+  }
+
+private:
+
+  compact_scan& m_data;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The sink storing decoded channels in a scan_data
+scan_data_sink
+make_sink(scan_data& data)
+noexcept
+{
+  return scan_data_sink{data};
+}
+
+/// @brief The sink storing decoded channels in a compact_scan
+compact_scan_sink
+make_sink(compact_scan& data)
+noexcept
+{
+  return compact_scan_sink{data};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @param filter nullptr to decode all samples
+/// @param reduction nullptr to skip the reduction of DIST1
+template <typename Sink>
+void
+parse_channels(cursor& c, Sink& sink, const scan_filter* filter, sector_reduction* reduction)
+noexcept
+{
+  const auto nb_channels = c.hex(); // NumberChannels16Bit or NumberChannels8Bit
+  for (auto i = 0u; i < nb_channels and not c.failed(); ++i)
+  {
+    auto len = std::size_t{};
+    const auto content = c.token(len); // MeasuredDataContent
+    c.skip(); // ScalingFactor
+    c.skip(); // ScalingOffset
+    const auto start_angle = static_cast<std::int32_t>(c.hex()); // Starting angle
+    const auto step = c.hex(); // Angular step width
+    const auto nb_data = c.hex(); // NumberData
+
+    auto ch = channel{};
+    if (not content_channel(content, len, ch)
+        or (filter != nullptr and (filter->channels & channel_bit(ch)) == 0))
+    {
+      c.skip(nb_data);
+      continue;
+    }
+
+    const auto w = filter != nullptr ? filter_window(start_angle, step, nb_data, *filter)
+                                     : window{0, nb_data, 1};
+    const auto storage = sink.prepare(ch, w.size);
+    if (storage == nullptr)
+    {
+      c.fail();
+      return;
+    }
+    c.skip(w.first);
+
+    // Decode the kept samples up to a bound, following ones are decoded by the next call.
+    auto decoded = std::size_t{0};
+    const auto decode = [&](std::size_t to)
+    {
+      if (w.stride == 1)
+      {
+        decode_samples(c, storage + decoded, to - decoded);
+      }
+      else
+      {
+        for (auto j = decoded; j < to and not c.failed(); ++j)
+        {
+          storage[j] = static_cast<uint16_t>(c.hex());
+          c.skip(j + 1 < w.size ? w.stride - 1 : 0);
+        }
+      }
+      decoded = to;
+      return not c.failed();
+    };
+    if (reduction != nullptr and ch == channel::dist1)
+    {
+      reduction->reduce( sink.header(), start_angle + std::int64_t{step} * w.first
+                       , std::int64_t{step} * w.stride, storage, w.size, decode);
+    }
+    else
+    {
+      decode(w.size);
+    }
+    c.skip(nb_data - w.span());
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @param filter nullptr to decode all samples
+/// @param reduction nullptr to skip the reduction of DIST1
+template <typename Sink>
+void
+parse_channels( binary_cursor& c, std::size_t sample_size, Sink& sink, const scan_filter* filter
+              , sector_reduction* reduction)
+noexcept
+{
+  const auto nb_channels = c.field(2); // NumberChannels16Bit or NumberChannels8Bit
+  for (auto i = 0u; i < nb_channels and not c.failed(); ++i)
+  {
+    const auto content = c.bytes(5); // MeasuredDataContent
+    c.skip(4); // ScalingFactor
+    c.skip(4); // ScalingOffset
+    const auto start_angle = static_cast<std::int32_t>(c.field(4)); // Starting angle
+    const auto step = c.field(2); // Angular step width
+    const auto nb_data = c.field(2); // NumberData
+
+    const auto samples = c.bytes(nb_data * sample_size);
+    if (c.failed())
+    {
+      return;
+    }
+    auto ch = channel{};
+    if (    content_channel(content, 5, ch)
+        and (filter == nullptr or (filter->channels & channel_bit(ch)) != 0))
+    {
+      const auto w = filter != nullptr ? filter_window(start_angle, step, nb_data, *filter)
+                                       : window{0, nb_data, 1};
+      const auto storage = sink.prepare(ch, w.size);
+      if (storage == nullptr)
+      {
+        c.fail();
+        return;
+      }
+      const auto first = samples + w.first * sample_size;
+      if (reduction != nullptr and ch == channel::dist1)
+      {
+        auto decoded = std::size_t{0};
+        const auto decode = [&](std::size_t to)
+        {
+          decode_samples( first + decoded * w.stride * sample_size, sample_size, w.stride
+                        , storage + decoded, to - decoded);
+          decoded = to;
+          return true;
+        };
+        reduction->reduce( sink.header(), start_angle + std::int64_t{step} * w.first
+                         , std::int64_t{step} * w.stride, storage, w.size, decode);
+      }
+      else
+      {
+        decode_samples(first, sample_size, w.stride, storage, w.size);
+      }
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @return false if the telegram is truncated or malformed
+template <typename Sink>
+bool
+parse_binary_scan_data( const char* first, const char* last, Sink& sink, const scan_filter* filter
+                      , sector_reduction* reduction)
+noexcept
+{
+  auto payload_first = first;
+  auto payload_last = last;
+  if (not cola::payload(first, last, payload_first, payload_last))
+  {
+    return false;
+  }
+
+  auto c = binary_cursor{payload_first, payload_last};
+  parse_header(c, sink.header());
+  parse_channels(c, 2, sink, filter, reduction); // 16-bit channels
+  parse_channels(c, 1, sink, filter, reduction); // 8-bit channels
+  parse_trailer(c, sink.header());
+  return not c.failed();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @param filter nullptr to decode all samples
+/// @param reduction nullptr to skip the reduction of DIST1
+/// @return false if the telegram is truncated or malformed
+template <typename Sink>
+bool
+parse_telegram( const char* first, const char* last, Sink&& sink, const scan_filter* filter
+              , sector_reduction* reduction = nullptr)
+noexcept
+{
+  sink.clear();
+  sink.header().has_timestamp = false;
+
+  if (cola::is_binary(first, last))
+  {
+    return parse_binary_scan_data(first, last, sink, filter, reduction);
+  }
+
+  auto c = cursor{first, last};
+  parse_header(c, sink.header());
+  parse_channels(c, sink, filter, reduction); // 16-bit channels
+  parse_channels(c, sink, filter, reduction); // 8-bit channels
+  parse_trailer(c, sink.header());
+  return not c.failed();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The MeasuredDataContent field of each channel
+const char* const contents[compact_scan::nb_channels] = {"DIST1", "DIST2", "RSSI1", "RSSI2"};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode a channel of a CoLa-B payload of a known layout
+/// @tparam SampleSize 2 for 16-bit channels, 1 for 8-bit ones
+/// @return false if the channel isn't the expected one
+///
+/// The cursor fails if the telegram is truncated, or if the channel has more samples than the
+/// capacity of the sink.
+template <std::size_t SampleSize, typename Sink>
+bool
+parse_expected_channel(binary_cursor& c, Sink& sink, channel ch)
+noexcept
+{
+  const auto content = c.bytes(5); // MeasuredDataContent
+  const auto expected = contents[static_cast<std::size_t>(ch)];
+  if (content != nullptr and not std::equal(content, content + 5, expected))
+  {
+    return false;
+  }
+  c.skip(4); // ScalingFactor
+  c.skip(4); // ScalingOffset
+  c.skip(4); // Starting angle
+  c.skip(2); // Angular step width
+  const auto nb_data = c.field(2); // NumberData
+  const auto samples = c.bytes(nb_data * SampleSize);
+  const auto storage = c.failed() ? nullptr : sink.prepare(ch, nb_data);
+  if (storage == nullptr)
+  {
+    c.fail();
+    return true;
+  }
+  // The sample size and the stride are constants, the loop is vectorized.
+  decode_samples(samples, SampleSize, 1, storage, nb_data);
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode the channels of a known layout
+/// @tparam Outputs Bit 0 for the first echo, bit 1 for the second one
+/// @tparam RssiBits 0 without remission, 8 or 16 for its resolution
+/// @return false if the channels aren't the expected ones
+///
+/// The order of channels is the one of the device: distances, then remissions. The cursor fails if
+/// the telegram is malformed.
+template <unsigned Outputs, unsigned RssiBits, typename Sink>
+bool
+parse_expected_channels(binary_cursor& c, Sink& sink)
+noexcept
+{
+  constexpr auto first = (Outputs & 1u) != 0;
+  constexpr auto second = (Outputs & 2u) != 0;
+  constexpr auto nb_echoes = (first ? 1u : 0u) + (second ? 1u : 0u);
+
+  const auto nb_16 = c.field(2); // NumberChannels16Bit
+  if (not c.failed() and nb_16 != (RssiBits == 16 ? 2 * nb_echoes : nb_echoes))
+  {
+    return false;
+  }
+  if (    (first and not parse_expected_channel<2>(c, sink, channel::dist1))
+      or  (second and not parse_expected_channel<2>(c, sink, channel::dist2))
+      or  (RssiBits == 16 and first and not parse_expected_channel<2>(c, sink, channel::rssi1))
+      or  (RssiBits == 16 and second and not parse_expected_channel<2>(c, sink, channel::rssi2)))
+  {
+    return false;
+  }
+  const auto nb_8 = c.field(2); // NumberChannels8Bit
+  if (not c.failed() and nb_8 != (RssiBits == 8 ? nb_echoes : 0))
+  {
+    return false;
+  }
+  return     (RssiBits != 8 or not first or parse_expected_channel<1>(c, sink, channel::rssi1))
+         and (RssiBits != 8 or not second or parse_expected_channel<1>(c, sink, channel::rssi2));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode a CoLa-B telegram of a known layout
+/// @param ec Set to errc::invalid_telegram if the telegram is truncated or malformed, cleared
+/// otherwise; meaningless if the telegram doesn't have the expected layout
+/// @return false if the telegram doesn't have the expected layout
+template <typename Sink, unsigned Outputs, unsigned RssiBits>
+bool
+parse_layout( const char* first, const char* last, typename Sink::data_type& data
+            , std::error_code& ec)
+noexcept
+{
+  if (not cola::is_binary(first, last))
+  {
+    return false;
+  }
+
+  auto sink = Sink{data};
+  sink.clear();
+  sink.header().has_timestamp = false;
+
+  auto payload_first = first;
+  auto payload_last = last;
+  if (not cola::payload(first, last, payload_first, payload_last))
+  {
+    ec = make_error_code(errc::invalid_telegram);
+    return true;
+  }
+  auto c = binary_cursor{payload_first, payload_last};
+  parse_header(c, sink.header());
+  if (not parse_expected_channels<Outputs, RssiBits>(c, sink))
+  {
+    return false;
+  }
+  parse_trailer(c, sink.header());
+  ec = c.failed() ? make_error_code(errc::invalid_telegram) : std::error_code{};
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Data>
+using layout_routine = bool (*)(const char*, const char*, Data&, std::error_code&);
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Sink, unsigned Outputs>
+layout_routine<typename Sink::data_type>
+select_routine(const scan_data_configuration& cfg)
+noexcept
+{
+  if (not cfg.remission)
+  {
+    return &parse_layout<Sink, Outputs, 0>;
+  }
+  switch (cfg.resolution)
+  {
+    case 0:  return &parse_layout<Sink, Outputs, 8>;
+    case 1:  return &parse_layout<Sink, Outputs, 16>;
+    default: return nullptr;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @return nullptr if there is no routine for this configuration and this protocol
+template <typename Sink>
+layout_routine<typename Sink::data_type>
+select_routine(const scan_data_configuration& cfg, protocol p)
+noexcept
+{
+  if (p != protocol::cola_b)
+  {
+    return nullptr;
+  }
+  switch (cfg.output_channel)
+  {
+    case 1:  return select_routine<Sink, 1>(cfg);
+    case 2:  return select_routine<Sink, 2>(cfg);
+    case 3:  return select_routine<Sink, 3>(cfg);
+    default: return nullptr;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Scan>
+void
+parse_scan_data( const char* first, const char* last, Scan& data, const parse_options& options
+               , std::error_code& ec)
+noexcept
+{
+  ec = parse_telegram(first, last, make_sink(data), options.filter, options.reduction)
+     ? std::error_code{}
+     : make_error_code(errc::invalid_telegram);
+}
+
+template void
+parse_scan_data( const char*, const char*, scan_data&, const parse_options&
+               , std::error_code&)
+noexcept;
+
+template void
+parse_scan_data( const char*, const char*, compact_scan&, const parse_options&
+               , std::error_code&)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Scan>
+void
+parse_scan_data(const char* first, const char* last, Scan& data, const parse_options& options)
+{
+  if (not parse_telegram(first, last, make_sink(data), options.filter, options.reduction))
+  {
+    throw invalid_telegram_error{};
+  }
+}
+
+template void
+parse_scan_data(const char*, const char*, scan_data&, const parse_options&);
+
+template void
+parse_scan_data(const char*, const char*, compact_scan&, const parse_options&);
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_output_range
+filter_range(const scan_output_range& range, const scan_filter& filter)
+noexcept
+{
+  const auto nb_data = range.angle_resolution <= 0 or range.stop_angle < range.start_angle
+                     ? std::size_t{0}
+                     : static_cast<std::size_t>( (range.stop_angle - range.start_angle)
+                                               / range.angle_resolution + 1);
+  const auto step = static_cast<std::uint32_t>(range.angle_resolution);
+  const auto w = filter_window(range.start_angle, step, nb_data, filter);
+  if (w.size == 0)
+  {
+    return {range.angle_resolution, range.start_angle, range.start_angle - 1};
+  }
+  const auto resolution = range.angle_resolution * static_cast<int>(w.stride);
+  const auto start = range.start_angle + range.angle_resolution * static_cast<int>(w.first);
+  return {resolution, start, start + resolution * static_cast<int>(w.size - 1)};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+layout_parser::layout_parser()
+noexcept
+  : m_scan_data{nullptr}
+  , m_compact_scan{nullptr}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+layout_parser::layout_parser(const scan_data_configuration& cfg, protocol p)
+noexcept
+  : m_scan_data{select_routine<scan_data_sink>(cfg, p)}
+  , m_compact_scan{select_routine<compact_scan_sink>(cfg, p)}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+layout_parser::specialized()
+const noexcept
+{
+  return m_scan_data != nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Scan>
+void
+layout_parser::parse(const char* first, const char* last, Scan& data, std::error_code& ec)
+const noexcept
+{
+  const auto routine = routine_of(data);
+  if (routine == nullptr or not routine(first, last, data, ec))
+  {
+    parse_scan_data(first, last, data, {}, ec);
+  }
+}
+
+template void
+layout_parser::parse(const char*, const char*, scan_data&, std::error_code&)
+const noexcept;
+
+template void
+layout_parser::parse(const char*, const char*, compact_scan&, std::error_code&)
+const noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Scan>
+void
+layout_parser::parse(const char* first, const char* last, Scan& data)
+const
+{
+  auto ec = std::error_code{};
+  parse(first, last, data, ec);
+  if (ec)
+  {
+    throw invalid_telegram_error{};
+  }
+}
+
+template void
+layout_parser::parse(const char*, const char*, scan_data&)
+const;
+
+template void
+layout_parser::parse(const char*, const char*, compact_scan&)
+const;
+
+/*------------------------------------------------------------------------------------------------*/
+
+layout_parser::routine<scan_data>
+layout_parser::routine_of(const scan_data&)
+const noexcept
+{
+  return m_scan_data;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+layout_parser::routine<compact_scan>
+layout_parser::routine_of(const compact_scan&)
+const noexcept
+{
+  return m_compact_scan;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <cstddef>
+#include <system_error>
+
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+class sector_reduction;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Options of the decoding of LMDscandata telegrams
+///
+/// A value-initialized parse_options, {}, decodes all samples without reducing them.
+struct parse_options
+{
+  /// @brief The samples to decode, nullptr for all of them
+  ///
+  /// Channels excluded by the filter have no samples. Angles of samples are given by the header
+  /// of each channel.
+  const scan_filter* filter;
+
+  /// @brief The sectors of DIST1 to reduce to their closest echo, nullptr for none
+  ///
+  /// Sectors are reduced while the telegram is decoded, over the decoded samples, thus over the
+  /// samples kept by the filter. They are reported before the rest of the telegram is decoded.
+  sector_reduction* reduction;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode a LMDscandata telegram, without throwing
+/// @tparam Scan scan_data or compact_scan
+/// @param first Beginning of the telegram (may point to the STX delimiter in CoLa-A)
+/// @param last End of the telegram
+/// @param data The structure to fill, lengths of channels absent from the telegram are set to 0
+/// @param options The samples to decode and the sectors to reduce
+/// @param ec Set to errc::invalid_telegram if the telegram is truncated or malformed, or if a
+/// channel has more kept samples than the capacity of data (max_samples for a scan_data), cleared
+/// otherwise
+/// @note The minima reported before a telegram is found malformed come from valid samples.
+///
+/// Decoding is done in a single pass directly on the received bytes, without any allocation.
+/// CoLa-B telegrams are recognized by their header and must be complete, including their checksum.
+template <typename Scan>
+void
+parse_scan_data( const char* first, const char* last, Scan& data, const parse_options& options
+               , std::error_code& ec)
+noexcept;
+
+/// @brief Decode a LMDscandata telegram
+/// @tparam Scan scan_data or compact_scan
+/// @throw invalid_telegram_error if the telegram is truncated or malformed, or if a channel has
+/// more kept samples than the capacity of data (max_samples for a scan_data)
+template <typename Scan>
+void
+parse_scan_data( const char* first, const char* last, Scan& data
+               , const parse_options& options = parse_options{});
+
+/// @brief The angles of the samples kept by a filter
+/// @param range The angles of all samples
+/// @return An empty range (stop_angle lower than start_angle) if no sample is kept
+scan_output_range
+filter_range(const scan_output_range& range, const scan_filter& filter)
+noexcept;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode LMDscandata telegrams with a routine specialized for their layout
+///
+/// The channels of a telegram, their order and the size of their samples are determined by the
+/// scan data configuration of the device. For CoLa-B telegrams, a routine is generated for each
+/// combination of echoes (output_channel 1, 2 or 3), remission and resolution: it checks that the
+/// channels are the expected ones, then decodes them with sample sizes known at compile time,
+/// which lets the decoding loops be vectorized. The routine is selected once, at construction.
+///
+/// CoLa-A samples are hexadecimal numbers of variable length, whose decoding doesn't depend on
+/// the layout: CoLa-A telegrams are decoded by the generic parser. So are the telegrams which
+/// don't have the expected layout, because the configuration of the device changed or wasn't
+/// applied: results are always the ones of parse_scan_data().
+class layout_parser final
+{
+public:
+
+  /// @brief Constructor, for telegrams of unknown layout, decoded by the generic parser
+  layout_parser()
+  noexcept;
+
+  /// @brief Select the routine of the telegrams sent after a configuration
+  /// @param cfg The scan data configuration of the device
+  /// @param p The protocol of the telegrams
+  layout_parser(const scan_data_configuration& cfg, protocol p)
+  noexcept;
+
+  /// @brief Tell if a specialized routine was found for the configuration and the protocol
+  bool
+  specialized()
+  const noexcept;
+
+  /// @brief Decode a LMDscandata telegram, without throwing
+  /// @tparam Scan scan_data or compact_scan
+  /// @param ec Set to errc::invalid_telegram if the telegram is truncated or malformed, or if a
+  /// channel has more samples than the capacity of data, cleared otherwise
+  template <typename Scan>
+  void
+  parse(const char* first, const char* last, Scan& data, std::error_code& ec)
+  const noexcept;
+
+  /// @brief Decode a LMDscandata telegram
+  /// @tparam Scan scan_data or compact_scan
+  /// @throw invalid_telegram_error if the telegram is truncated or malformed, or if a channel has
+  /// more samples than the capacity of data
+  template <typename Scan>
+  void
+  parse(const char* first, const char* last, Scan& data)
+  const;
+
+private:
+
+  /// @brief A routine decoding a telegram of the expected layout
+  /// @return false if the telegram doesn't have the expected layout, ec is then meaningless
+  template <typename Scan>
+  using routine = bool (*)(const char*, const char*, Scan&, std::error_code&);
+
+  /// @brief The routine decoding into a scan_data
+  routine<scan_data>
+  routine_of(const scan_data&)
+  const noexcept;
+
+  /// @brief The routine decoding into a compact_scan
+  routine<compact_scan>
+  routine_of(const compact_scan&)
+  const noexcept;
+
+private:
+
+  /// @brief The routine decoding into a scan_data, nullptr for the generic parser
+  routine<scan_data> m_scan_data;
+
+  /// @brief The routine decoding into a compact_scan, nullptr for the generic parser
+  routine<compact_scan> m_compact_scan;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,668 @@
+#include <algorithm> // copy, max
+#include <chrono>
+
+#include "lms1xx/parser.hh"
+#include "lms1xx/pipeline.hh"
+#include "lms1xx/run_io.hh"
+
+namespace lms1xx {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+using clock_type = std::chrono::steady_clock;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Nanoseconds elapsed between two points in time
+std::uint64_t
+elapsed_ns(clock_type::time_point from, clock_type::time_point to)
+noexcept
+{
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count();
+  return ns > 0 ? static_cast<std::uint64_t>(ns) : 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A FIFO with a fixed capacity, which never allocates once constructed
+template <typename T>
+class fifo
+{
+public:
+
+  explicit
+  fifo(std::size_t capacity)
+    : m_items(capacity)
+    , m_first{0}
+    , m_size{0}
+  {}
+
+  bool
+  empty()
+  const noexcept
+  {
+    return m_size == 0;
+  }
+
+  /// @pre The FIFO isn't full
+  void
+  push_back(T item)
+  noexcept
+  {
+    m_items[(m_first + m_size) % m_items.size()] = item;
+    ++m_size;
+  }
+
+  /// @pre The FIFO isn't empty
+  T
+  front()
+  const noexcept
+  {
+    return m_items[m_first];
+  }
+
+  /// @pre The FIFO isn't empty
+  void
+  pop_front()
+  noexcept
+  {
+    m_first = (m_first + 1) % m_items.size();
+    --m_size;
+  }
+
+  void
+  clear()
+  noexcept
+  {
+    m_first = 0;
+    m_size = 0;
+  }
+
+private:
+
+  std::vector<T> m_items;
+  std::size_t m_first;
+  std::size_t m_size;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A telegram on its way through the pipeline
+struct pipeline::job
+{
+  /// @brief The device which sent the telegram
+  std::size_t device;
+
+  /// @brief The telegram, in a buffer of the pool until it is decoded
+  char* telegram;
+
+  /// @brief Number of bytes of the telegram
+  std::size_t size;
+
+  /// @brief When the telegram was framed
+  clock_type::time_point framed;
+
+  /// @brief When the telegram was decoded
+  clock_type::time_point parsed;
+
+  /// @brief False if the telegram couldn't be decoded
+  bool valid;
+
+  /// @brief True once the telegram is decoded, protected by the mutex of the device
+  bool done;
+
+  /// @brief The decoded scan
+  scan_data data;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The scans of a device, delivered in order
+struct pipeline::device_state
+{
+  explicit
+  device_state(std::size_t max_pending)
+    : mutex{}
+    , pending{max_pending}
+    , delivering{false}
+    , failed{false}
+    , layout{}
+  {}
+
+  /// @brief Protect pending and delivering
+  std::mutex mutex;
+
+  /// @brief Jobs of the device not handled yet, in the order of their telegrams
+  fifo<job*> pending;
+
+  /// @brief True while a parser gives scans of the device to the handler
+  bool delivering;
+
+  /// @brief True once a handler of the device threw
+  std::atomic<bool> failed;
+
+  /// @brief The parser of the telegrams of the device, nullptr for the generic one
+  std::shared_ptr<const layout_parser> layout;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The telegrams waiting for a parser
+struct pipeline::parser_queue
+{
+  explicit
+  parser_queue(std::size_t max_pending)
+    : mutex{}
+    , jobs{max_pending}
+  {}
+
+  /// @brief Protect jobs
+  std::mutex mutex;
+
+  /// @brief Jobs not decoded yet, oldest first
+  fifo<job*> jobs;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+pipeline::pipeline( std::size_t nb_io_threads, std::size_t nb_parsers, std::size_t buffer_size
+                  , std::size_t max_pending)
+  : m_io{}
+  , m_pool{buffer_size}
+  , m_nb_io_threads{nb_io_threads == 0 ? 1 : nb_io_threads}
+  , m_max_pending{max_pending == 0 ? 1 : max_pending}
+  , m_devices{}
+  , m_states{}
+  , m_queues{}
+  , m_jobs_mutex{}
+  , m_jobs{}
+  , m_free_jobs{}
+  , m_queued{0}
+  , m_stopping{false}
+  , m_wakeup_mutex{}
+  , m_wakeup{}
+  , m_handler{}
+  , m_error_handler{}
+  , m_handler_error_handler{}
+  , m_work{}
+  , m_io_threads{}
+  , m_parsers{}
+  , m_scans{0}
+  , m_invalid_telegrams{0}
+  , m_dropped_telegrams{0}
+  , m_handler_errors{0}
+  , m_queue_time{}
+  , m_parse_time{}
+  , m_order_time{}
+  , m_handler_time{}
+  , m_total_time{}
+{
+  if (nb_parsers == 0)
+  {
+    nb_parsers = std::max(1u, std::thread::hardware_concurrency());
+  }
+  for (auto i = std::size_t{0}; i < nb_parsers; ++i)
+  {
+    m_queues.emplace_back(new parser_queue{m_max_pending});
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+pipeline::~pipeline()
+{
+  stop();
+  for (auto& device : m_devices)
+  {
+    device->disconnect();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+LMS1xx&
+pipeline::add( const std::string& host, const std::string& port
+             , const boost::posix_time::time_duration& timeout, protocol p)
+{
+  std::unique_ptr<LMS1xx> device{new LMS1xx{m_io, timeout, p, &m_pool}};
+  device->connect(host, port);
+  m_states.emplace_back(new device_state{m_max_pending});
+  m_devices.push_back(std::move(device));
+  return *m_devices.back();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+pipeline::size()
+const noexcept
+{
+  return m_devices.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+LMS1xx&
+pipeline::operator[](std::size_t device)
+noexcept
+{
+  return *m_devices[device];
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+pipeline::nb_parsers()
+const noexcept
+{
+  return m_queues.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::start( device_scan_handler handler, device_error_handler on_error
+               , error_handler on_handler_error)
+{
+  if (running())
+  {
+    return;
+  }
+
+  m_handler = std::move(handler);
+  m_error_handler = std::move(on_error);
+  m_handler_error_handler = std::move(on_handler_error);
+  m_stopping = false;
+
+  // Parsers are ready before the first telegram is framed.
+  for (auto i = std::size_t{0}; i < m_queues.size(); ++i)
+  {
+    m_parsers.emplace_back([this, i]{ parse(i); });
+  }
+
+  for (auto i = std::size_t{0}; i < m_devices.size(); ++i)
+  {
+    m_states[i]->layout = m_devices[i]->get_layout_parser();
+    m_states[i]->failed = false;
+    m_devices[i]->start_telegram_stream( [this, i](const char* first, const char* last)
+                                         {
+                                           frame(i, first, last);
+                                         }
+                                       , [this, i](std::exception_ptr error)
+                                         {
+                                           if (m_error_handler)
+                                           {
+                                             m_error_handler(i, error);
+                                           }
+                                         });
+  }
+
+  m_work.reset(new boost::asio::io_service::work{m_io});
+  for (auto i = std::size_t{0}; i < m_nb_io_threads; ++i)
+  {
+    m_io_threads.emplace_back([this]
+    {
+      run_io(m_io, [this](std::exception_ptr error){ handler_error(error); });
+    });
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::stop()
+{
+  if (not running())
+  {
+    return;
+  }
+
+  for (auto& device : m_devices)
+  {
+    device->stop_stream();
+  }
+
+  m_work.reset();
+  m_io.stop();
+  for (auto& thread : m_io_threads)
+  {
+    thread.join();
+  }
+  m_io_threads.clear();
+  m_io.reset();
+
+  {
+    std::lock_guard<std::mutex> lock{m_wakeup_mutex};
+    m_stopping = true;
+  }
+  m_wakeup.notify_all();
+  for (auto& thread : m_parsers)
+  {
+    thread.join();
+  }
+  m_parsers.clear();
+
+  // Every job is pending for its device until its scan is handled.
+  for (auto& queue : m_queues)
+  {
+    queue->jobs.clear();
+  }
+  for (auto& state : m_states)
+  {
+    while (not state->pending.empty())
+    {
+      const auto j = state->pending.front();
+      state->pending.pop_front();
+      if (j->telegram != nullptr)
+      {
+        m_pool.release(j->telegram);
+      }
+      release_job(j);
+    }
+    state->delivering = false;
+  }
+  m_queued = 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+pipeline::running()
+const noexcept
+{
+  return not m_io_threads.empty();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const buffer_pool&
+pipeline::pool()
+const noexcept
+{
+  return m_pool;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+pipeline_statistics
+pipeline::get_statistics()
+const noexcept
+{
+  auto s = pipeline_statistics{};
+  s.scans = m_scans.load(std::memory_order_relaxed);
+  s.invalid_telegrams = m_invalid_telegrams.load(std::memory_order_relaxed);
+  s.dropped_telegrams = m_dropped_telegrams.load(std::memory_order_relaxed);
+  s.handler_errors = m_handler_errors.load(std::memory_order_relaxed);
+  s.queue_time = m_queue_time.snapshot();
+  s.parse_time = m_parse_time.snapshot();
+  s.order_time = m_order_time.snapshot();
+  s.handler_time = m_handler_time.snapshot();
+  s.total_time = m_total_time.snapshot();
+  return s;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::reset_statistics()
+noexcept
+{
+  m_scans = 0;
+  m_invalid_telegrams = 0;
+  m_dropped_telegrams = 0;
+  m_handler_errors = 0;
+  m_queue_time.reset();
+  m_parse_time.reset();
+  m_order_time.reset();
+  m_handler_time.reset();
+  m_total_time.reset();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::frame(std::size_t device, const char* first, const char* last)
+{
+  const auto framed = clock_type::now();
+  auto& state = *m_states[device];
+  if (state.failed)
+  {
+    return;
+  }
+
+  // Slow parsers must not hold up I/O threads.
+  const auto j = acquire_job();
+  if (j == nullptr)
+  {
+    m_dropped_telegrams.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  try
+  {
+    j->telegram = m_pool.acquire();
+  }
+  catch (...)
+  {
+    release_job(j);
+    throw;
+  }
+  j->device = device;
+  j->size = static_cast<std::size_t>(last - first);
+  j->framed = framed;
+  j->done = false;
+  std::copy(first, last, j->telegram);
+
+  // Telegrams of a device are framed on its strand: they are pending in order.
+  {
+    std::lock_guard<std::mutex> lock{state.mutex};
+    state.pending.push_back(j);
+  }
+  {
+    auto& queue = *m_queues[device % m_queues.size()];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    queue.jobs.push_back(j);
+  }
+  m_queued.fetch_add(1);
+
+  // A parser about to wait sees either the new count or the notification.
+  {
+    std::lock_guard<std::mutex> lock{m_wakeup_mutex};
+  }
+  m_wakeup.notify_one();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::parse(std::size_t parser)
+{
+  while (true)
+  {
+    const auto j = next_job(parser);
+    if (j == nullptr)
+    {
+      std::unique_lock<std::mutex> lock{m_wakeup_mutex};
+      m_wakeup.wait(lock, [this]{ return m_stopping or m_queued.load() != 0; });
+      if (m_stopping)
+      {
+        return;
+      }
+      continue;
+    }
+    decode(*j);
+    complete(*j);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+pipeline::job*
+pipeline::next_job(std::size_t parser)
+noexcept
+{
+  // Start with the own queue of the parser, then steal from the following ones.
+  for (auto i = std::size_t{0}; i < m_queues.size(); ++i)
+  {
+    auto& queue = *m_queues[(parser + i) % m_queues.size()];
+    std::lock_guard<std::mutex> lock{queue.mutex};
+    if (not queue.jobs.empty())
+    {
+      const auto j = queue.jobs.front();
+      queue.jobs.pop_front();
+      m_queued.fetch_sub(1);
+      return j;
+    }
+  }
+  return nullptr;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::decode(job& j)
+noexcept
+{
+  const auto start = clock_type::now();
+  const auto first = static_cast<const char*>(j.telegram);
+  const auto last = first + j.size;
+  auto ec = std::error_code{};
+  const auto& layout = m_states[j.device]->layout;
+  if (layout)
+  {
+    layout->parse(first, last, j.data, ec);
+  }
+  else
+  {
+    parse_scan_data(first, last, j.data, {}, ec);
+  }
+  j.parsed = clock_type::now();
+  j.valid = not ec;
+
+  m_pool.release(j.telegram);
+  j.telegram = nullptr;
+  m_queue_time.record(elapsed_ns(j.framed, start));
+  m_parse_time.record(elapsed_ns(start, j.parsed));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::complete(job& j)
+{
+  auto& state = *m_states[j.device];
+  std::unique_lock<std::mutex> lock{state.mutex};
+  j.done = true;
+
+  // The parser already delivering scans of the device will find this one.
+  if (state.delivering)
+  {
+    return;
+  }
+  state.delivering = true;
+  while (not state.pending.empty() and state.pending.front()->done)
+  {
+    const auto next = state.pending.front();
+    state.pending.pop_front();
+    lock.unlock();
+    deliver(*next);
+    lock.lock();
+  }
+  state.delivering = false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::deliver(job& j)
+{
+  auto& state = *m_states[j.device];
+  if (not j.valid)
+  {
+    m_invalid_telegrams.fetch_add(1, std::memory_order_relaxed);
+  }
+  else if (not state.failed)
+  {
+    const auto start = clock_type::now();
+    try
+    {
+      m_handler(j.device, j.data);
+    }
+    catch (...)
+    {
+      state.failed = true;
+      m_devices[j.device]->stop_stream();
+      if (m_error_handler)
+      {
+        try
+        {
+          m_error_handler(j.device, std::current_exception());
+        }
+        catch (...)
+        {
+          handler_error(std::current_exception());
+        }
+      }
+    }
+    const auto end = clock_type::now();
+    m_scans.fetch_add(1, std::memory_order_relaxed);
+    m_order_time.record(elapsed_ns(j.parsed, start));
+    m_handler_time.record(elapsed_ns(start, end));
+    m_total_time.record(elapsed_ns(j.framed, end));
+  }
+  release_job(&j);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::handler_error(std::exception_ptr error)
+noexcept
+{
+  m_handler_errors.fetch_add(1, std::memory_order_relaxed);
+  if (m_handler_error_handler)
+  {
+    m_handler_error_handler(error);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+pipeline::job*
+pipeline::acquire_job()
+{
+  std::lock_guard<std::mutex> lock{m_jobs_mutex};
+  if (m_free_jobs.empty())
+  {
+    if (m_jobs.size() == m_max_pending)
+    {
+      return nullptr;
+    }
+    m_jobs.emplace_back(new job{});
+    // Make sure release_job() won't have to allocate.
+    m_free_jobs.reserve(m_jobs.size());
+    return m_jobs.back().get();
+  }
+  const auto j = m_free_jobs.back();
+  m_free_jobs.pop_back();
+  return j;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+pipeline::release_job(job* j)
+noexcept
+{
+  std::lock_guard<std::mutex> lock{m_jobs_mutex};
+  m_free_jobs.push_back(j);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+
+#include "lms1xx/buffer_pool.hh"
+#include "lms1xx/device_group.hh"
+#include "lms1xx/lms1xx.hh"
+#include "lms1xx/telemetry.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Statistics about the scans of a pipeline, for all devices
+///
+/// Times are measured from the moment a telegram is framed by an I/O thread.
+struct pipeline_statistics
+{
+  /// @brief Number of scans given to the handler
+  std::uint64_t scans;
+
+  /// @brief Number of telegrams which couldn't be decoded
+  std::uint64_t invalid_telegrams;
+
+  /// @brief Number of telegrams dropped because too many others were waiting
+  std::uint64_t dropped_telegrams;
+
+  /// @brief Number of exceptions thrown by the error handler
+  std::uint64_t handler_errors;
+
+  /// @brief Time spent by each telegram in the queues of parsers, in nanoseconds
+  histogram_snapshot queue_time;
+
+  /// @brief Time spent to decode each scan, in nanoseconds
+  histogram_snapshot parse_time;
+
+  /// @brief Time spent by each decoded scan waiting for the previous scans of its device, in
+  /// nanoseconds
+  histogram_snapshot order_time;
+
+  /// @brief Time spent in the handler for each scan, in nanoseconds
+  histogram_snapshot handler_time;
+
+  /// @brief Time between the framing of each telegram and the return of the handler of its scan,
+  /// in nanoseconds
+  histogram_snapshot total_time;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Several devices whose telegrams are received and decoded by separate pools of threads
+///
+/// I/O threads only receive bytes and frame telegrams, which are copied into buffers of a pool.
+/// Parser threads decode them: each parser has its own queue, fed with the telegrams of some
+/// devices, and takes the oldest telegram of another queue when its own one is empty. Thus,
+/// decoding scales with the number of parsers, whatever the number of devices. Scans of a device
+/// are given to the handler in the order of their telegrams.
+class pipeline final
+{
+public:
+
+  /// @brief Can't copy-construct a pipeline
+  pipeline(const pipeline&) = delete;
+
+  /// @brief Can't copy a pipeline
+  pipeline& operator=(const pipeline&) = delete;
+
+  /// @brief Constructor
+  /// @param nb_io_threads Number of threads which receive and frame telegrams
+  /// @param nb_parsers Number of threads which decode telegrams, 0 for one per core
+  /// @param buffer_size Size of receive buffers, large enough for the longest telegram
+  /// @param max_pending Maximal number of telegrams framed but whose scans aren't handled yet,
+  /// following telegrams are dropped
+  explicit
+  pipeline( std::size_t nb_io_threads = 1, std::size_t nb_parsers = 0
+          , std::size_t buffer_size = 65536, std::size_t max_pending = 256);
+
+  /// @brief Destructor
+  ///
+  /// Stop the pipeline and disconnect all devices.
+  ~pipeline();
+
+  /// @brief Connect to a new device
+  /// @return The new device, to configure it while the pipeline is stopped
+  /// @note Can't be called while the pipeline is started
+  LMS1xx&
+  add( const std::string& host, const std::string& port
+     , const boost::posix_time::time_duration& timeout = boost::posix_time::seconds{30}
+     , protocol p = protocol::cola_a);
+
+  /// @brief Number of devices
+  std::size_t
+  size()
+  const noexcept;
+
+  /// @brief Get a device
+  LMS1xx&
+  operator[](std::size_t device)
+  noexcept;
+
+  /// @brief Number of threads which decode telegrams
+  std::size_t
+  nb_parsers()
+  const noexcept;
+
+  /// @brief Start streaming scans of all devices
+  /// @param handler Called for each scan, from the parser threads
+  /// @param on_error Called when an error stops the stream of a device, others keep streaming
+  /// @param on_handler_error Called, from the I/O or parser threads, with the exceptions thrown by
+  /// on_error; must not throw
+  ///
+  /// Continuous acquisition must have been started on each device. Telegrams are decoded by the
+  /// parser selected by the scan data configuration of their device (see
+  /// LMS1xx::get_layout_parser()); scan filters and sector reductions of devices don't apply.
+  /// Handlers of a given device never run concurrently, but handlers of different devices do. An
+  /// exception thrown by a handler stops the stream of its device, and is given to on_error. An
+  /// exception thrown by on_error is counted in pipeline_statistics::handler_errors.
+  void
+  start( device_scan_handler handler, device_error_handler on_error = nullptr
+       , error_handler on_handler_error = nullptr);
+
+  /// @brief Stop streaming scans and wait for all threads
+  ///
+  /// Telegrams whose scans weren't handled yet are dropped.
+  void
+  stop();
+
+  /// @brief Tell if the pipeline is started
+  bool
+  running()
+  const noexcept;
+
+  /// @brief The pool of receive buffers and of framed telegrams
+  const buffer_pool&
+  pool()
+  const noexcept;
+
+  /// @brief Get statistics about the scans of all devices
+  pipeline_statistics
+  get_statistics()
+  const noexcept;
+
+  /// @brief Reset statistics
+  void
+  reset_statistics()
+  noexcept;
+
+private:
+
+  struct job;
+  struct device_state;
+  struct parser_queue;
+
+  /// @brief Queue a telegram framed by an I/O thread
+  void
+  frame(std::size_t device, const char* first, const char* last);
+
+  /// @brief Decode telegrams until the pipeline is stopped, on a parser thread
+  void
+  parse(std::size_t parser);
+
+  /// @brief Take the oldest telegram of the queue of a parser, or of another one
+  /// @return nullptr if all queues are empty
+  job*
+  next_job(std::size_t parser)
+  noexcept;
+
+  /// @brief Decode the telegram of a job, and give its buffer back to the pool
+  void
+  decode(job& j)
+  noexcept;
+
+  /// @brief Give the scans of a device to the handler, as long as they are decoded in order
+  /// @param j The job which was just decoded
+  void
+  complete(job& j);
+
+  /// @brief Give a scan to the handler
+  void
+  deliver(job& j);
+
+  /// @brief Count and report an exception thrown by the error handler
+  void
+  handler_error(std::exception_ptr error)
+  noexcept;
+
+  /// @brief Get an unused job
+  /// @return nullptr if max_pending jobs are in use
+  job*
+  acquire_job();
+
+  /// @brief Give back a job obtained with acquire_job()
+  void
+  release_job(job* j)
+  noexcept;
+
+private:
+
+  /// @brief Shared by all devices
+  boost::asio::io_service m_io;
+
+  /// @brief Receive buffers of devices and framed telegrams
+  buffer_pool m_pool;
+
+  /// @brief Number of threads which run m_io
+  const std::size_t m_nb_io_threads;
+
+  /// @brief Maximal number of jobs
+  const std::size_t m_max_pending;
+
+  /// @brief The devices
+  std::vector<std::unique_ptr<LMS1xx>> m_devices;
+
+  /// @brief The scans of each device
+  std::vector<std::unique_ptr<device_state>> m_states;
+
+  /// @brief The telegrams waiting for each parser
+  std::vector<std::unique_ptr<parser_queue>> m_queues;
+
+  /// @brief Protect m_jobs and m_free_jobs
+  std::mutex m_jobs_mutex;
+
+  /// @brief All allocated jobs
+  std::vector<std::unique_ptr<job>> m_jobs;
+
+  /// @brief Jobs not in use
+  std::vector<job*> m_free_jobs;
+
+  /// @brief Number of telegrams in all queues
+  std::atomic<std::size_t> m_queued;
+
+  /// @brief True when parsers must stop
+  std::atomic<bool> m_stopping;
+
+  /// @brief Protect the wake up of parsers
+  std::mutex m_wakeup_mutex;
+
+  /// @brief Wake up parsers when telegrams are queued
+  std::condition_variable m_wakeup;
+
+  /// @brief Called for each scan
+  device_scan_handler m_handler;
+
+  /// @brief Called when an error stops the stream of a device
+  device_error_handler m_error_handler;
+
+  /// @brief Called with the exceptions thrown by m_error_handler
+  error_handler m_handler_error_handler;
+
+  /// @brief Keep m_io running while the pipeline is started
+  std::unique_ptr<boost::asio::io_service::work> m_work;
+
+  /// @brief Run m_io while the pipeline is started
+  std::vector<std::thread> m_io_threads;
+
+  /// @brief Decode telegrams while the pipeline is started
+  std::vector<std::thread> m_parsers;
+
+  /// @brief Number of handled scans
+  std::atomic<std::uint64_t> m_scans;
+
+  /// @brief Number of invalid telegrams
+  std::atomic<std::uint64_t> m_invalid_telegrams;
+
+  /// @brief Number of dropped telegrams
+  std::atomic<std::uint64_t> m_dropped_telegrams;
+
+  /// @brief Number of exceptions thrown by m_error_handler
+  std::atomic<std::uint64_t> m_handler_errors;
+
+  /// @brief Times spent in queues, in nanoseconds
+  histogram m_queue_time;
+
+  /// @brief Decoding times, in nanoseconds
+  histogram m_parse_time;
+
+  /// @brief Times spent waiting for previous scans, in nanoseconds
+  histogram m_order_time;
+
+  /// @brief Times spent in the handler, in nanoseconds
+  histogram m_handler_time;
+
+  /// @brief Times from framing to the return of the handler, in nanoseconds
+  histogram m_total_time;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
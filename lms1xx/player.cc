@@ -0,0 +1,477 @@
+#include <algorithm> // min
+#include <memory>
+#include <stdexcept>
+
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/parser.hh"
+#include "lms1xx/player.hh"
+#include "lms1xx/recording.hh"
+#include "lms1xx/scan_ring.hh"
+
+namespace lms1xx {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_header&
+header_of(const scan_data& data)
+noexcept
+{
+  return data.header;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_header&
+header_of(const compact_scan& data)
+noexcept
+{
+  return data.header();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Throw the exception matching an error of get_data(), if any
+void
+throw_on_error(const std::error_code& ec)
+{
+  if (ec == errc::end_of_recording)
+  {
+    throw end_of_recording{};
+  }
+  if (ec)
+  {
+    throw invalid_telegram_error{};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+player::player(const recording& rec, double speed, bool loop)
+  : player{&rec, {}, speed, loop}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+player::player(std::vector<std::string> telegrams, double speed, bool loop)
+  : player{nullptr, std::move(telegrams), speed, loop}
+{
+  time_telegrams();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+player::player(const recording* rec, std::vector<std::string> telegrams, double speed, bool loop)
+  : m_recording{rec}
+  , m_telegrams{std::move(telegrams)}
+  , m_times{}
+  , m_speed{speed}
+  , m_loop{loop}
+  , m_position{0}
+  , m_paced{false}
+  , m_start{}
+  , m_origin{0}
+  , m_telemetry{}
+  , m_streaming{false}
+  , m_mutex{}
+  , m_stopped{}
+  , m_scan_handler{}
+  , m_ring{nullptr}
+  , m_stream_data{}
+  , m_stream_thread{}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+player::~player()
+{
+  stop_stream();
+  if (m_stream_thread.joinable())
+  {
+    m_stream_thread.join();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::time_telegrams()
+{
+  std::unique_ptr<scan_data> data{new scan_data};
+  auto time = std::int64_t{0};
+  auto period = std::int64_t{0};
+  m_times.reserve(m_telegrams.size());
+  for (const auto& telegram : m_telegrams)
+  {
+    auto ec = std::error_code{};
+    parse_scan_data(telegram.data(), telegram.data() + telegram.size(), *data, {}, ec);
+    // An invalid telegram is delivered along with the next valid one.
+    if (not ec)
+    {
+      const auto& header = data->header;
+      if (header.has_timestamp)
+      {
+        time = microseconds_since_epoch(header.timestamp);
+      }
+      else
+      {
+        time += period;
+        // Scanning frequency is in 1/100 Hz.
+        period = header.scanning_frequency != 0 ? 100000000 / header.scanning_frequency : 0;
+      }
+    }
+    m_times.push_back(time);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+player::size()
+const noexcept
+{
+  return m_recording ? m_recording->size() : m_telegrams.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+player::position()
+const noexcept
+{
+  return m_position;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::seek(std::size_t position)
+noexcept
+{
+  m_position = std::min(position, size());
+  m_paced = false;
+  m_telemetry.restart();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+player::wait_next()
+{
+  if (m_position == size())
+  {
+    if (not m_loop or size() == 0)
+    {
+      return false;
+    }
+    seek(0);
+  }
+
+  if (m_speed <= 0)
+  {
+    return true;
+  }
+
+  const auto time = m_recording ? (*m_recording)[m_position].time() : m_times[m_position];
+  if (not m_paced)
+  {
+    m_paced = true;
+    m_start = std::chrono::steady_clock::now();
+    m_origin = time;
+    return true;
+  }
+
+  const auto delay = std::chrono::duration<double, std::micro>{(time - m_origin) / m_speed};
+  const auto due = m_start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay);
+  if (not m_streaming)
+  {
+    std::this_thread::sleep_until(due);
+    return true;
+  }
+
+  std::unique_lock<std::mutex> lock{m_mutex};
+  return not m_stopped.wait_until(lock, due, [this]{ return not m_streaming; });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Scan>
+void
+player::load_next(Scan& data, std::error_code& ec)
+{
+  const auto start = std::chrono::steady_clock::now();
+  const auto position = m_position++;
+  load(position, data, ec);
+  if (ec)
+  {
+    m_telemetry.framing_error();
+    return;
+  }
+  const auto parse_time = std::chrono::steady_clock::now() - start;
+
+  if (not m_recording)
+  {
+    m_telemetry.received(m_telegrams[position].size());
+  }
+  // The latency of a replayed scan would only tell how old the recording is.
+  auto header = header_of(data);
+  header.has_timestamp = false;
+  m_telemetry.scan(header, std::chrono::duration_cast<std::chrono::nanoseconds>(parse_time));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::load(std::size_t position, scan_data& data, std::error_code& ec)
+{
+  if (m_recording)
+  {
+    ec.clear();
+    try
+    {
+      (*m_recording)[position].copy(data);
+    }
+    catch (const std::invalid_argument&)
+    {
+      ec = errc::invalid_telegram;
+    }
+  }
+  else
+  {
+    const auto& telegram = m_telegrams[position];
+    parse_scan_data(telegram.data(), telegram.data() + telegram.size(), data, {}, ec);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::load(std::size_t position, compact_scan& data, std::error_code& ec)
+{
+  if (m_recording)
+  {
+    ec.clear();
+    try
+    {
+      (*m_recording)[position].copy(data);
+    }
+    catch (const std::invalid_argument&)
+    {
+      ec = errc::invalid_telegram;
+    }
+  }
+  else
+  {
+    const auto& telegram = m_telegrams[position];
+    parse_scan_data(telegram.data(), telegram.data() + telegram.size(), data, {}, ec);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_data
+player::get_data()
+{
+  auto data = scan_data{};
+  get_data(data);
+  return data;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::get_data(scan_data& data)
+{
+  auto ec = std::error_code{};
+  get_data(data, ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::get_data(compact_scan& data)
+{
+  auto ec = std::error_code{};
+  get_data(data, ec);
+  throw_on_error(ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::get_data(scan_data& data, std::error_code& ec)
+{
+  if (not wait_next())
+  {
+    ec = errc::end_of_recording;
+    return;
+  }
+  load_next(data, ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::get_data(compact_scan& data, std::error_code& ec)
+{
+  if (not wait_next())
+  {
+    ec = errc::end_of_recording;
+    return;
+  }
+  load_next(data, ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::start_stream(scan_handler handler, error_handler on_error)
+{
+  m_scan_handler = std::move(handler);
+  m_ring = nullptr;
+  start_stream_thread(std::move(on_error));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::start_stream(scan_ring& ring, error_handler on_error)
+{
+  m_scan_handler = nullptr;
+  m_ring = &ring;
+  start_stream_thread(std::move(on_error));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::start_stream_thread(error_handler on_error)
+{
+  if (m_stream_thread.joinable())
+  {
+    m_stream_thread.join();
+  }
+
+  m_streaming = true;
+  m_paced = false;
+  m_stream_thread = std::thread{[this, on_error]
+  {
+    try
+    {
+      stream();
+    }
+    catch (...)
+    {
+      m_streaming = false;
+      if (on_error)
+      {
+        on_error(std::current_exception());
+      }
+    }
+  }};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::run_stream(scan_handler handler)
+{
+  m_scan_handler = std::move(handler);
+  m_ring = nullptr;
+  m_streaming = true;
+  m_paced = false;
+  try
+  {
+    stream();
+  }
+  catch (...)
+  {
+    m_streaming = false;
+    throw;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::stream()
+{
+  while (m_streaming and wait_next())
+  {
+    auto& data = m_ring ? m_ring->acquire_write() : m_stream_data;
+    auto ec = std::error_code{};
+    load_next(data, ec);
+    if (ec)
+    {
+      continue;
+    }
+
+    if (m_ring)
+    {
+      m_ring->commit_write();
+    }
+    else
+    {
+      m_scan_handler(data);
+    }
+  }
+  m_streaming = false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::stop_stream()
+{
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    if (not m_streaming)
+    {
+      return;
+    }
+    m_streaming = false;
+  }
+  m_stopped.notify_all();
+
+  if (m_stream_thread.joinable() and m_stream_thread.get_id() != std::this_thread::get_id())
+  {
+    m_stream_thread.join();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+player::streaming()
+const noexcept
+{
+  return m_streaming;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+statistics
+player::get_statistics()
+const noexcept
+{
+  return m_telemetry.snapshot();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+player::reset_statistics()
+noexcept
+{
+  m_telemetry.reset();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
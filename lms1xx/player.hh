@@ -0,0 +1,249 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "lms1xx/lms1xx.hh"
+#include "lms1xx/telemetry.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+class recording;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Thrown by player::get_data() when all scans have been delivered
+class end_of_recording final
+  : public std::exception
+{};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Replay recorded scans through the same interface as a device
+///
+/// Scans come either from a recording, or from raw LMDscandata telegrams which are decoded when
+/// delivered, exactly as if they had been received from a device. They are delivered at the pace
+/// they were recorded, multiplied by a speed factor, or as fast as possible.
+///
+/// Scans are paced by their time in a recording. Telegrams are paced by their timestamp when
+/// present, by their scanning frequency otherwise. A consumer slower than the pace receives the
+/// next scans without delay until it catches up, no scan is dropped.
+///
+/// Statistics are collected as for a device, except latencies which are meaningless for old scans.
+class player final
+  : public scan_source
+{
+public:
+
+  /// @brief Can't copy-construct a player
+  player(const player&) = delete;
+
+  /// @brief Can't copy a player
+  player& operator=(const player&) = delete;
+
+  /// @brief Replay a recording
+  /// @param rec Must outlive the player
+  /// @param speed Factor applied to the recorded pace, 0 to deliver scans as fast as possible
+  /// @param loop Restart from the first scan after the last one
+  explicit
+  player(const recording& rec, double speed = 1, bool loop = false);
+
+  /// @brief Replay raw telegrams
+  /// @param telegrams LMDscandata telegrams, in CoLa-A or CoLa-B
+  /// @param speed Factor applied to the recorded pace, 0 to deliver scans as fast as possible
+  /// @param loop Restart from the first telegram after the last one
+  explicit
+  player(std::vector<std::string> telegrams, double speed = 1, bool loop = false);
+
+  /// @brief Destructor
+  ///
+  /// Stop streaming.
+  ~player();
+
+  /// @brief Number of scans to replay
+  std::size_t
+  size()
+  const noexcept;
+
+  /// @brief Position of the next scan to deliver
+  std::size_t
+  position()
+  const noexcept;
+
+  /// @brief Set the position of the next scan to deliver
+  ///
+  /// Pacing restarts from this scan. Must not be called while streaming.
+  void
+  seek(std::size_t position)
+  noexcept;
+
+  /// @brief Deliver the next scan, once it is due
+  /// @throw end_of_recording when all scans have been delivered
+  scan_data
+  get_data() override;
+
+  /// @brief Deliver the next scan into an existing scan, once it is due
+  /// @throw end_of_recording when all scans have been delivered
+  /// @throw invalid_telegram_error if the telegram is invalid
+  void
+  get_data(scan_data& data) override;
+
+  /// @brief Deliver the next scan into a compact scan, once it is due
+  /// @throw end_of_recording when all scans have been delivered
+  /// @throw invalid_telegram_error if the telegram is invalid or doesn't fit in data
+  void
+  get_data(compact_scan& data) override;
+
+  /// @brief Deliver the next scan into an existing scan, without throwing
+  /// @param ec Set to errc::end_of_recording when all scans have been delivered, to
+  /// errc::invalid_telegram if the telegram is invalid, cleared otherwise
+  void
+  get_data(scan_data& data, std::error_code& ec) override;
+
+  /// @brief Deliver the next scan into a compact scan, without throwing
+  void
+  get_data(compact_scan& data, std::error_code& ec) override;
+
+  /// @brief Deliver scans asynchronously, from a background thread
+  /// @param handler Called for each scan, once it is due
+  /// @param on_error Called when an exception thrown by handler stops streaming
+  ///
+  /// Streaming stops after the last scan, unless looping. Invalid telegrams are skipped.
+  void
+  start_stream(scan_handler handler, error_handler on_error = nullptr) override;
+
+  /// @brief Decode scans asynchronously into a ring, from a background thread
+  void
+  start_stream(scan_ring& ring, error_handler on_error = nullptr) override;
+
+  /// @brief Deliver scans on the calling thread, until stop_stream() is called or after the last
+  /// scan
+  ///
+  /// Exceptions thrown by handler are propagated. Invalid telegrams are skipped.
+  void
+  run_stream(scan_handler handler) override;
+
+  /// @brief Stop delivering scans
+  ///
+  /// Wait for the background thread, unless called from a handler.
+  void
+  stop_stream() override;
+
+  /// @brief Tell if scans are being delivered asynchronously
+  bool
+  streaming()
+  const noexcept override;
+
+  /// @brief Get statistics about delivered scans
+  statistics
+  get_statistics()
+  const noexcept override;
+
+  /// @brief Reset statistics about delivered scans
+  void
+  reset_statistics()
+  noexcept override;
+
+private:
+
+  /// @brief Constructor shared by the other ones
+  player(const recording* rec, std::vector<std::string> telegrams, double speed, bool loop);
+
+  /// @brief Compute the time of each telegram
+  void
+  time_telegrams();
+
+  /// @brief Wait until the next scan is due
+  /// @return false if all scans have been delivered, or if streaming was stopped meanwhile
+  bool
+  wait_next();
+
+  /// @brief Decode the next scan and advance the position
+  template <typename Scan>
+  void
+  load_next(Scan& data, std::error_code& ec);
+
+  /// @brief Decode a scan
+  void
+  load(std::size_t position, scan_data& data, std::error_code& ec);
+
+  /// @brief Decode a scan
+  void
+  load(std::size_t position, compact_scan& data, std::error_code& ec);
+
+  /// @brief Start the background thread of start_stream()
+  void
+  start_stream_thread(error_handler on_error);
+
+  /// @brief Deliver scans until the end or until streaming is stopped
+  void
+  stream();
+
+private:
+
+  /// @brief Scans to replay, if replaying a recording
+  const recording* m_recording;
+
+  /// @brief Telegrams to replay, if not replaying a recording
+  std::vector<std::string> m_telegrams;
+
+  /// @brief Time of each telegram, in microseconds
+  std::vector<std::int64_t> m_times;
+
+  /// @brief Factor applied to the recorded pace, 0 for no pacing
+  double m_speed;
+
+  /// @brief Restart from the first scan after the last one
+  bool m_loop;
+
+  /// @brief The position of the next scan
+  std::size_t m_position;
+
+  /// @brief Tell if m_start and m_origin are set
+  bool m_paced;
+
+  /// @brief When pacing started
+  std::chrono::steady_clock::time_point m_start;
+
+  /// @brief Time of the scan delivered when pacing started, in microseconds
+  std::int64_t m_origin;
+
+  /// @brief Statistics about delivered scans
+  telemetry m_telemetry;
+
+  /// @brief Tell if streaming
+  std::atomic<bool> m_streaming;
+
+  /// @brief Protect waits for the next scan while streaming
+  std::mutex m_mutex;
+
+  /// @brief Notified when streaming is stopped
+  std::condition_variable m_stopped;
+
+  /// @brief Called for each scan while streaming
+  scan_handler m_scan_handler;
+
+  /// @brief Where to decode scans while streaming, instead of m_stream_data
+  scan_ring* m_ring;
+
+  /// @brief The scan given to m_scan_handler, reused for each scan
+  scan_data m_stream_data;
+
+  /// @brief Run stream() for start_stream()
+  std::thread m_stream_thread;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,173 @@
+#include <algorithm> // min
+#include <cmath>
+
+#ifdef __SSE2__
+# include <emmintrin.h>
+#endif
+
+#include "lms1xx/projector.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+projector::projector(const scan_output_range& range, float scale)
+  : m_range{0, 0, 0}
+  , m_scale{scale}
+  , m_cos{}
+  , m_sin{}
+{
+  set_range(range);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+projector::set_range(const scan_output_range& range)
+{
+  if (    not m_cos.empty()
+      and range.angle_resolution == m_range.angle_resolution
+      and range.start_angle == m_range.start_angle
+      and range.stop_angle == m_range.stop_angle)
+  {
+    return;
+  }
+
+  const auto n = nb_points(range);
+  m_cos.resize(n);
+  m_sin.resize(n);
+  for (auto i = std::size_t{0}; i < n; ++i)
+  {
+    // 90 degrees in the frame of the device is the x axis.
+    const auto degrees = (range.start_angle + static_cast<double>(i) * range.angle_resolution)
+                       / 10000.0 - 90.0;
+    const auto radians = degrees * M_PI / 180.0;
+    m_cos[i] = static_cast<float>(std::cos(radians) * m_scale);
+    m_sin[i] = static_cast<float>(std::sin(radians) * m_scale);
+  }
+  m_range = range;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_output_range&
+projector::range()
+const noexcept
+{
+  return m_range;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+projector::size()
+const noexcept
+{
+  return m_cos.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+projector::project(const std::uint16_t* dist, std::size_t n, point* out)
+const noexcept
+{
+  n = std::min(n, size());
+  const auto c = m_cos.data();
+  const auto s = m_sin.data();
+  auto xy = reinterpret_cast<float*>(out);
+  auto i = std::size_t{0};
+
+#ifdef __SSE2__
+  // 8 distances at a time, x and y interleaved.
+  const auto zero = _mm_setzero_si128();
+  for (; i + 8 <= n; i += 8)
+  {
+    const auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dist + i));
+    const auto lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(d, zero));
+    const auto hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(d, zero));
+
+    const auto x_lo = _mm_mul_ps(lo, _mm_loadu_ps(c + i));
+    const auto y_lo = _mm_mul_ps(lo, _mm_loadu_ps(s + i));
+    const auto x_hi = _mm_mul_ps(hi, _mm_loadu_ps(c + i + 4));
+    const auto y_hi = _mm_mul_ps(hi, _mm_loadu_ps(s + i + 4));
+
+    _mm_storeu_ps(xy + 2 * i,      _mm_unpacklo_ps(x_lo, y_lo));
+    _mm_storeu_ps(xy + 2 * i + 4,  _mm_unpackhi_ps(x_lo, y_lo));
+    _mm_storeu_ps(xy + 2 * i + 8,  _mm_unpacklo_ps(x_hi, y_hi));
+    _mm_storeu_ps(xy + 2 * i + 12, _mm_unpackhi_ps(x_hi, y_hi));
+  }
+#endif
+
+  for (; i < n; ++i)
+  {
+    const auto d = static_cast<float>(dist[i]);
+    xy[2 * i] = d * c[i];
+    xy[2 * i + 1] = d * s[i];
+  }
+  return n;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+projector::project( const std::uint16_t* dist, const std::uint16_t* intensity, std::size_t n
+                  , point_intensity* out)
+const noexcept
+{
+  n = std::min(n, size());
+  const auto c = m_cos.data();
+  const auto s = m_sin.data();
+  for (auto i = std::size_t{0}; i < n; ++i)
+  {
+    const auto d = static_cast<float>(dist[i]);
+    out[i].x = d * c[i];
+    out[i].y = d * s[i];
+    out[i].intensity = static_cast<float>(intensity[i]);
+  }
+  return n;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+projector::project(const scan_data& data, point* out)
+const noexcept
+{
+  return project(data.dist1, static_cast<std::size_t>(data.dist_len1), out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+projector::project(const scan_data& data, point_intensity* out)
+const noexcept
+{
+  const auto n = std::min(data.dist_len1, data.rssi_len1);
+  return project(data.dist1, data.rssi1, static_cast<std::size_t>(n), out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+projector::project(const compact_scan& data, point* out)
+const noexcept
+{
+  const auto dist = data.get(channel::dist1);
+  return project(dist.data, dist.size, out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+projector::project(const compact_scan& data, point_intensity* out)
+const noexcept
+{
+  const auto dist = data.get(channel::dist1);
+  const auto rssi = data.get(channel::rssi1);
+  return project(dist.data, rssi.data, std::min(dist.size, rssi.size), out);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
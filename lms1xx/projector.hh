@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A point of a scan in the plane of the device
+struct point
+{
+  float x;
+  float y;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A point of a scan in the plane of the device, with its remission
+struct point_intensity
+{
+  float x;
+  float y;
+  float intensity;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Convert distances to cartesian coordinates
+///
+/// The x axis points in front of the device (90 degrees in the frame of the device), the y axis
+/// points to its left. Sines and cosines of all angles of a scan output range are computed once,
+/// then each conversion is a multiplication per coordinate. Distances of 0 (no echo) give points
+/// at the origin.
+class projector final
+{
+public:
+
+  /// @brief Constructor
+  /// @param range The angles of scans
+  /// @param scale Factor applied to distances, by default from millimeters to meters
+  /// @throw std::invalid_argument if the range is empty
+  explicit
+  projector(const scan_output_range& range, float scale = 0.001f);
+
+  /// @brief Change the angles of scans
+  ///
+  /// Tables are only computed again if the range is different.
+  void
+  set_range(const scan_output_range& range);
+
+  /// @brief The angles of scans
+  const scan_output_range&
+  range()
+  const noexcept;
+
+  /// @brief Number of points of scans
+  std::size_t
+  size()
+  const noexcept;
+
+  /// @brief Convert distances
+  /// @param dist The distances, one per angle of the range
+  /// @param n The number of distances
+  /// @param out Where to store points, must have room for min(n, size()) points
+  /// @return The number of points stored, min(n, size())
+  std::size_t
+  project(const std::uint16_t* dist, std::size_t n, point* out)
+  const noexcept;
+
+  /// @brief Convert distances and keep their remission
+  /// @param dist The distances, one per angle of the range
+  /// @param intensity The remissions, one per distance
+  /// @param n The number of distances
+  /// @param out Where to store points, must have room for min(n, size()) points
+  /// @return The number of points stored, min(n, size())
+  std::size_t
+  project( const std::uint16_t* dist, const std::uint16_t* intensity, std::size_t n
+         , point_intensity* out)
+  const noexcept;
+
+  /// @brief Convert the first echo of a scan
+  /// @return The number of points stored
+  std::size_t
+  project(const scan_data& data, point* out)
+  const noexcept;
+
+  /// @brief Convert the first echo of a scan, with its remission
+  /// @return The number of points stored, 0 if the scan has no remission
+  std::size_t
+  project(const scan_data& data, point_intensity* out)
+  const noexcept;
+
+  /// @brief Convert the first echo of a scan
+  /// @return The number of points stored
+  std::size_t
+  project(const compact_scan& data, point* out)
+  const noexcept;
+
+  /// @brief Convert the first echo of a scan, with its remission
+  /// @return The number of points stored, 0 if the scan has no remission
+  std::size_t
+  project(const compact_scan& data, point_intensity* out)
+  const noexcept;
+
+private:
+
+  /// @brief The angles of scans
+  scan_output_range m_range;
+
+  /// @brief Factor applied to distances
+  float m_scale;
+
+  /// @brief Scaled cosine of each angle
+  std::vector<float> m_cos;
+
+  /// @brief Scaled sine of each angle
+  std::vector<float> m_sin;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
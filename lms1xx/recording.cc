@@ -0,0 +1,581 @@
+#include <algorithm> // lower_bound
+#include <chrono>
+#include <cstring>   // memcpy
+#include <ctime>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lms1xx/codec.hh"
+#include "lms1xx/recording.hh"
+
+namespace lms1xx {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+constexpr auto file_magic = std::uint32_t{0x52534d4c}; // "LMSR"
+constexpr auto chunk_magic = std::uint32_t{0x43534d4c}; // "LMSC"
+constexpr auto index_magic = std::uint32_t{0x49534d4c}; // "LMSI"
+constexpr auto format_version = std::uint32_t{1};
+
+/// @brief Flag of chunks whose samples are compressed with codec::encode()
+constexpr auto compressed_flag = std::uint8_t{1};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Begins a recording
+struct file_header
+{
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint64_t reserved;
+};
+
+static_assert(sizeof(file_header) == 16, "Unexpected padding");
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Precedes the samples of a scan
+struct chunk_header
+{
+  std::uint32_t magic;
+  /// @brief Bytes of samples following this header, padded to a multiple of 8
+  std::uint32_t size;
+  std::uint64_t counter;
+  std::int64_t time;
+  std::uint32_t serial_number;
+  std::uint32_t power_up_duration;
+  std::uint32_t transmission_duration;
+  std::uint32_t scanning_frequency;
+  std::uint32_t measurement_frequency;
+  std::uint16_t version;
+  std::uint16_t device_number;
+  std::uint16_t status;
+  std::uint16_t message_counter;
+  std::uint16_t scan_counter;
+  std::uint16_t sizes[compact_scan::nb_channels];
+  std::uint8_t has_timestamp;
+  std::uint8_t flags;
+};
+
+static_assert(sizeof(chunk_header) == 64, "Unexpected padding");
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Ends a closed recording, after the index
+struct file_footer
+{
+  std::uint64_t index_offset;
+  std::uint64_t nb_scans;
+  std::uint32_t magic;
+  std::uint32_t reserved;
+};
+
+static_assert(sizeof(file_footer) == 24, "Unexpected padding");
+static_assert(sizeof(recorder::index_entry) == 24, "Unexpected padding");
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Round up to a multiple of 8, to keep chunks aligned
+constexpr std::size_t
+padded(std::size_t size)
+noexcept
+{
+  return (size + 7) & ~std::size_t{7};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Microseconds since epoch of the device timestamp, or of now if there is none
+std::int64_t
+time_us(const scan_header& header)
+noexcept
+{
+  if (not header.has_timestamp)
+  {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch()).count();
+  }
+  return microseconds_since_epoch(header.timestamp);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const chunk_header&
+as_chunk(const char* chunk)
+noexcept
+{
+  return *reinterpret_cast<const chunk_header*>(chunk);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Copy or decompress the samples of a chunk
+/// @param prepare Called with each channel and its number of samples, returns where to store them
+/// or nullptr if there are too many
+template <typename Prepare>
+void
+copy_samples(const char* chunk, Prepare&& prepare)
+{
+  static constexpr channel channels[] = { channel::dist1, channel::dist2
+                                        , channel::rssi1, channel::rssi2};
+  const auto& header = as_chunk(chunk);
+  auto pos = chunk + sizeof(chunk_header);
+  const auto last = pos + header.size;
+
+  // Compressed samples are preceded by the number of bytes of each channel.
+  std::uint16_t encoded_sizes[compact_scan::nb_channels] = {};
+  if (header.flags & compressed_flag)
+  {
+    std::memcpy(encoded_sizes, pos, sizeof(encoded_sizes));
+    pos += sizeof(encoded_sizes);
+  }
+
+  for (auto i = std::size_t{0}; i < compact_scan::nb_channels; ++i)
+  {
+    const auto size = std::size_t{header.sizes[i]};
+    const auto out = prepare(channels[i], size);
+    if (out == nullptr)
+    {
+      throw std::invalid_argument{"Too many samples in recorded scan"};
+    }
+    if (header.flags & compressed_flag)
+    {
+      pos = codec::decode(pos, std::min(last, pos + encoded_sizes[i]), size, out);
+    }
+    else
+    {
+      std::memcpy(out, pos, size * sizeof(std::uint16_t));
+      pos += size * sizeof(std::uint16_t);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+recorder::recorder(const std::string& path, bool compress)
+  : m_file{path, std::ios::binary | std::ios::trunc}
+  , m_compress{compress}
+  , m_encoded{}
+  , m_offset{sizeof(file_header)}
+  , m_index{}
+  , m_last_counter{0}
+{
+  if (not m_file)
+  {
+    throw std::runtime_error{"Can't create " + path};
+  }
+  const auto header = file_header{file_magic, format_version, 0};
+  if (not m_file.write(reinterpret_cast<const char*>(&header), sizeof(header)))
+  {
+    throw std::runtime_error{"Can't write to " + path};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+recorder::~recorder()
+{
+  try
+  {
+    close();
+  }
+  catch (...)
+  {}
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+recorder::record(const scan_data& data)
+{
+  const channel_span channels[] = { {data.dist1, static_cast<std::size_t>(data.dist_len1)}
+                                  , {data.dist2, static_cast<std::size_t>(data.dist_len2)}
+                                  , {data.rssi1, static_cast<std::size_t>(data.rssi_len1)}
+                                  , {data.rssi2, static_cast<std::size_t>(data.rssi_len2)}};
+  record(data.header, channels);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+recorder::record(const compact_scan& scan)
+{
+  const channel_span channels[] = { scan.get(channel::dist1), scan.get(channel::dist2)
+                                  , scan.get(channel::rssi1), scan.get(channel::rssi2)};
+  record(scan.header(), channels);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+recorder::record( const scan_header& header
+                , const channel_span (&channels)[compact_scan::nb_channels])
+{
+  if (not m_file.is_open())
+  {
+    throw std::runtime_error{"Recording is closed"};
+  }
+
+  auto counter = std::uint64_t{header.message_counter};
+  if (not m_index.empty())
+  {
+    const auto delta = static_cast<std::uint16_t>(header.message_counter - m_last_counter);
+    // A counter going backwards means the device restarted, keep counters increasing.
+    counter = m_index.back().counter + (delta < 0x8000 ? delta : 1);
+  }
+  m_last_counter = header.message_counter;
+
+  auto chunk = chunk_header{};
+  chunk.magic = chunk_magic;
+  chunk.counter = counter;
+  chunk.time = time_us(header);
+  chunk.serial_number = header.serial_number;
+  chunk.power_up_duration = header.power_up_duration;
+  chunk.transmission_duration = header.transmission_duration;
+  chunk.scanning_frequency = header.scanning_frequency;
+  chunk.measurement_frequency = header.measurement_frequency;
+  chunk.version = header.version;
+  chunk.device_number = header.device_number;
+  chunk.status = header.status;
+  chunk.message_counter = header.message_counter;
+  chunk.scan_counter = header.scan_counter;
+  chunk.has_timestamp = header.has_timestamp;
+
+  auto nb_samples = std::size_t{0};
+  for (auto i = std::size_t{0}; i < compact_scan::nb_channels; ++i)
+  {
+    chunk.sizes[i] = static_cast<std::uint16_t>(channels[i].size);
+    nb_samples += channels[i].size;
+  }
+
+  auto samples_size = nb_samples * sizeof(std::uint16_t);
+  if (m_compress)
+  {
+    chunk.flags = compressed_flag;
+    std::uint16_t encoded_sizes[compact_scan::nb_channels];
+    m_encoded.resize(sizeof(encoded_sizes) + codec::max_encoded_size(nb_samples));
+    auto pos = &m_encoded[sizeof(encoded_sizes)];
+    for (auto i = std::size_t{0}; i < compact_scan::nb_channels; ++i)
+    {
+      const auto size = codec::encode(channels[i].data, channels[i].size, pos);
+      encoded_sizes[i] = static_cast<std::uint16_t>(size);
+      pos += size;
+    }
+    std::memcpy(&m_encoded[0], encoded_sizes, sizeof(encoded_sizes));
+    samples_size = static_cast<std::size_t>(pos - &m_encoded[0]);
+  }
+  chunk.size = static_cast<std::uint32_t>(padded(samples_size));
+
+  m_file.write(reinterpret_cast<const char*>(&chunk), sizeof(chunk));
+  if (m_compress)
+  {
+    m_file.write(m_encoded.data(), static_cast<std::streamsize>(samples_size));
+  }
+  else
+  {
+    for (const auto& c : channels)
+    {
+      m_file.write(reinterpret_cast<const char*>(c.data), c.size * sizeof(std::uint16_t));
+    }
+  }
+  static const char padding[8] = {};
+  m_file.write(padding, chunk.size - samples_size);
+  if (not m_file)
+  {
+    throw std::runtime_error{"Can't write scan"};
+  }
+
+  m_index.push_back({chunk.counter, chunk.time, m_offset});
+  m_offset += sizeof(chunk) + chunk.size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+recorder::close()
+{
+  if (not m_file.is_open())
+  {
+    return;
+  }
+
+  const auto footer = file_footer{m_offset, m_index.size(), index_magic, 0};
+  m_file.write( reinterpret_cast<const char*>(m_index.data())
+              , static_cast<std::streamsize>(m_index.size() * sizeof(index_entry)));
+  m_file.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+  m_file.close();
+  if (not m_file)
+  {
+    throw std::runtime_error{"Can't write index"};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+recorder::size()
+const noexcept
+{
+  return m_index.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+recorded_scan::recorded_scan(const char* chunk)
+noexcept
+  : m_chunk{chunk}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+recorded_scan::counter()
+const noexcept
+{
+  return as_chunk(m_chunk).counter;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::int64_t
+recorded_scan::time()
+const noexcept
+{
+  return as_chunk(m_chunk).time;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_header
+recorded_scan::header()
+const noexcept
+{
+  const auto& chunk = as_chunk(m_chunk);
+  auto header = scan_header{};
+  header.version = chunk.version;
+  header.device_number = chunk.device_number;
+  header.serial_number = chunk.serial_number;
+  header.status = chunk.status;
+  header.message_counter = chunk.message_counter;
+  header.scan_counter = chunk.scan_counter;
+  header.power_up_duration = chunk.power_up_duration;
+  header.transmission_duration = chunk.transmission_duration;
+  header.scanning_frequency = chunk.scanning_frequency;
+  header.measurement_frequency = chunk.measurement_frequency;
+  header.has_timestamp = chunk.has_timestamp != 0;
+  if (header.has_timestamp)
+  {
+    const auto seconds = static_cast<std::time_t>(chunk.time / 1000000);
+    auto tm = std::tm{};
+    gmtime_r(&seconds, &tm);
+    header.timestamp.year = static_cast<std::uint16_t>(tm.tm_year + 1900);
+    header.timestamp.month = static_cast<std::uint8_t>(tm.tm_mon + 1);
+    header.timestamp.day = static_cast<std::uint8_t>(tm.tm_mday);
+    header.timestamp.hour = static_cast<std::uint8_t>(tm.tm_hour);
+    header.timestamp.minute = static_cast<std::uint8_t>(tm.tm_min);
+    header.timestamp.second = static_cast<std::uint8_t>(tm.tm_sec);
+    header.timestamp.microsecond = static_cast<std::uint32_t>(chunk.time % 1000000);
+  }
+  return header;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+channel_span
+recorded_scan::get(channel c)
+const noexcept
+{
+  const auto& chunk = as_chunk(m_chunk);
+  const auto samples = reinterpret_cast<const std::uint16_t*>(m_chunk + sizeof(chunk_header));
+  const auto i = static_cast<std::size_t>(c);
+  auto offset = std::size_t{0};
+  for (auto j = std::size_t{0}; j < i; ++j)
+  {
+    offset += chunk.sizes[j];
+  }
+  return {samples + offset, chunk.sizes[i]};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+recorded_scan::compressed()
+const noexcept
+{
+  return as_chunk(m_chunk).flags & compressed_flag;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+recorded_scan::copy(scan_data& data)
+const
+{
+  data.header = header();
+  copy_samples(m_chunk, [&](channel c, std::size_t size) -> std::uint16_t*
+  {
+    if (size > max_samples)
+    {
+      return nullptr;
+    }
+    switch (c)
+    {
+      case channel::dist1: data.dist_len1 = static_cast<int>(size); return data.dist1;
+      case channel::dist2: data.dist_len2 = static_cast<int>(size); return data.dist2;
+      case channel::rssi1: data.rssi_len1 = static_cast<int>(size); return data.rssi1;
+      case channel::rssi2: data.rssi_len2 = static_cast<int>(size); return data.rssi2;
+    }
+    return nullptr;
+  });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+recorded_scan::copy(compact_scan& data)
+const
+{
+  data.clear();
+  data.header() = header();
+  copy_samples(m_chunk, [&](channel c, std::size_t size){ return data.prepare(c, size); });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+recording::recording(const std::string& path)
+  : m_data{nullptr}
+  , m_size{0}
+  , m_index{nullptr}
+  , m_nb_scans{0}
+  , m_rebuilt_index{}
+{
+  const auto fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    throw std::runtime_error{"Can't open " + path};
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 or static_cast<std::size_t>(st.st_size) < sizeof(file_header))
+  {
+    ::close(fd);
+    throw std::runtime_error{path + " is not a recording"};
+  }
+  m_size = static_cast<std::size_t>(st.st_size);
+  const auto addr = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+  {
+    throw std::runtime_error{"Can't map " + path};
+  }
+  m_data = static_cast<const char*>(addr);
+
+  const auto& header = *reinterpret_cast<const file_header*>(m_data);
+  if (header.magic != file_magic or header.version != format_version)
+  {
+    ::munmap(const_cast<char*>(m_data), m_size);
+    throw std::runtime_error{path + " is not a recording"};
+  }
+
+  if (m_size >= sizeof(file_header) + sizeof(file_footer))
+  {
+    const auto& footer =
+      *reinterpret_cast<const file_footer*>(m_data + m_size - sizeof(file_footer));
+    if (  footer.magic == index_magic
+      and footer.index_offset + footer.nb_scans * sizeof(recorder::index_entry)
+          == m_size - sizeof(file_footer))
+    {
+      m_index = reinterpret_cast<const recorder::index_entry*>(m_data + footer.index_offset);
+      m_nb_scans = footer.nb_scans;
+      return;
+    }
+  }
+  rebuild_index();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+recording::~recording()
+{
+  ::munmap(const_cast<char*>(m_data), m_size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+recording::rebuild_index()
+{
+  auto offset = sizeof(file_header);
+  while (offset + sizeof(chunk_header) <= m_size)
+  {
+    const auto& chunk = as_chunk(m_data + offset);
+    // Stop at the first chunk which was not entirely written.
+    if (chunk.magic != chunk_magic or offset + sizeof(chunk_header) + chunk.size > m_size)
+    {
+      break;
+    }
+    m_rebuilt_index.push_back({chunk.counter, chunk.time, offset});
+    offset += sizeof(chunk_header) + chunk.size;
+  }
+  m_index = m_rebuilt_index.data();
+  m_nb_scans = m_rebuilt_index.size();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+recording::size()
+const noexcept
+{
+  return m_nb_scans;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+recorded_scan
+recording::operator[](std::size_t i)
+const noexcept
+{
+  return recorded_scan{m_data + m_index[i].offset};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+recording::find_counter(std::uint64_t counter)
+const noexcept
+{
+  const auto it = std::lower_bound( m_index, m_index + m_nb_scans, counter
+                                  , [](const recorder::index_entry& e, std::uint64_t c)
+                                    {
+                                      return e.counter < c;
+                                    });
+  return static_cast<std::size_t>(it - m_index);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+recording::find_time(std::int64_t time)
+const noexcept
+{
+  const auto it = std::lower_bound( m_index, m_index + m_nb_scans, time
+                                  , [](const recorder::index_entry& e, std::int64_t t)
+                                    {
+                                      return e.time < t;
+                                    });
+  return static_cast<std::size_t>(it - m_index);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
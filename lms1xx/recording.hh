@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Writes decoded scans to an append-only binary file
+///
+/// The file starts with a small header, followed by one chunk per scan: a fixed-size chunk header
+/// holding the header of the scan, then the samples of each present channel. When the recorder is
+/// closed, an index of all chunks is appended, which makes lookups by counter or by time a binary
+/// search. A file which wasn't closed can still be read, its index is then rebuilt by walking the
+/// chunks. Values are stored in the byte order of the host.
+///
+/// Samples can be compressed with codec::encode(), at the cost of copying scans to read them.
+class recorder final
+{
+public:
+
+  /// @brief Can't copy-construct a recorder
+  recorder(const recorder&) = delete;
+
+  /// @brief Can't copy a recorder
+  recorder& operator=(const recorder&) = delete;
+
+  /// @brief Create a new recording, replacing any existing file
+  /// @param path The file to create
+  /// @param compress Compress samples
+  /// @throw std::runtime_error if the file can't be created
+  explicit
+  recorder(const std::string& path, bool compress = false);
+
+  /// @brief Close the recording, if not already done
+  ~recorder();
+
+  /// @brief Append a scan
+  /// @throw std::runtime_error if it can't be written
+  ///
+  /// The time of the scan is its timestamp when present, the current time otherwise.
+  void
+  record(const scan_data& data);
+
+  /// @brief Append a scan
+  /// @throw std::runtime_error if it can't be written
+  void
+  record(const compact_scan& scan);
+
+  /// @brief Write the index and close the file
+  /// @throw std::runtime_error if it can't be written
+  void
+  close();
+
+  /// @brief Number of recorded scans
+  std::size_t
+  size()
+  const noexcept;
+
+public:
+
+  /// @brief Locates a chunk in a recording
+  struct index_entry
+  {
+    /// @brief Unwrapped message counter
+    std::uint64_t counter;
+
+    /// @brief Time of the scan, in microseconds since epoch
+    std::int64_t time;
+
+    /// @brief Offset of the chunk in the file
+    std::uint64_t offset;
+  };
+
+private:
+
+  /// @brief Append a scan given its header and channels
+  void
+  record(const scan_header& header, const channel_span (&channels)[compact_scan::nb_channels]);
+
+private:
+
+  /// @brief The recording
+  std::ofstream m_file;
+
+  /// @brief Compress samples
+  bool m_compress;
+
+  /// @brief Compressed samples of a scan, reused for each scan
+  std::string m_encoded;
+
+  /// @brief Offset of the next chunk
+  std::uint64_t m_offset;
+
+  /// @brief One entry per chunk
+  std::vector<index_entry> m_index;
+
+  /// @brief The message counter of the previous scan
+  std::uint16_t m_last_counter;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A scan of a recording, pointing directly into the mapped file
+///
+/// Only valid as long as the recording it comes from.
+class recorded_scan final
+{
+public:
+
+  /// @brief The message counter, unwrapped to never decrease along a recording
+  std::uint64_t
+  counter()
+  const noexcept;
+
+  /// @brief Time of the scan, in microseconds since epoch
+  std::int64_t
+  time()
+  const noexcept;
+
+  /// @brief Header of the scan
+  scan_header
+  header()
+  const noexcept;
+
+  /// @brief Tell if samples are compressed
+  bool
+  compressed()
+  const noexcept;
+
+  /// @brief Get the samples of a channel, without copy
+  /// @pre The scan isn't compressed
+  channel_span
+  get(channel c)
+  const noexcept;
+
+  /// @brief Copy the scan into a scan_data, decompressing samples if needed
+  /// @throw std::invalid_argument if a channel has more than max_samples samples, or if
+  /// compressed samples are malformed
+  void
+  copy(scan_data& data)
+  const;
+
+  /// @brief Copy the scan into a compact scan, decompressing samples if needed
+  /// @throw std::invalid_argument if a channel has more samples than the capacity of data, or if
+  /// compressed samples are malformed
+  void
+  copy(compact_scan& data)
+  const;
+
+private:
+
+  friend class recording;
+
+  /// @brief Constructor
+  explicit
+  recorded_scan(const char* chunk)
+  noexcept;
+
+private:
+
+  /// @brief The chunk of the scan in the mapped file
+  const char* m_chunk;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Random access to the scans of a file written by a recorder
+///
+/// The file is mapped in memory, thus opening a recording doesn't read it and scans are only
+/// loaded from disk when they are accessed.
+class recording final
+{
+public:
+
+  /// @brief Can't copy-construct a recording
+  recording(const recording&) = delete;
+
+  /// @brief Can't copy a recording
+  recording& operator=(const recording&) = delete;
+
+  /// @brief Open a recording
+  /// @throw std::runtime_error if the file can't be opened or isn't a recording
+  explicit
+  recording(const std::string& path);
+
+  /// @brief Unmap the file
+  ~recording();
+
+  /// @brief Number of scans
+  std::size_t
+  size()
+  const noexcept;
+
+  /// @brief Get a scan
+  recorded_scan
+  operator[](std::size_t i)
+  const noexcept;
+
+  /// @brief Position of the first scan whose unwrapped counter is not less than counter
+  /// @return size() if there is no such scan
+  std::size_t
+  find_counter(std::uint64_t counter)
+  const noexcept;
+
+  /// @brief Position of the first scan whose time is not before time
+  /// @param time Microseconds since epoch
+  /// @return size() if there is no such scan
+  /// @note Expects times to never decrease along the recording
+  std::size_t
+  find_time(std::int64_t time)
+  const noexcept;
+
+private:
+
+  /// @brief Rebuild the index of a recording which wasn't closed
+  void
+  rebuild_index();
+
+private:
+
+  /// @brief The mapped file
+  const char* m_data;
+
+  /// @brief Size of the file
+  std::size_t m_size;
+
+  /// @brief The index, in the mapped file or in m_rebuilt_index
+  const recorder::index_entry* m_index;
+
+  /// @brief Number of entries in the index
+  std::size_t m_nb_scans;
+
+  /// @brief The index of a recording which wasn't closed
+  std::vector<recorder::index_entry> m_rebuilt_index;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <exception>
+
+#include <boost/asio/io_service.hpp>
+
+/// @file
+/// Run an io_service shared by several devices, for the threads of device_group and pipeline.
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Run an io_service until it's stopped, from a thread of a pool
+/// @param on_exception Called with each exception which escapes a handler, must not throw
+///
+/// Devices report their errors to their own error handlers, thus an exception which still
+/// escapes was thrown by one of these handlers. It must neither end the thread nor stop the other
+/// devices of the io_service: it's given to on_exception, then the io_service is run again.
+template <typename Handler>
+void
+run_io(boost::asio::io_service& io, Handler&& on_exception)
+{
+  while (true)
+  {
+    try
+    {
+      io.run();
+      return;
+    }
+    catch (...)
+    {
+      on_exception(std::current_exception());
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
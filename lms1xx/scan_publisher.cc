@@ -0,0 +1,427 @@
+#include <algorithm> // max
+#include <atomic>
+#include <new>       // placement new
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "lms1xx/scan_publisher.hh"
+
+// Atomics of the ring are shared by processes, they can't rely on a lock of the process.
+#if ATOMIC_LLONG_LOCK_FREE != 2
+# error "Shared scan rings need lock-free 64-bit atomics"
+#endif
+
+namespace lms1xx {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+constexpr auto ring_magic = std::uint32_t{0x48534d4c}; // "LMSH"
+constexpr auto ring_version = std::uint32_t{1};
+
+/// @brief Size of a cache line, to keep the counter written for each scan apart
+constexpr auto cache_line = std::size_t{64};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Stamp of a slot while the scan of a sequence number is written
+///
+/// Stamps only grow: 0 for a slot never written, then odd while a scan is written, even once it
+/// is committed.
+constexpr
+std::uint64_t
+writing_stamp(std::uint64_t sequence)
+noexcept
+{
+  return 2 * sequence + 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Stamp of a slot once the scan of a sequence number is committed
+constexpr
+std::uint64_t
+committed_stamp(std::uint64_t sequence)
+noexcept
+{
+  return 2 * sequence + 2;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check that a name is a portable name of shared memory object
+bool
+valid_name(const std::string& name)
+noexcept
+{
+  return name.size() > 1 and name.size() < 256 and name[0] == '/'
+     and name.find('/', 1) == std::string::npos;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Begins the shared memory object, followed by the slots
+struct scan_publisher::ring_header
+{
+  /// @brief Written last by the publisher, once the ring is initialized
+  std::atomic<std::uint32_t> magic;
+
+  /// @brief Version of this layout
+  std::uint32_t version;
+
+  /// @brief Size of a slot, which depends on the layout of scan_data
+  std::uint32_t slot_size;
+
+  /// @brief Number of slots
+  std::uint64_t capacity;
+
+  /// @brief Number of committed scans
+  alignas(cache_line) std::atomic<std::uint64_t> written;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A scan of the ring, and the stamp which tells which one it is
+struct alignas(cache_line) scan_publisher::slot
+{
+  std::atomic<std::uint64_t> stamp;
+  scan_data data;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_publisher::scan_publisher(const std::string& name, std::size_t capacity)
+  : m_name{name}
+  , m_capacity{capacity}
+  , m_size{sizeof(ring_header) + capacity * sizeof(slot)}
+  , m_data{nullptr}
+  , m_sequence{0}
+  , m_writing{false}
+{
+  if (not valid_name(name))
+  {
+    throw std::invalid_argument{"Invalid shared memory name " + name};
+  }
+  if (capacity == 0)
+  {
+    throw std::invalid_argument{"scan_publisher capacity must be positive"};
+  }
+
+  // Don't share anything with subscribers of a previous publisher.
+  ::shm_unlink(name.c_str());
+  const auto fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    throw std::runtime_error{"Can't create shared memory " + name};
+  }
+  if (::ftruncate(fd, static_cast<off_t>(m_size)) != 0)
+  {
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    throw std::runtime_error{"Can't allocate shared memory " + name};
+  }
+  const auto addr = ::mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+  {
+    ::shm_unlink(name.c_str());
+    throw std::runtime_error{"Can't map shared memory " + name};
+  }
+  m_data = static_cast<char*>(addr);
+
+  auto& header = *new (m_data) ring_header;
+  header.version = ring_version;
+  header.slot_size = static_cast<std::uint32_t>(sizeof(slot));
+  header.capacity = capacity;
+  header.written.store(0, std::memory_order_relaxed);
+  for (auto i = std::size_t{0}; i < capacity; ++i)
+  {
+    auto& s = *new (m_data + sizeof(ring_header) + i * sizeof(slot)) slot;
+    s.stamp.store(0, std::memory_order_relaxed);
+  }
+  header.magic.store(ring_magic, std::memory_order_release);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_publisher::~scan_publisher()
+{
+  ::munmap(m_data, m_size);
+  ::shm_unlink(m_name.c_str());
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_data&
+scan_publisher::acquire_write()
+noexcept
+{
+  auto& s = slot_of(m_sequence);
+  if (not m_writing)
+  {
+    // Subscribers reading the previous scan of this slot will see it was overwritten.
+    s.stamp.store(writing_stamp(m_sequence), std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_writing = true;
+  }
+  return s.data;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_publisher::commit_write()
+noexcept
+{
+  acquire_write();
+  slot_of(m_sequence).stamp.store(committed_stamp(m_sequence), std::memory_order_release);
+  ++m_sequence;
+  m_writing = false;
+  reinterpret_cast<ring_header*>(m_data)->written.store(m_sequence, std::memory_order_release);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_publisher::publish(const scan_data& data)
+noexcept
+{
+  acquire_write() = data;
+  commit_write();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const std::string&
+scan_publisher::name()
+const noexcept
+{
+  return m_name;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+scan_publisher::capacity()
+const noexcept
+{
+  return m_capacity;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+scan_publisher::written()
+const noexcept
+{
+  return m_sequence;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_publisher::slot&
+scan_publisher::slot_of(std::uint64_t sequence)
+const noexcept
+{
+  return *reinterpret_cast<slot*>
+    (m_data + sizeof(ring_header) + (sequence % m_capacity) * sizeof(slot));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_handler
+publish_to(scan_publisher& publisher)
+{
+  return [&publisher](const scan_data& data){ publisher.publish(data); };
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_subscriber::scan_subscriber(const std::string& name)
+  : m_capacity{0}
+  , m_size{0}
+  , m_data{nullptr}
+  , m_next{0}
+  , m_stamp{0}
+  , m_overruns{0}
+{
+  const auto fd = ::shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+  if (fd < 0)
+  {
+    throw std::runtime_error{"Can't open shared memory " + name};
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 or static_cast<std::size_t>(st.st_size) < sizeof(ring_header))
+  {
+    ::close(fd);
+    throw std::runtime_error{name + " is not a scan ring"};
+  }
+  m_size = static_cast<std::size_t>(st.st_size);
+  const auto addr = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (addr == MAP_FAILED)
+  {
+    throw std::runtime_error{"Can't map shared memory " + name};
+  }
+  m_data = static_cast<const char*>(addr);
+
+  const auto& h = header();
+  if (  h.magic.load(std::memory_order_acquire) != ring_magic
+     or h.version != ring_version
+     or h.slot_size != sizeof(slot)
+     or sizeof(ring_header) + h.capacity * sizeof(slot) != m_size)
+  {
+    ::munmap(const_cast<char*>(m_data), m_size);
+    throw std::runtime_error{name + " is not a scan ring of this version"};
+  }
+  m_capacity = static_cast<std::size_t>(h.capacity);
+  m_next = h.written.load(std::memory_order_acquire);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_subscriber::~scan_subscriber()
+{
+  ::munmap(const_cast<char*>(m_data), m_size);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_data*
+scan_subscriber::try_acquire_read()
+noexcept
+{
+  while (true)
+  {
+    const auto written = header().written.load(std::memory_order_acquire);
+    if (m_next == written)
+    {
+      return nullptr;
+    }
+    // A lapped subscriber resumes half a ring behind the publisher: the oldest scan left is the
+    // next one to be overwritten, reading from there would make it lapped again at once.
+    const auto resync = written - std::max<std::uint64_t>(m_capacity / 2, 1);
+    if (written - m_next > m_capacity)
+    {
+      // Slots of these scans were written again.
+      m_overruns += resync - m_next;
+      m_next = resync;
+    }
+
+    const auto& s = slot_of(m_next);
+    const auto stamp = s.stamp.load(std::memory_order_acquire);
+    if (stamp == committed_stamp(m_next))
+    {
+      m_stamp = stamp;
+      return &s.data;
+    }
+    // The publisher is writing a newer scan in this slot.
+    const auto next = std::max(resync, m_next + 1);
+    m_overruns += next - m_next;
+    m_next = next;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+scan_subscriber::release_read()
+noexcept
+{
+  // Order the reads of the scan before the one of its stamp.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const auto stamp = slot_of(m_next).stamp.load(std::memory_order_relaxed);
+  ++m_next;
+  if (stamp != m_stamp)
+  {
+    ++m_overruns;
+    return false;
+  }
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+scan_subscriber::sequence()
+const noexcept
+{
+  return m_stamp / 2 - 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+scan_subscriber::available()
+const noexcept
+{
+  return header().written.load(std::memory_order_acquire) - m_next;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_subscriber::skip_to_latest()
+noexcept
+{
+  m_next = header().written.load(std::memory_order_acquire);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+scan_subscriber::capacity()
+const noexcept
+{
+  return m_capacity;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+scan_subscriber::written()
+const noexcept
+{
+  return header().written.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+scan_subscriber::overruns()
+const noexcept
+{
+  return m_overruns;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_subscriber::slot&
+scan_subscriber::slot_of(std::uint64_t sequence)
+const noexcept
+{
+  return *reinterpret_cast<const slot*>
+    (m_data + sizeof(ring_header) + (sequence % m_capacity) * sizeof(slot));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_subscriber::ring_header&
+scan_subscriber::header()
+const noexcept
+{
+  return *reinterpret_cast<const ring_header*>(m_data);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
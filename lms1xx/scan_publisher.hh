@@ -0,0 +1,246 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Publishes scans in a lock-free ring in POSIX shared memory, for scan_subscribers of other
+/// processes of the same host
+///
+/// The ring is a shared memory object (found in /dev/shm) holding a fixed number of scans. The
+/// producer fills a slot in place, then commits it; it never waits for subscribers, which may
+/// come and go: when the ring is full, the oldest scan is overwritten. Each slot carries the
+/// sequence number of its scan, which lets subscribers detect the scans they missed, and the ones
+/// overwritten while they were reading them.
+///
+/// All methods must be called from the same thread.
+class scan_publisher final
+{
+public:
+
+  /// @brief Can't copy-construct a scan_publisher
+  scan_publisher(const scan_publisher&) = delete;
+
+  /// @brief Can't copy a scan_publisher
+  scan_publisher& operator=(const scan_publisher&) = delete;
+
+  /// @brief Constructor
+  /// @param name Name of the shared memory object, a '/' followed by at most 254 characters other
+  /// than '/'
+  /// @param capacity Number of scans kept in the ring
+  /// @throw std::invalid_argument if name is not a valid name or if capacity is 0
+  /// @throw std::runtime_error if the shared memory object can't be created
+  ///
+  /// An existing object with the same name, left by a publisher which didn't terminate, is
+  /// replaced. Its subscribers must be opened again.
+  scan_publisher(const std::string& name, std::size_t capacity);
+
+  /// @brief Destructor
+  ///
+  /// Remove the shared memory object. Subscribers keep their mapping, no scan is published
+  /// anymore.
+  ~scan_publisher();
+
+  /// @brief Get the slot to fill
+  ///
+  /// The same slot is returned until commit_write() is called. Subscribers don't read it
+  /// meanwhile.
+  scan_data&
+  acquire_write()
+  noexcept;
+
+  /// @brief Make the slot returned by acquire_write() available to subscribers
+  void
+  commit_write()
+  noexcept;
+
+  /// @brief Copy a scan into the next slot and commit it
+  void
+  publish(const scan_data& data)
+  noexcept;
+
+  /// @brief Name of the shared memory object
+  const std::string&
+  name()
+  const noexcept;
+
+  /// @brief Number of scans kept in the ring
+  std::size_t
+  capacity()
+  const noexcept;
+
+  /// @brief Number of scans committed since construction
+  std::uint64_t
+  written()
+  const noexcept;
+
+private:
+
+  struct ring_header;
+  struct slot;
+
+  /// @brief Get a slot of the ring
+  slot&
+  slot_of(std::uint64_t sequence)
+  const noexcept;
+
+private:
+
+  /// @brief Name of the shared memory object
+  const std::string m_name;
+
+  /// @brief Number of scans kept in the ring
+  const std::size_t m_capacity;
+
+  /// @brief Size of the mapping
+  std::size_t m_size;
+
+  /// @brief The mapped shared memory object
+  char* m_data;
+
+  /// @brief Sequence number of the scan being filled
+  std::uint64_t m_sequence;
+
+  /// @brief True if the slot of m_sequence is marked as being written
+  bool m_writing;
+
+  friend class scan_subscriber;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Get a scan handler which publishes the scans it's given
+/// @param publisher Must outlive the handler
+///
+/// Lets any scan_source feed a ring shared with other processes, with
+/// source.start_stream(publish_to(publisher)). Each scan is copied once, into its slot.
+scan_handler
+publish_to(scan_publisher& publisher);
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Reads the scans of a scan_publisher of another process, without copying them
+///
+/// A subscriber maps the ring read-only and keeps its own position: it never slows down the
+/// publisher nor other subscribers. A scan is read in place, between try_acquire_read() and
+/// release_read(). As the publisher doesn't wait for subscribers, a scan may be overwritten while
+/// it's being read, which release_read() tells: what was read from it must then be discarded.
+/// A subscriber lapped by the publisher skips scans, which are counted as overruns.
+///
+/// All methods must be called from the same thread. Several subscribers, in any number of
+/// processes, can read the same ring.
+class scan_subscriber final
+{
+public:
+
+  /// @brief Can't copy-construct a scan_subscriber
+  scan_subscriber(const scan_subscriber&) = delete;
+
+  /// @brief Can't copy a scan_subscriber
+  scan_subscriber& operator=(const scan_subscriber&) = delete;
+
+  /// @brief Constructor
+  /// @param name Name of the shared memory object given to the scan_publisher
+  /// @throw std::runtime_error if there is no such ring, or if it was created by a version of the
+  /// library with another layout
+  ///
+  /// Only scans committed after the construction are read.
+  explicit
+  scan_subscriber(const std::string& name);
+
+  /// @brief Destructor
+  ~scan_subscriber();
+
+  /// @brief Borrow the next scan
+  /// @return nullptr if no scan was committed since the last one read
+  /// @note The previously borrowed scan must have been released.
+  ///
+  /// If the next scan was overwritten, the subscriber skips to the scan committed half a ring
+  /// before the newest one: the oldest scans left would be overwritten before it catches up.
+  const scan_data*
+  try_acquire_read()
+  noexcept;
+
+  /// @brief Give back the scan borrowed with try_acquire_read()
+  /// @return false if the scan was overwritten while it was read, in which case it's counted as
+  /// an overrun
+  bool
+  release_read()
+  noexcept;
+
+  /// @brief Sequence number of the last borrowed scan, given by the publisher from 0
+  /// @note Meaningless until a scan is borrowed.
+  std::uint64_t
+  sequence()
+  const noexcept;
+
+  /// @brief Number of scans committed but not read yet, overwritten ones included
+  std::uint64_t
+  available()
+  const noexcept;
+
+  /// @brief Skip all committed scans not read yet
+  void
+  skip_to_latest()
+  noexcept;
+
+  /// @brief Number of scans kept in the ring
+  std::size_t
+  capacity()
+  const noexcept;
+
+  /// @brief Number of scans committed by the publisher since it was constructed
+  std::uint64_t
+  written()
+  const noexcept;
+
+  /// @brief Number of scans skipped after being lapped, or overwritten while being read
+  std::uint64_t
+  overruns()
+  const noexcept;
+
+private:
+
+  using slot = scan_publisher::slot;
+  using ring_header = scan_publisher::ring_header;
+
+  /// @brief Get a slot of the ring
+  const slot&
+  slot_of(std::uint64_t sequence)
+  const noexcept;
+
+  /// @brief The header of the ring
+  const ring_header&
+  header()
+  const noexcept;
+
+private:
+
+  /// @brief Number of scans kept in the ring
+  std::size_t m_capacity;
+
+  /// @brief Size of the mapping
+  std::size_t m_size;
+
+  /// @brief The mapped shared memory object
+  const char* m_data;
+
+  /// @brief Sequence number of the next scan to read
+  std::uint64_t m_next;
+
+  /// @brief Stamp of the borrowed slot when it was acquired
+  std::uint64_t m_stamp;
+
+  /// @brief Number of scans skipped after being lapped, or overwritten while being read
+  std::uint64_t m_overruns;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,204 @@
+#include <stdexcept>
+#include <thread>
+
+#include "lms1xx/scan_ring.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_ring::scan_ring(std::size_t capacity, overflow_policy policy)
+  : m_capacity{capacity}
+  , m_policy{policy}
+  , m_slots{}
+  , m_queue{}
+  , m_head{0}
+  , m_tail{0}
+  , m_free{}
+  , m_free_head{0}
+  , m_free_tail{0}
+  , m_writing{0}
+  , m_reading{0}
+  , m_written{0}
+  , m_overruns{0}
+  , m_blocked{0}
+{
+  if (capacity == 0)
+  {
+    throw std::invalid_argument{"scan_ring capacity must be positive"};
+  }
+
+  m_slots.reset(new scan_data[nb_slots()]());
+  m_queue.reset(new std::atomic<std::uint32_t>[m_capacity]);
+  m_free.reset(new std::atomic<std::uint32_t>[nb_slots()]);
+
+  // The producer starts with the first slot, all others are free.
+  for (auto i = std::size_t{1}; i < nb_slots(); ++i)
+  {
+    m_free[i - 1].store(static_cast<std::uint32_t>(i), std::memory_order_relaxed);
+  }
+  m_free_head.store(nb_slots() - 1, std::memory_order_release);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_data&
+scan_ring::acquire_write()
+noexcept
+{
+  return m_slots[m_writing];
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_ring::commit_write()
+noexcept
+{
+  const auto head = m_head.load(std::memory_order_relaxed);
+  auto next = m_writing;
+  auto dropped = false;
+
+  auto tail = m_tail.load(std::memory_order_acquire);
+  if (head - tail == m_capacity)
+  {
+    if (m_policy == overflow_policy::overwrite_oldest)
+    {
+      // Take the oldest slot back, unless the consumer borrows it in the meantime.
+      const auto oldest = m_queue[tail % m_capacity].load(std::memory_order_relaxed);
+      if (m_tail.compare_exchange_strong(tail, tail + 1, std::memory_order_acq_rel))
+      {
+        next = oldest;
+        dropped = true;
+        m_overruns.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+    else
+    {
+      m_blocked.fetch_add(1, std::memory_order_relaxed);
+      while (head - m_tail.load(std::memory_order_acquire) == m_capacity)
+      {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  m_queue[head % m_capacity].store(m_writing, std::memory_order_relaxed);
+  m_head.store(head + 1, std::memory_order_release);
+  m_written.fetch_add(1, std::memory_order_relaxed);
+
+  if (not dropped)
+  {
+    // There is always at least one free slot when the queue isn't full: the ring has two more
+    // slots than its capacity, and the consumer borrows at most one. It may not have been given
+    // back yet, though.
+    while (m_free_tail == m_free_head.load(std::memory_order_acquire))
+    {
+      std::this_thread::yield();
+    }
+    next = m_free[m_free_tail % nb_slots()].load(std::memory_order_relaxed);
+    ++m_free_tail;
+  }
+  m_writing = next;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_data*
+scan_ring::try_acquire_read()
+noexcept
+{
+  auto tail = m_tail.load(std::memory_order_acquire);
+  while (true)
+  {
+    if (tail == m_head.load(std::memory_order_acquire))
+    {
+      return nullptr;
+    }
+    const auto slot = m_queue[tail % m_capacity].load(std::memory_order_relaxed);
+    if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_acq_rel))
+    {
+      m_reading = slot;
+      return &m_slots[slot];
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_ring::release_read()
+noexcept
+{
+  const auto head = m_free_head.load(std::memory_order_relaxed);
+  m_free[head % nb_slots()].store(m_reading, std::memory_order_relaxed);
+  m_free_head.store(head + 1, std::memory_order_release);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+scan_ring::capacity()
+const noexcept
+{
+  return m_capacity;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+scan_ring::size()
+const noexcept
+{
+  const auto tail = m_tail.load(std::memory_order_acquire);
+  return static_cast<std::size_t>(m_head.load(std::memory_order_acquire) - tail);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+scan_ring::written()
+const noexcept
+{
+  return m_written.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+scan_ring::overruns()
+const noexcept
+{
+  return m_overruns.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+scan_ring::blocked()
+const noexcept
+{
+  return m_blocked.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+overflow_policy
+scan_ring::policy()
+const noexcept
+{
+  return m_policy;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+scan_ring::nb_slots()
+const noexcept
+{
+  return m_capacity + 2;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
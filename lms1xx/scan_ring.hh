@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief What the producer of a scan_ring does when the consumer doesn't keep up
+enum class overflow_policy
+{
+  /// @brief The oldest scan not yet read is dropped
+  overwrite_oldest
+  /// @brief The producer waits for the consumer to read a scan
+  ///
+  /// The producer spins, yielding its thread, until a slot is free: it must own its thread. A
+  /// device with an external io_service would stall all the handlers of that io_service, thus it
+  /// refuses such a ring.
+, block
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A bounded, lock-free, single-producer single-consumer ring of preallocated scans
+///
+/// The producer fills a slot in place, then commits it. The consumer borrows the oldest committed
+/// slot, then releases it. Scans are never copied nor allocated once the ring is constructed.
+///
+/// All methods of the producer side must be called from the same thread, and so do all methods
+/// of the consumer side.
+class scan_ring final
+{
+public:
+
+  /// @brief Can't copy-construct a scan_ring
+  scan_ring(const scan_ring&) = delete;
+
+  /// @brief Can't copy a scan_ring
+  scan_ring& operator=(const scan_ring&) = delete;
+
+  /// @brief Constructor
+  /// @param capacity Number of committed scans which can wait for the consumer
+  /// @param policy What to do when capacity scans are waiting
+  explicit
+  scan_ring(std::size_t capacity, overflow_policy policy = overflow_policy::overwrite_oldest);
+
+  /// @brief Get the slot to fill (producer side)
+  ///
+  /// The same slot is returned until commit_write() is called.
+  scan_data&
+  acquire_write()
+  noexcept;
+
+  /// @brief Make the slot returned by acquire_write() available to the consumer (producer side)
+  ///
+  /// With overflow_policy::block, spin while the ring is full.
+  void
+  commit_write()
+  noexcept;
+
+  /// @brief Borrow the oldest committed scan (consumer side)
+  /// @return nullptr if no scan is available
+  /// @note The previously borrowed scan must have been released.
+  const scan_data*
+  try_acquire_read()
+  noexcept;
+
+  /// @brief Give back the scan borrowed with try_acquire_read() (consumer side)
+  void
+  release_read()
+  noexcept;
+
+  /// @brief The number of committed scans which can wait for the consumer
+  std::size_t
+  capacity()
+  const noexcept;
+
+  /// @brief The number of committed scans waiting for the consumer
+  std::size_t
+  size()
+  const noexcept;
+
+  /// @brief Number of scans committed since construction
+  std::uint64_t
+  written()
+  const noexcept;
+
+  /// @brief Number of scans dropped because the ring was full (overflow_policy::overwrite_oldest)
+  std::uint64_t
+  overruns()
+  const noexcept;
+
+  /// @brief Number of times the producer had to wait because the ring was full
+  /// (overflow_policy::block)
+  std::uint64_t
+  blocked()
+  const noexcept;
+
+  /// @brief What the producer does when the ring is full
+  overflow_policy
+  policy()
+  const noexcept;
+
+private:
+
+  /// @brief Number of preallocated scans
+  std::size_t
+  nb_slots()
+  const noexcept;
+
+private:
+
+  /// @brief Number of committed scans which can wait for the consumer
+  const std::size_t m_capacity;
+
+  /// @brief What to do when the ring is full
+  const overflow_policy m_policy;
+
+  /// @brief Preallocated scans
+  ///
+  /// There are two more slots than the capacity, for the producer and the consumer.
+  std::unique_ptr<scan_data[]> m_slots;
+
+  /// @brief Committed slots, in order
+  std::unique_ptr<std::atomic<std::uint32_t>[]> m_queue;
+
+  /// @brief Position of the next committed slot in m_queue
+  std::atomic<std::uint64_t> m_head;
+
+  /// @brief Position of the oldest committed slot in m_queue
+  ///
+  /// Advanced by the consumer, and by the producer when it drops the oldest scan.
+  std::atomic<std::uint64_t> m_tail;
+
+  /// @brief Slots released by the consumer, given back to the producer
+  std::unique_ptr<std::atomic<std::uint32_t>[]> m_free;
+
+  /// @brief Position of the next released slot in m_free
+  std::atomic<std::uint64_t> m_free_head;
+
+  /// @brief Position of the oldest released slot in m_free (producer only)
+  std::uint64_t m_free_tail;
+
+  /// @brief The slot being filled by the producer
+  std::uint32_t m_writing;
+
+  /// @brief The slot borrowed by the consumer
+  std::uint32_t m_reading;
+
+  /// @brief Number of committed scans
+  std::atomic<std::uint64_t> m_written;
+
+  /// @brief Number of dropped scans
+  std::atomic<std::uint64_t> m_overruns;
+
+  /// @brief Number of waits of the producer
+  std::atomic<std::uint64_t> m_blocked;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
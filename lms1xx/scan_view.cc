@@ -0,0 +1,277 @@
+#include "lms1xx/cursor.hh"
+#include "lms1xx/scan_view.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_view::scan_view(std::size_t capacity)
+  : m_first{nullptr}
+  , m_last{nullptr}
+  , m_fields_end{nullptr}
+  , m_channels{nullptr}
+  , m_binary{false}
+  , m_valid{false}
+  , m_indexed{false}
+  , m_present{0}
+  , m_decoded{0}
+  , m_locations{}
+  , m_scan{capacity}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_view::reset(const char* first, const char* last)
+{
+  auto ec = std::error_code{};
+  reset(first, last, ec);
+  if (ec)
+  {
+    throw invalid_telegram_error{};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_view::reset(const char* first, const char* last, std::error_code& ec)
+noexcept
+{
+  m_first = first;
+  m_last = last;
+  m_binary = cola::is_binary(first, last);
+  m_indexed = false;
+  m_present = 0;
+  m_decoded = 0;
+  m_scan.clear();
+  m_scan.header().has_timestamp = false;
+
+  if (m_binary)
+  {
+    auto payload_first = first;
+    auto payload_last = last;
+    m_valid = cola::payload(first, last, payload_first, payload_last);
+    auto c = binary_cursor{payload_first, payload_last};
+    parse_header(c, m_scan.header());
+    m_valid = m_valid and not c.failed();
+    m_channels = c.position();
+    m_fields_end = payload_last;
+  }
+  else
+  {
+    auto c = cursor{first, last};
+    parse_header(c, m_scan.header());
+    m_valid = not c.failed();
+    m_channels = c.position();
+    m_fields_end = last;
+  }
+  ec = m_valid ? std::error_code{} : make_error_code(errc::invalid_telegram);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const char*
+scan_view::telegram()
+const noexcept
+{
+  return m_first;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+scan_view::telegram_size()
+const noexcept
+{
+  return static_cast<std::size_t>(m_last - m_first);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const scan_header&
+scan_view::header()
+const noexcept
+{
+  return m_scan.header();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_view::index()
+{
+  auto ec = std::error_code{};
+  index(ec);
+  if (ec)
+  {
+    throw invalid_telegram_error{};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_view::index(std::error_code& ec)
+noexcept
+{
+  if (m_valid and not m_indexed)
+  {
+    m_indexed = true;
+    if (m_binary)
+    {
+      auto c = binary_cursor{m_channels, m_fields_end};
+      index_channels(c, 2); // 16-bit channels
+      index_channels(c, 1); // 8-bit channels
+      parse_trailer(c, m_scan.header());
+      m_valid = not c.failed();
+    }
+    else
+    {
+      auto c = cursor{m_channels, m_fields_end};
+      index_channels(c); // 16-bit channels
+      index_channels(c); // 8-bit channels
+      parse_trailer(c, m_scan.header());
+      m_valid = not c.failed();
+    }
+  }
+  ec = m_valid ? std::error_code{} : make_error_code(errc::invalid_telegram);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+scan_view::size(channel c)
+{
+  index();
+  return (m_present & channel_bit(c)) != 0 ? m_locations[static_cast<std::size_t>(c)].size : 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+scan_view::size(channel c, std::error_code& ec)
+noexcept
+{
+  index(ec);
+  if (ec or (m_present & channel_bit(c)) == 0)
+  {
+    return 0;
+  }
+  return m_locations[static_cast<std::size_t>(c)].size;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+channel_span
+scan_view::get(channel c)
+{
+  auto ec = std::error_code{};
+  const auto span = get(c, ec);
+  if (ec)
+  {
+    throw invalid_telegram_error{};
+  }
+  return span;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+channel_span
+scan_view::get(channel c, std::error_code& ec)
+noexcept
+{
+  index(ec);
+  if (ec)
+  {
+    return {nullptr, 0};
+  }
+
+  const auto bit = channel_bit(c);
+  if ((m_present & bit) != 0 and (m_decoded & bit) == 0)
+  {
+    const auto& l = m_locations[static_cast<std::size_t>(c)];
+    const auto storage = m_scan.prepare(c, l.size);
+    if (storage == nullptr)
+    {
+      ec = errc::invalid_telegram;
+      return {nullptr, 0};
+    }
+    if (l.sample_size != 0)
+    {
+      decode_samples(l.samples, l.sample_size, 1, storage, l.size);
+    }
+    else
+    {
+      // Samples were only delimited by index(), they are validated now.
+      auto samples = cursor{l.samples, m_fields_end};
+      decode_samples(samples, storage, l.size);
+      if (samples.failed())
+      {
+        m_scan.prepare(c, 0);
+        ec = errc::invalid_telegram;
+        return {nullptr, 0};
+      }
+    }
+    m_decoded |= bit;
+  }
+  return m_scan.get(c);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_view::index_channels(cursor& c)
+noexcept
+{
+  const auto nb_channels = c.hex(); // NumberChannels16Bit or NumberChannels8Bit
+  for (auto i = 0u; i < nb_channels and not c.failed(); ++i)
+  {
+    auto len = std::size_t{};
+    const auto content = c.token(len); // MeasuredDataContent
+    c.skip(); // ScalingFactor
+    c.skip(); // ScalingOffset
+    c.skip(); // Starting angle
+    c.skip(); // Angular step width
+    const auto nb_data = c.hex(); // NumberData
+    const auto samples = c.position();
+    c.skip(nb_data);
+
+    auto ch = channel{};
+    if (not c.failed() and content_channel(content, len, ch))
+    {
+      m_locations[static_cast<std::size_t>(ch)] = location{samples, nb_data, 0};
+      m_present |= channel_bit(ch);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+scan_view::index_channels(binary_cursor& c, std::size_t sample_size)
+noexcept
+{
+  const auto nb_channels = c.field(2); // NumberChannels16Bit or NumberChannels8Bit
+  for (auto i = 0u; i < nb_channels and not c.failed(); ++i)
+  {
+    const auto content = c.bytes(5); // MeasuredDataContent
+    c.skip(4); // ScalingFactor
+    c.skip(4); // ScalingOffset
+    c.skip(4); // Starting angle
+    c.skip(2); // Angular step width
+    const auto nb_data = c.field(2); // NumberData
+    const auto samples = c.bytes(nb_data * sample_size);
+
+    auto ch = channel{};
+    if (not c.failed() and content_channel(content, 5, ch))
+    {
+      m_locations[static_cast<std::size_t>(ch)] = location{samples, nb_data, sample_size};
+      m_present |= channel_bit(ch);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
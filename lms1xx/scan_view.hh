@@ -0,0 +1,187 @@
+#pragma once
+
+#include <cstddef>
+#include <system_error>
+
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+class binary_cursor;
+class cursor;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A LMDscandata telegram decoded on demand
+///
+/// The view refers to the received bytes, it doesn't copy them. reset() only decodes the fields
+/// which precede the channels: scans dropped on the sole basis of their header cost next to
+/// nothing. The first access to a channel locates all channels and decodes the timestamp, then
+/// only the samples of the accessed channel are decoded. They are kept until the next reset(),
+/// thus later accesses to the same channel are free.
+///
+/// Samples are decoded into storage allocated once, at construction.
+class scan_view final
+{
+public:
+
+  /// @brief Can't copy-construct a scan_view
+  scan_view(const scan_view&) = delete;
+
+  /// @brief Can't copy a scan_view
+  scan_view& operator=(const scan_view&) = delete;
+
+  /// @brief Move constructor
+  scan_view(scan_view&&) = default;
+
+  /// @brief Move operator
+  scan_view& operator=(scan_view&&) = default;
+
+  /// @brief Constructor
+  /// @param capacity Maximal number of samples of each channel
+  /// @throw std::invalid_argument if capacity is 0
+  explicit
+  scan_view(std::size_t capacity = max_samples);
+
+  /// @brief Look at a new telegram
+  /// @param first Beginning of the telegram (may point to the STX delimiter in CoLa-A)
+  /// @param last End of the telegram
+  /// @throw invalid_telegram_error if the header of the telegram is truncated or malformed
+  ///
+  /// The bytes must stay valid and unchanged as long as the view is used.
+  void
+  reset(const char* first, const char* last);
+
+  /// @brief Look at a new telegram, without throwing
+  /// @param ec Set to errc::invalid_telegram if the header of the telegram is truncated or
+  /// malformed, cleared otherwise
+  void
+  reset(const char* first, const char* last, std::error_code& ec)
+  noexcept;
+
+  /// @brief The first byte of the telegram
+  const char*
+  telegram()
+  const noexcept;
+
+  /// @brief Number of bytes of the telegram
+  std::size_t
+  telegram_size()
+  const noexcept;
+
+  /// @brief Header of the telegram
+  ///
+  /// The timestamp follows the samples in the telegram: it is only decoded once the channels are
+  /// located, by index() or by the first access to a channel.
+  const scan_header&
+  header()
+  const noexcept;
+
+  /// @brief Locate the channels and decode the timestamp, if not done yet
+  /// @throw invalid_telegram_error if the telegram is truncated or malformed
+  ///
+  /// Samples are skipped without being decoded.
+  void
+  index();
+
+  /// @brief Locate the channels and decode the timestamp, if not done yet, without throwing
+  /// @param ec Set to errc::invalid_telegram if the telegram is truncated or malformed, cleared
+  /// otherwise
+  void
+  index(std::error_code& ec)
+  noexcept;
+
+  /// @brief Number of samples of a channel, without decoding them
+  /// @return 0 if the channel is absent from the scan
+  /// @throw invalid_telegram_error if the telegram is truncated or malformed
+  std::size_t
+  size(channel c);
+
+  /// @brief Number of samples of a channel, without decoding them nor throwing
+  std::size_t
+  size(channel c, std::error_code& ec)
+  noexcept;
+
+  /// @brief Get the samples of a channel, decoded at the first access
+  /// @throw invalid_telegram_error if the telegram is truncated or malformed, or if the channel
+  /// has more samples than the capacity of the view
+  ///
+  /// The samples stay valid until the next reset().
+  channel_span
+  get(channel c);
+
+  /// @brief Get the samples of a channel, decoded at the first access, without throwing
+  /// @param ec Set to errc::invalid_telegram if the telegram is truncated or malformed, or if the
+  /// channel has more samples than the capacity of the view, cleared otherwise
+  /// @return An empty span on error
+  channel_span
+  get(channel c, std::error_code& ec)
+  noexcept;
+
+private:
+
+  /// @brief Where the samples of a channel are in the telegram
+  struct location
+  {
+    /// @brief The first sample
+    const char* samples;
+
+    /// @brief Number of samples
+    std::size_t size;
+
+    /// @brief 2 or 1 for 16-bit and 8-bit CoLa-B samples, 0 for CoLa-A samples
+    std::size_t sample_size;
+  };
+
+  /// @brief Locate the 16-bit or 8-bit channels of a CoLa-A telegram
+  void
+  index_channels(cursor& c)
+  noexcept;
+
+  /// @brief Locate the 16-bit or 8-bit channels of a CoLa-B telegram
+  void
+  index_channels(binary_cursor& c, std::size_t sample_size)
+  noexcept;
+
+private:
+
+  /// @brief The first byte of the telegram
+  const char* m_first;
+
+  /// @brief The end of the telegram
+  const char* m_last;
+
+  /// @brief The end of the fields of the telegram, before the checksum in CoLa-B
+  const char* m_fields_end;
+
+  /// @brief The number of 16-bit channels, where decoding stopped after the header
+  const char* m_channels;
+
+  /// @brief True for a CoLa-B telegram
+  bool m_binary;
+
+  /// @brief False if the telegram is truncated or malformed
+  bool m_valid;
+
+  /// @brief True once the channels are located
+  bool m_indexed;
+
+  /// @brief The channels found in the telegram, as a combination of channel_bit()
+  unsigned m_present;
+
+  /// @brief The channels already decoded, as a combination of channel_bit()
+  unsigned m_decoded;
+
+  /// @brief Where the samples of each channel are
+  location m_locations[compact_scan::nb_channels];
+
+  /// @brief The header and the decoded samples
+  compact_scan m_scan;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,113 @@
+#include <algorithm> // min, sort
+#include <stdexcept>
+#include <utility> // move
+
+#include "lms1xx/sector_reduction.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+sector_reduction::sector_reduction(std::vector<sector> sectors, sector_handler handler)
+  : m_sectors{std::move(sectors)}
+  , m_order(m_sectors.size())
+  , m_minima(m_sectors.size())
+  , m_handler{std::move(handler)}
+{
+  for (auto i = std::size_t{0}; i < m_sectors.size(); ++i)
+  {
+    if (m_sectors[i].stop_angle < m_sectors[i].start_angle)
+    {
+      throw std::invalid_argument{"empty sector"};
+    }
+    m_order[i] = i;
+    m_minima[i] = sector_minimum{i, 0, 0, 0};
+  }
+  std::sort( m_order.begin(), m_order.end()
+           , [this](std::size_t lhs, std::size_t rhs)
+             {
+               return m_sectors[lhs].stop_angle < m_sectors[rhs].stop_angle;
+             });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const std::vector<sector>&
+sector_reduction::sectors()
+const noexcept
+{
+  return m_sectors;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const std::vector<sector_minimum>&
+sector_reduction::minima()
+const noexcept
+{
+  return m_minima;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+sector_reduction::range( const sector& s, std::int64_t first_angle, std::int64_t step
+                       , std::size_t n, std::size_t& lo, std::size_t& hi)
+const noexcept
+{
+  lo = 0;
+  hi = 0;
+  const auto start = s.start_angle - first_angle;
+  const auto stop = s.stop_angle - first_angle;
+  if (n == 0 or stop < 0)
+  {
+    return;
+  }
+  if (step <= 0)
+  {
+    // All samples have the same angle.
+    hi = start <= 0 ? n : 0;
+    return;
+  }
+  const auto first = start <= 0 ? std::int64_t{0} : (start + step - 1) / step;
+  const auto last = std::min(static_cast<std::int64_t>(n) - 1, stop / step);
+  if (first <= last)
+  {
+    lo = static_cast<std::size_t>(first);
+    hi = static_cast<std::size_t>(last) + 1;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+sector_reduction::reduce_sector( const scan_header& header, std::size_t i
+                               , std::int64_t first_angle, std::int64_t step
+                               , const std::uint16_t* samples, std::size_t lo, std::size_t hi)
+{
+  auto& m = m_minima[i];
+  m.distance = 0;
+  m.sample = 0;
+  m.angle = 0;
+  for (auto j = lo; j < hi; ++j)
+  {
+    // Samples without echo are 0, they are seen as the farthest ones.
+    if (static_cast<std::uint16_t>(samples[j] - 1) < static_cast<std::uint16_t>(m.distance - 1))
+    {
+      m.distance = samples[j];
+      m.sample = j;
+    }
+  }
+  if (m.distance != 0)
+  {
+    m.angle = static_cast<int>(first_angle + step * static_cast<std::int64_t>(m.sample));
+  }
+  if (m_handler)
+  {
+    m_handler(header, m);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Reduce DIST1 to its closest echo in each sector, while it is decoded
+///
+/// Samples are decoded up to the end of a sector, then the sector is reduced while its samples
+/// are still in cache, and reported before the following samples are decoded. Thus, the first
+/// sectors are known before the telegram is completely decoded. Samples of value 0 (no echo) are
+/// ignored. Sectors may overlap: they are processed by increasing stop angle, the order in which
+/// their samples are complete.
+class sector_reduction final
+{
+public:
+
+  /// @brief Can't copy-construct a sector_reduction
+  sector_reduction(const sector_reduction&) = delete;
+
+  /// @brief Can't copy a sector_reduction
+  sector_reduction& operator=(const sector_reduction&) = delete;
+
+  /// @brief Constructor
+  /// @param sectors The sectors to reduce
+  /// @param handler Called for each sector of each scan, may be nullptr
+  /// @throw std::invalid_argument if a sector is empty
+  explicit
+  sector_reduction(std::vector<sector> sectors, sector_handler handler = nullptr);
+
+  /// @brief The sectors to reduce, in the order of the configuration
+  const std::vector<sector>&
+  sectors()
+  const noexcept;
+
+  /// @brief The closest echoes of the last reduced scan, in the order of the configuration
+  const std::vector<sector_minimum>&
+  minima()
+  const noexcept;
+
+  /// @brief Reduce a channel while decoding it
+  /// @param header The header of the scan, given to the handler
+  /// @param first_angle Angle of the first sample, in 1/10000 degree
+  /// @param step Angle between two samples, in 1/10000 degree
+  /// @param samples Where samples are decoded
+  /// @param n Number of samples
+  /// @param decode Called with increasing bounds to decode the samples up to a bound, excluded;
+  /// returns false if the telegram is malformed, which stops the reduction
+  template <typename Decode>
+  void
+  reduce( const scan_header& header, std::int64_t first_angle, std::int64_t step
+        , const std::uint16_t* samples, std::size_t n, Decode&& decode);
+
+private:
+
+  /// @brief Get the samples of a sector
+  /// @param lo Set to the first sample of the sector
+  /// @param hi Set after the last sample of the sector, not lower than lo
+  void
+  range( const sector& s, std::int64_t first_angle, std::int64_t step, std::size_t n
+       , std::size_t& lo, std::size_t& hi)
+  const noexcept;
+
+  /// @brief Find the closest echo of a sector and report it
+  void
+  reduce_sector( const scan_header& header, std::size_t i, std::int64_t first_angle
+               , std::int64_t step, const std::uint16_t* samples, std::size_t lo, std::size_t hi);
+
+private:
+
+  /// @brief The sectors to reduce
+  std::vector<sector> m_sectors;
+
+  /// @brief Indices of sectors sorted by stop angle
+  std::vector<std::size_t> m_order;
+
+  /// @brief The closest echoes of the last reduced scan
+  std::vector<sector_minimum> m_minima;
+
+  /// @brief Called for each reduced sector
+  sector_handler m_handler;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+template <typename Decode>
+void
+sector_reduction::reduce( const scan_header& header, std::int64_t first_angle, std::int64_t step
+                        , const std::uint16_t* samples, std::size_t n, Decode&& decode)
+{
+  auto decoded = std::size_t{0};
+  for (const auto i : m_order)
+  {
+    auto lo = std::size_t{0};
+    auto hi = std::size_t{0};
+    range(m_sectors[i], first_angle, step, n, lo, hi);
+    if (hi > decoded)
+    {
+      if (not decode(hi))
+      {
+        return;
+      }
+      decoded = hi;
+    }
+    reduce_sector(header, i, first_angle, step, samples, lo, hi);
+  }
+  if (decoded < n)
+  {
+    decode(n);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
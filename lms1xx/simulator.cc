@@ -0,0 +1,680 @@
+#include <algorithm> // find, min
+#include <chrono>
+#include <cmath>
+#include <ctime>     // gmtime_r
+#include <deque>
+
+#include <boost/asio/deadline_timer.hpp>
+#include <boost/asio/streambuf.hpp>
+#include <boost/asio/write.hpp>
+
+#include "lms1xx/cola.hh"
+#include "lms1xx/simulator.hh"
+
+namespace lms1xx {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+// Maximal number of points of a scan.
+static constexpr auto maximal_nb_points = 1082;
+
+// Maximal number of telegrams waiting to be sent to a client before scans are dropped.
+static constexpr auto maximal_pending_telegrams = 64ul;
+
+// Number of bytes requested to the socket by each read.
+static constexpr auto read_size = 4096ul;
+
+// Time for the mirror to reach its speed once measurements are started.
+static constexpr auto spin_up_time = std::chrono::milliseconds{100};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Tell which protocol is used by the first telegram of received bytes
+/// @return false if there are not enough bytes to decide
+bool
+detect_protocol(const char* first, const char* last, protocol& p)
+noexcept
+{
+  const auto begin = std::find(first, last, cola::telegram_start);
+  if (last - begin < 2)
+  {
+    return false;
+  }
+  p = begin[1] == cola::telegram_start ? protocol::cola_b : protocol::cola_a;
+  return true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+nb_points(const scan_configuration& cfg)
+{
+  if (cfg.angle_resolution <= 0 or cfg.stop_angle < cfg.start_angle)
+  {
+    return 0;
+  }
+  const auto n = (cfg.stop_angle - cfg.start_angle) / cfg.angle_resolution + 1;
+  return n < maximal_nb_points ? n : maximal_nb_points;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A connection of a client to the simulated device
+class simulator::session final
+  : public std::enable_shared_from_this<session>
+{
+public:
+
+  session(simulator& sim, boost::asio::ip::tcp::socket socket)
+    : m_sim(sim)
+    , m_socket{std::move(socket)}
+    , m_input{}
+    , m_timer{m_sim.m_io}
+    , m_output{}
+    , m_protocol{protocol::cola_a}
+    , m_streaming{false}
+    , m_measuring{true}
+    , m_measuring_since{}
+    , m_telegram_counter{0}
+    , m_scan_counter{0}
+    , m_recorded_index{0}
+    , m_noise{12345}
+    , m_start{std::chrono::steady_clock::now()}
+    , m_profile{}
+    , m_profile_cfg{}
+  {}
+
+  void
+  start()
+  {
+    // Replies are sent as soon as commands are handled, like by a real device.
+    auto ignored_ec = boost::system::error_code{};
+    m_socket.set_option(boost::asio::ip::tcp::no_delay{true}, ignored_ec);
+    read();
+  }
+
+private:
+
+  void
+  read()
+  {
+    auto self = shared_from_this();
+    m_socket.async_read_some( m_input.prepare(read_size)
+                            , [this, self](const boost::system::error_code& ec, std::size_t n)
+                              {
+                                if (ec)
+                                {
+                                  close();
+                                  return;
+                                }
+                                m_input.commit(n);
+                                handle_input();
+                                read();
+                              });
+  }
+
+  void
+  close()
+  {
+    auto ignored_ec = boost::system::error_code{};
+    m_timer.cancel(ignored_ec);
+    m_socket.close(ignored_ec);
+  }
+
+  void
+  handle_input()
+  {
+    while (true)
+    {
+      const auto first = boost::asio::buffer_cast<const char*>(m_input.data());
+      const auto last = first + m_input.size();
+      auto begin = first;
+      auto end = first;
+      if (not detect_protocol(first, last, m_protocol)
+          or not cola::find_telegram(first, last, m_protocol, begin, end))
+      {
+        m_input.consume(static_cast<std::size_t>(begin - first));
+        return;
+      }
+      try
+      {
+        handle(cola::reader{begin, end});
+      }
+      catch (const invalid_telegram_error&)
+      {
+        send(cola::writer{m_protocol, "sFA", "1"});
+      }
+      m_input.consume(static_cast<std::size_t>(end - first));
+    }
+  }
+
+  void
+  handle(cola::reader command)
+  {
+    const auto& type = command.type();
+    const auto& name = command.name();
+
+    if (type == "sMN" and name == "SetAccessMode")
+    {
+      send(cola::writer{m_protocol, "sAN", "SetAccessMode"}.field(1, 1));
+    }
+    else if (type == "sMN" and name == "mLMPsetscancfg")
+    {
+      auto cfg = scan_configuration{};
+      cfg.scaning_frequency = static_cast<int>(command.field(4));
+      command.signed_field(2); // Number of sectors
+      cfg.angle_resolution = static_cast<int>(command.field(4));
+      cfg.start_angle = command.signed_field(4);
+      cfg.stop_angle = command.signed_field(4);
+      m_sim.set_scan_configuration(cfg);
+
+      auto reply = cola::writer{m_protocol, "sAN", "mLMPsetscancfg"};
+      reply.field(0, 1);
+      send(scan_configuration_fields(reply, cfg));
+    }
+    else if (type == "sRN" and name == "LMPscancfg")
+    {
+      auto reply = cola::writer{m_protocol, "sRA", "LMPscancfg"};
+      send(scan_configuration_fields(reply, m_sim.get_scan_configuration()));
+    }
+    else if (type == "sWN" and name == "LMDscandatacfg")
+    {
+      auto cfg = scan_data_configuration{};
+      cfg.output_channel = static_cast<int>(command.field(1));
+      command.field(1);
+      cfg.remission = command.field(1) != 0;
+      cfg.resolution = static_cast<int>(command.field(1));
+      command.field(1); // Unit
+      cfg.encoder = static_cast<int>(command.field(1));
+      command.field(1);
+      cfg.position = command.field(1) != 0;
+      cfg.device_name = command.field(1) != 0;
+      command.field(1); // Comment
+      cfg.timestamp = command.field(1) != 0;
+      cfg.output_interval = command.signed_field(2);
+      m_sim.set_scan_data_configuration(cfg);
+      send(cola::writer{m_protocol, "sWA", "LMDscandatacfg"});
+    }
+    else if (type == "sRN" and name == "LMPoutputRange")
+    {
+      const auto cfg = m_sim.get_scan_configuration();
+      send(cola::writer{m_protocol, "sRA", "LMPoutputRange"}
+             .field(1, 2)
+             .field(static_cast<std::uint32_t>(cfg.angle_resolution), 4)
+             .field(static_cast<std::uint32_t>(cfg.start_angle), 4)
+             .field(static_cast<std::uint32_t>(cfg.stop_angle), 4));
+    }
+    else if (type == "sEN" and name == "LMDscandata")
+    {
+      const auto enable = command.field(1) != 0;
+      send(cola::writer{m_protocol, "sEA", "LMDscandata"}.field(enable ? 1 : 0, 1));
+      if (enable and not m_streaming)
+      {
+        m_streaming = true;
+        m_timer.expires_from_now(period());
+        stream();
+      }
+      else if (not enable)
+      {
+        m_streaming = false;
+        auto ignored_ec = boost::system::error_code{};
+        m_timer.cancel(ignored_ec);
+      }
+    }
+    else if (type == "sRN" and name == "STlms")
+    {
+      const auto st = not m_measuring ? device_status::idle
+                    : std::chrono::steady_clock::now() - m_measuring_since < spin_up_time
+                    ? device_status::in_preparation
+                    : device_status::ready_for_measurement;
+      send(cola::writer{m_protocol, "sRA", "STlms"}.field(static_cast<std::uint32_t>(st), 2));
+    }
+    else if (type == "sMN" and name == "LMCstartmeas")
+    {
+      if (not m_measuring)
+      {
+        m_measuring = true;
+        m_measuring_since = std::chrono::steady_clock::now();
+      }
+      send(cola::writer{m_protocol, "sAN", "LMCstartmeas"}.field(0, 1));
+    }
+    else if (type == "sMN" and name == "LMCstopmeas")
+    {
+      m_measuring = false;
+      send(cola::writer{m_protocol, "sAN", "LMCstopmeas"}.field(0, 1));
+    }
+    else if (type == "sMN" and name == "Run")
+    {
+      send(cola::writer{m_protocol, "sAN", "Run"}.field(1, 1));
+    }
+    else if (type == "sMN" and name == "mEEwriteall")
+    {
+      send(cola::writer{m_protocol, "sAN", "mEEwriteall"}.field(1, 1));
+    }
+    else
+    {
+      send(cola::writer{m_protocol, "sFA", "1"});
+    }
+  }
+
+  static
+  cola::writer&
+  scan_configuration_fields(cola::writer& w, const scan_configuration& cfg)
+  {
+    return w.field(static_cast<std::uint32_t>(cfg.scaning_frequency), 4)
+            .signed_field(1, 2)
+            .field(static_cast<std::uint32_t>(cfg.angle_resolution), 4)
+            .field(static_cast<std::uint32_t>(cfg.start_angle), 4)
+            .field(static_cast<std::uint32_t>(cfg.stop_angle), 4);
+  }
+
+  boost::posix_time::time_duration
+  period()
+  const
+  {
+    const auto frequency = m_sim.get_scan_configuration().scaning_frequency; // 1/100 Hz
+    return boost::posix_time::microseconds{100000000 / (frequency > 0 ? frequency : 5000)};
+  }
+
+  void
+  stream()
+  {
+    auto self = shared_from_this();
+    m_timer.async_wait([this, self](const boost::system::error_code& ec)
+                       {
+                         if (ec or not m_streaming)
+                         {
+                           return;
+                         }
+
+                         send_scan();
+
+                         // Don't try to catch up if we are late.
+                         const auto now = boost::asio::deadline_timer::traits_type::now();
+                         auto next = m_timer.expires_at() + period();
+                         if (next < now)
+                         {
+                           next = now + period();
+                         }
+                         m_timer.expires_at(next);
+                         stream();
+                       });
+  }
+
+  void
+  send_scan()
+  {
+    const auto state = m_sim.state();
+    ++m_scan_counter;
+
+    const auto interval = state.data_cfg.output_interval > 0 ? state.data_cfg.output_interval : 1;
+    if (m_scan_counter % interval != 0 or m_output.size() >= maximal_pending_telegrams)
+    {
+      return;
+    }
+
+    if (state.recorded and not state.recorded->empty())
+    {
+      const auto& recorded = *state.recorded;
+      write_telegram(recorded[m_recorded_index++ % recorded.size()]);
+    }
+    else
+    {
+      write_telegram(build_scan(state));
+    }
+    m_sim.m_scans_sent.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  std::uint32_t
+  noise()
+  noexcept
+  {
+    m_noise = m_noise * 1103515245u + 12345u;
+    return m_noise >> 16;
+  }
+
+  void
+  update_profile(const scan_configuration& cfg)
+  {
+    if (    m_profile_cfg.angle_resolution == cfg.angle_resolution
+        and m_profile_cfg.start_angle == cfg.start_angle
+        and m_profile_cfg.stop_angle == cfg.stop_angle
+        and not m_profile.empty())
+    {
+      return;
+    }
+
+    // A rectangular room of 8 by 5 meters.
+    m_profile.resize(static_cast<std::size_t>(nb_points(cfg)));
+    for (auto i = 0ul; i < m_profile.size(); ++i)
+    {
+      const auto angle = (cfg.start_angle + static_cast<double>(i) * cfg.angle_resolution)
+                       / 10000.0 * M_PI / 180.0;
+      const auto c = std::abs(std::cos(angle));
+      const auto s = std::abs(std::sin(angle));
+      const auto dx = c > 1e-6 ? 4000.0 / c : 1e9;
+      const auto dy = s > 1e-6 ? 2500.0 / s : 1e9;
+      m_profile[i] = static_cast<std::uint16_t>(std::min(std::min(dx, dy), 20000.0));
+    }
+    m_profile_cfg = cfg;
+  }
+
+  void
+  append_channel(cola::writer& telegram, const char* name, bool distance, bool bits8)
+  {
+    const auto size = bits8 ? 1 : 2;
+    telegram.text(name, 5)
+            .field(0x3F800000, 4) // Scaling factor
+            .field(0, 4, 8)       // Scaling offset
+            .field(static_cast<std::uint32_t>(m_profile_cfg.start_angle), 4)
+            .field(static_cast<std::uint32_t>(m_profile_cfg.angle_resolution), 2)
+            .field(static_cast<std::uint32_t>(m_profile.size()), 2);
+    for (const auto d : m_profile)
+    {
+      const auto n = noise();
+      if (distance)
+      {
+        // Some points without echo.
+        telegram.field((n & 0x3F) == 0 ? 0 : d + (n & 0x1F), size);
+      }
+      else
+      {
+        telegram.field(bits8 ? 100 + (n & 0x7F) : 1000 + (n & 0x3FF), size);
+      }
+    }
+  }
+
+  std::string
+  build_scan(const device_state& state)
+  {
+    const auto& cfg = state.data_cfg;
+    update_profile(state.scan_cfg);
+
+    const auto uptime = static_cast<std::uint32_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_start).count());
+
+    auto telegram = cola::writer{m_protocol, "sSN", "LMDscandata"};
+    telegram.field(1, 2)         // Version number
+            .field(1, 2)         // Device number
+            .field(0x89A27F, 4)  // Serial number
+            .field(0, 1)         // Device status
+            .field(0, 1)
+            .field(++m_telegram_counter & 0xFFFF, 2)
+            .field(m_scan_counter & 0xFFFF, 2)
+            .field(uptime, 4)
+            .field(uptime + 100, 4)
+            .field(0, 1)         // Input status
+            .field(0, 1)
+            .field(0, 1)         // Output status
+            .field(0, 1)
+            .field(0, 2)         // Reserved byte A
+            .field(static_cast<std::uint32_t>(state.scan_cfg.scaning_frequency), 4)
+            .field(0x168, 4);    // Measurement frequency
+
+    // Encoders.
+    if (cfg.encoder != 0)
+    {
+      telegram.field(1, 2).field(m_scan_counter * 100, 4).field(0x64, 2);
+    }
+    else
+    {
+      telegram.field(0, 2);
+    }
+
+    const auto dist1 = (cfg.output_channel & 1) != 0;
+    const auto dist2 = (cfg.output_channel & 2) != 0;
+    const auto rssi16 = cfg.remission and cfg.resolution == 1;
+    const auto rssi8 = cfg.remission and cfg.resolution == 0;
+
+    // 16-bit channels.
+    telegram.field(dist1 + dist2 + (rssi16 ? dist1 + dist2 : 0), 2);
+    if (dist1) append_channel(telegram, "DIST1", true, false);
+    if (dist2) append_channel(telegram, "DIST2", true, false);
+    if (rssi16 and dist1) append_channel(telegram, "RSSI1", false, false);
+    if (rssi16 and dist2) append_channel(telegram, "RSSI2", false, false);
+
+    // 8-bit channels.
+    telegram.field(rssi8 ? dist1 + dist2 : 0, 2);
+    if (rssi8 and dist1) append_channel(telegram, "RSSI1", false, true);
+    if (rssi8 and dist2) append_channel(telegram, "RSSI2", false, true);
+
+    // Position, device name and comment are never output.
+    telegram.field(0, 2).field(0, 2).field(0, 2);
+
+    if (cfg.timestamp)
+    {
+      const auto now = std::chrono::system_clock::now();
+      const auto t = std::chrono::system_clock::to_time_t(now);
+      const auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        now.time_since_epoch()).count() % 1000000;
+      std::tm tm;
+      gmtime_r(&t, &tm);
+      telegram.field(1, 2)
+              .field(static_cast<std::uint32_t>(tm.tm_year + 1900), 2)
+              .field(static_cast<std::uint32_t>(tm.tm_mon + 1), 1)
+              .field(static_cast<std::uint32_t>(tm.tm_mday), 1)
+              .field(static_cast<std::uint32_t>(tm.tm_hour), 1)
+              .field(static_cast<std::uint32_t>(tm.tm_min), 1)
+              .field(static_cast<std::uint32_t>(tm.tm_sec), 1)
+              .field(static_cast<std::uint32_t>(us), 4);
+    }
+    else
+    {
+      telegram.field(0, 2);
+    }
+
+    telegram.field(0, 2); // Event info
+
+    return telegram.str();
+  }
+
+  void
+  send(const cola::writer& telegram)
+  {
+    write_telegram(telegram.str());
+  }
+
+  void
+  write_telegram(std::string telegram)
+  {
+    m_output.push_back(std::move(telegram));
+    if (m_output.size() == 1)
+    {
+      write();
+    }
+  }
+
+  void
+  write()
+  {
+    auto self = shared_from_this();
+    boost::asio::async_write( m_socket, boost::asio::buffer(m_output.front())
+                            , [this, self](const boost::system::error_code& ec, std::size_t)
+                              {
+                                if (ec)
+                                {
+                                  close();
+                                  return;
+                                }
+                                m_output.pop_front();
+                                if (not m_output.empty())
+                                {
+                                  write();
+                                }
+                              });
+  }
+
+private:
+
+  /// @brief The simulated device
+  simulator& m_sim;
+
+  /// @brief The connection to the client
+  boost::asio::ip::tcp::socket m_socket;
+
+  /// @brief Received commands
+  boost::asio::streambuf m_input;
+
+  /// @brief Pace the stream of scans
+  boost::asio::deadline_timer m_timer;
+
+  /// @brief Telegrams waiting to be sent
+  std::deque<std::string> m_output;
+
+  /// @brief The protocol of the last command, used for replies and scans
+  protocol m_protocol;
+
+  /// @brief True if LMDscandata is enabled
+  bool m_streaming;
+
+  /// @brief True if measurements are started
+  bool m_measuring;
+
+  /// @brief When measurements were started, to simulate the spin-up of the device
+  std::chrono::steady_clock::time_point m_measuring_since;
+
+  /// @brief Number of scan telegrams sent
+  std::uint32_t m_telegram_counter;
+
+  /// @brief Number of scans made
+  std::uint32_t m_scan_counter;
+
+  /// @brief Next recorded telegram to send
+  std::size_t m_recorded_index;
+
+  /// @brief State of the random noise generator
+  std::uint32_t m_noise;
+
+  /// @brief When the session started, to compute the device uptime
+  std::chrono::steady_clock::time_point m_start;
+
+  /// @brief Distances of the simulated environment
+  std::vector<std::uint16_t> m_profile;
+
+  /// @brief The configuration m_profile was computed for
+  scan_configuration m_profile_cfg;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+simulator::simulator(unsigned short port)
+  : m_io{}
+  , m_acceptor{m_io, {boost::asio::ip::address_v4::loopback(), port}}
+  , m_mutex{}
+  , m_state{}
+  , m_scans_sent{0}
+  , m_thread{}
+{
+  m_state.scan_cfg = {5000, 5000, -450000, 2250000};
+  m_state.data_cfg = {1, false, 0, 0, false, false, false, 1};
+
+  accept();
+  m_thread = std::thread{[this]{ m_io.run(); }};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+simulator::~simulator()
+{
+  m_io.stop();
+  m_thread.join();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+unsigned short
+simulator::port()
+const noexcept
+{
+  return m_acceptor.local_endpoint().port();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+simulator::set_scan_configuration(const scan_configuration& cfg)
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_state.scan_cfg = cfg;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+scan_configuration
+simulator::get_scan_configuration()
+const
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_state.scan_cfg;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+simulator::set_scan_data_configuration(const scan_data_configuration& cfg)
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_state.data_cfg = cfg;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+simulator::set_recorded_scans(std::vector<std::string> telegrams)
+{
+  auto recorded = std::make_shared<const std::vector<std::string>>(std::move(telegrams));
+  std::lock_guard<std::mutex> lock{m_mutex};
+  m_state.recorded = std::move(recorded);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+simulator::scans_sent()
+const noexcept
+{
+  return m_scans_sent.load(std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+simulator::device_state
+simulator::state()
+const
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_state;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+simulator::accept()
+{
+  auto socket = std::make_shared<boost::asio::ip::tcp::socket>(m_io);
+  m_acceptor.async_accept(*socket, [this, socket](const boost::system::error_code& ec)
+                                   {
+                                     if (ec == boost::asio::error::operation_aborted)
+                                     {
+                                       return;
+                                     }
+                                     if (not ec)
+                                     {
+                                       const auto s = std::make_shared<session>( *this
+                                                                               , std::move(*socket));
+                                       s->start();
+                                     }
+                                     accept();
+                                   });
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <boost/asio/io_service.hpp>
+#include <boost/asio/ip/tcp.hpp>
+
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A simulated LMS1xx device
+///
+/// Listen on the loopback interface and answer the telegrams sent by LMS1xx, in CoLa-A or CoLa-B
+/// depending on the protocol of each command. Once LMDscandata is enabled by a client, scans are
+/// streamed at the configured scanning frequency, with as many points as defined by the scan
+/// configuration. Scans are synthetic, unless recorded telegrams are given.
+/// Measurements are started when a client connects. When they are stopped then started again,
+/// the device is in preparation for a short time, as the mirror spins up.
+///
+/// Each simulator has its own I/O thread, thus many of them can run at the same time.
+class simulator final
+{
+public:
+
+  /// @brief Can't copy-construct a simulator
+  simulator(const simulator&) = delete;
+
+  /// @brief Can't copy a simulator
+  simulator& operator=(const simulator&) = delete;
+
+  /// @brief Start a simulated device
+  /// @param port The port to listen on, 0 to let the system choose one
+  ///
+  /// The default scan configuration is 50 Hz, 0.5 degree, from -45 to 225 degrees.
+  explicit
+  simulator(unsigned short port = 0);
+
+  /// @brief Destructor
+  ///
+  /// Stop the simulated device and disconnect all clients.
+  ~simulator();
+
+  /// @brief The port the simulated device listens on
+  unsigned short
+  port()
+  const noexcept;
+
+  /// @brief Set the scan configuration
+  ///
+  /// Same effect as LMS1xx::set_scan_configuration(). The number of points of each scan is
+  /// derived from the angular range and resolution.
+  void
+  set_scan_configuration(const scan_configuration& cfg);
+
+  /// @brief Get the current scan configuration
+  scan_configuration
+  get_scan_configuration()
+  const;
+
+  /// @brief Stream recorded telegrams rather than synthetic scans
+  /// @param telegrams Complete LMDscandata telegrams, including STX and ETX, sent in a loop
+  ///
+  /// The scan data configuration sent by clients is ignored for recorded telegrams.
+  void
+  set_recorded_scans(std::vector<std::string> telegrams);
+
+  /// @brief Number of scans sent to all clients since the simulator started
+  std::size_t
+  scans_sent()
+  const noexcept;
+
+private:
+
+  class session;
+
+  /// @brief State of the simulated device, shared by all sessions
+  struct device_state
+  {
+    scan_configuration scan_cfg;
+    scan_data_configuration data_cfg;
+    std::shared_ptr<const std::vector<std::string>> recorded;
+  };
+
+  void
+  accept();
+
+  device_state
+  state()
+  const;
+
+  void
+  set_scan_data_configuration(const scan_data_configuration& cfg);
+
+private:
+
+  /// @brief Manage I/O of all sessions
+  boost::asio::io_service m_io;
+
+  /// @brief Wait for clients
+  boost::asio::ip::tcp::acceptor m_acceptor;
+
+  /// @brief Protect m_state
+  mutable std::mutex m_mutex;
+
+  /// @brief The configuration of the simulated device
+  device_state m_state;
+
+  /// @brief Number of sent scans
+  std::atomic<std::size_t> m_scans_sent;
+
+  /// @brief Run m_io
+  std::thread m_thread;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
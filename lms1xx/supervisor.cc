@@ -0,0 +1,234 @@
+#include <algorithm> // max, min
+
+#include "lms1xx/supervisor.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+supervisor::supervisor( const std::string& host, const std::string& port
+                      , const boost::posix_time::time_duration& timeout
+                      , std::chrono::milliseconds first_retry, std::chrono::milliseconds max_retry
+                      , protocol p)
+  : m_device{host, port, timeout, p}
+  , m_host{host}
+  , m_port{port}
+  , m_first_retry{first_retry}
+  , m_max_retry{std::max(first_retry, max_retry)}
+  , m_has_scan_configuration{false}
+  , m_scan_configuration{}
+  , m_scan_data_configuration{}
+  , m_mutex{}
+  , m_wake_up{}
+  , m_running{false}
+  , m_link_lost{false}
+  , m_error{}
+  , m_outage_start{}
+  , m_statistics{}
+  , m_thread{}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+supervisor::~supervisor()
+{
+  stop();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+LMS1xx&
+supervisor::device()
+noexcept
+{
+  return m_device;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+supervisor::set_scan_configuration(const scan_configuration& cfg)
+{
+  m_device.login();
+  m_device.set_scan_configuration(cfg);
+  m_scan_configuration = cfg;
+  m_has_scan_configuration = true;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+supervisor::start( const scan_data_configuration& cfg, scan_handler handler
+                 , error_handler on_outage)
+{
+  if (running())
+  {
+    return;
+  }
+
+  m_device.bring_up(cfg);
+  m_scan_data_configuration = cfg;
+
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_running = true;
+    m_link_lost = false;
+  }
+  m_thread = std::thread{[this, handler, on_outage]{ supervise(handler, on_outage); }};
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+supervisor::stop()
+{
+  {
+    std::lock_guard<std::mutex> lock{m_mutex};
+    m_running = false;
+  }
+  m_wake_up.notify_all();
+  if (m_thread.joinable())
+  {
+    m_thread.join();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+supervisor::running()
+const
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  return m_running;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+recovery_statistics
+supervisor::get_recovery_statistics()
+const
+{
+  std::lock_guard<std::mutex> lock{m_mutex};
+  auto result = m_statistics;
+  if (m_link_lost)
+  {
+    result.outage_time += std::chrono::steady_clock::now() - m_outage_start;
+  }
+  return result;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+supervisor::supervise(scan_handler handler, error_handler on_outage)
+{
+  while (true)
+  {
+    m_device.start_stream(handler, [this](std::exception_ptr error)
+                                   {
+                                     {
+                                       std::lock_guard<std::mutex> lock{m_mutex};
+                                       m_link_lost = true;
+                                       m_error = error;
+                                       m_outage_start = std::chrono::steady_clock::now();
+                                       ++m_statistics.outages;
+                                     }
+                                     m_wake_up.notify_all();
+                                   });
+
+    auto error = std::exception_ptr{};
+    {
+      std::unique_lock<std::mutex> lock{m_mutex};
+      m_wake_up.wait(lock, [this]{ return m_link_lost or not m_running; });
+      if (not m_running)
+      {
+        break;
+      }
+      error = m_error;
+    }
+
+    // Wait for the I/O thread of the device, stopped by the error.
+    m_device.stop_stream();
+    if (on_outage)
+    {
+      on_outage(error);
+    }
+    if (not recover())
+    {
+      return;
+    }
+  }
+
+  m_device.stop_stream();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+supervisor::recover()
+{
+  auto delay = m_first_retry;
+  while (true)
+  {
+    auto ec = std::error_code{};
+    auto connected = true;
+    try
+    {
+      m_device.disconnect();
+      m_device.connect(m_host, m_port);
+    }
+    catch (const std::exception&)
+    {
+      connected = false;
+    }
+    if (connected)
+    {
+      configure(ec);
+    }
+
+    std::unique_lock<std::mutex> lock{m_mutex};
+    if (connected and not ec)
+    {
+      const auto recovery_time = std::chrono::steady_clock::now() - m_outage_start;
+      m_statistics.last_recovery_time = recovery_time;
+      m_statistics.max_recovery_time = std::max( m_statistics.max_recovery_time
+                                               , m_statistics.last_recovery_time);
+      m_statistics.outage_time += recovery_time;
+      ++m_statistics.recoveries;
+      m_link_lost = false;
+      return true;
+    }
+
+    ++m_statistics.failed_attempts;
+    if (m_wake_up.wait_for(lock, delay, [this]{ return not m_running; }))
+    {
+      return false;
+    }
+    delay = std::min(delay * 2, m_max_retry);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+supervisor::configure(std::error_code& ec)
+{
+  if (m_has_scan_configuration)
+  {
+    m_device.login(ec);
+    if (not ec)
+    {
+      m_device.set_scan_configuration(m_scan_configuration, ec);
+    }
+    if (ec)
+    {
+      return;
+    }
+  }
+  m_device.bring_up(m_scan_data_configuration, ec);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
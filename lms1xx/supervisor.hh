@@ -0,0 +1,180 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "lms1xx/lms1xx.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Link losses of a supervised device, and the time spent to recover from them
+struct recovery_statistics
+{
+  /// @brief Number of times the link was lost while streaming
+  std::uint64_t outages;
+
+  /// @brief Number of times streaming was resumed after an outage
+  std::uint64_t recoveries;
+
+  /// @brief Number of attempts to reconnect and reconfigure the device which failed
+  std::uint64_t failed_attempts;
+
+  /// @brief Time from the loss of the link to the resumption of streaming, for the last outage
+  std::chrono::nanoseconds last_recovery_time;
+
+  /// @brief Longest time from the loss of the link to the resumption of streaming
+  std::chrono::nanoseconds max_recovery_time;
+
+  /// @brief Time spent without streaming because of outages, including the current one
+  std::chrono::nanoseconds outage_time;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Stream scans of a device, reconnecting it automatically when the link is lost
+///
+/// The configurations applied through the supervisor are remembered. When the device stops
+/// sending telegrams or the connection fails, the supervisor reconnects with an exponential
+/// backoff, applies the configurations again, restarts continuous acquisition and resumes
+/// streaming with the same handler. Thus the application doesn't see outages, except as missing
+/// scans.
+class supervisor final
+{
+public:
+
+  /// @brief Can't copy-construct a supervisor
+  supervisor(const supervisor&) = delete;
+
+  /// @brief Can't copy a supervisor
+  supervisor& operator=(const supervisor&) = delete;
+
+  /// @brief Connect to a device
+  /// @param timeout Time without telegrams after which the link is considered lost, also the time
+  /// to wait for the reply to a command
+  /// @param first_retry Delay before the second attempt to reconnect, the first one is immediate
+  /// @param max_retry Delay between attempts to reconnect, which doubles up to this value
+  /// @param p Protocol used for commands and scans
+  supervisor( const std::string& host, const std::string& port
+            , const boost::posix_time::time_duration& timeout = boost::posix_time::millisec{500}
+            , std::chrono::milliseconds first_retry = std::chrono::milliseconds{10}
+            , std::chrono::milliseconds max_retry = std::chrono::milliseconds{1000}
+            , protocol p = protocol::cola_a);
+
+  /// @brief Destructor
+  ///
+  /// Stop streaming.
+  ~supervisor();
+
+  /// @brief The supervised device
+  ///
+  /// Can be used to send commands while the supervisor is stopped. Configurations applied
+  /// directly to the device are not replayed after an outage.
+  LMS1xx&
+  device()
+  noexcept;
+
+  /// @brief Set the scan configuration, and apply it again after each outage
+  /// @note Can't be called while the supervisor is started
+  void
+  set_scan_configuration(const scan_configuration& cfg);
+
+  /// @brief Bring the device up and stream its scans until stop() is called
+  /// @param cfg The scan data configuration, applied again after each outage
+  /// @param handler Called for each scan, from the I/O thread of the device
+  /// @param on_outage Called from the thread of the supervisor when the link is lost, before
+  /// reconnecting
+  /// @throw The errors of LMS1xx::bring_up(), the first bring-up isn't retried
+  void
+  start( const scan_data_configuration& cfg, scan_handler handler
+       , error_handler on_outage = nullptr);
+
+  /// @brief Stop streaming, and stop reconnecting if the link is lost
+  void
+  stop();
+
+  /// @brief Tell if the supervisor is started
+  bool
+  running()
+  const;
+
+  /// @brief Get the outages and the recovery times since the supervisor was constructed
+  recovery_statistics
+  get_recovery_statistics()
+  const;
+
+private:
+
+  /// @brief Supervise the device, until stop() is called
+  void
+  supervise(scan_handler handler, error_handler on_outage);
+
+  /// @brief Reconnect and reconfigure the device until it succeeds or stop() is called
+  /// @return false if stop() was called
+  bool
+  recover();
+
+  /// @brief Apply the remembered configurations and start continuous acquisition
+  void
+  configure(std::error_code& ec);
+
+private:
+
+  /// @brief The supervised device
+  LMS1xx m_device;
+
+  /// @brief Host name or IP address of the device
+  const std::string m_host;
+
+  /// @brief Port of the device
+  const std::string m_port;
+
+  /// @brief Initial delay between attempts to reconnect
+  const std::chrono::milliseconds m_first_retry;
+
+  /// @brief Maximal delay between attempts to reconnect
+  const std::chrono::milliseconds m_max_retry;
+
+  /// @brief True if a scan configuration has been set
+  bool m_has_scan_configuration;
+
+  /// @brief The scan configuration to apply after an outage
+  scan_configuration m_scan_configuration;
+
+  /// @brief The scan data configuration to apply after an outage
+  scan_data_configuration m_scan_data_configuration;
+
+  /// @brief Protect the following members
+  mutable std::mutex m_mutex;
+
+  /// @brief Wake up the thread of the supervisor
+  std::condition_variable m_wake_up;
+
+  /// @brief True while the supervisor is started
+  bool m_running;
+
+  /// @brief True from the loss of the link until streaming is resumed
+  bool m_link_lost;
+
+  /// @brief The error which stopped the stream of the device
+  std::exception_ptr m_error;
+
+  /// @brief When the current outage started
+  std::chrono::steady_clock::time_point m_outage_start;
+
+  /// @brief Outages and recoveries
+  recovery_statistics m_statistics;
+
+  /// @brief Wait for outages and recover from them
+  std::thread m_thread;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,121 @@
+#include <algorithm> // min
+#include <cstring>   // memmove
+
+#include "lms1xx/buffer_pool.hh"
+#include "lms1xx/telegram_buffer.hh"
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+telegram_buffer::telegram_buffer(std::size_t capacity, buffer_pool* pool)
+  : m_pool{pool}
+  , m_capacity{pool ? pool->block_size() : capacity}
+  , m_own{}
+  , m_storage{nullptr}
+  , m_begin{0}
+  , m_end{0}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+telegram_buffer::~telegram_buffer()
+{
+  release();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+const char*
+telegram_buffer::data()
+const noexcept
+{
+  return m_storage + m_begin;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+telegram_buffer::size()
+const noexcept
+{
+  return m_end - m_begin;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::size_t
+telegram_buffer::max_size()
+const noexcept
+{
+  return m_capacity;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+boost::asio::mutable_buffers_1
+telegram_buffer::prepare(std::size_t n)
+{
+  if (m_storage == nullptr)
+  {
+    if (m_pool)
+    {
+      m_storage = m_pool->acquire();
+    }
+    else
+    {
+      m_own.reset(new char[m_capacity]);
+      m_storage = m_own.get();
+    }
+  }
+
+  if (m_capacity - m_end < n and m_begin != 0)
+  {
+    // Move the beginning of the next telegram to the front.
+    std::memmove(m_storage, m_storage + m_begin, size());
+    m_end -= m_begin;
+    m_begin = 0;
+  }
+  return boost::asio::buffer(m_storage + m_end, std::min(n, m_capacity - m_end));
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telegram_buffer::commit(std::size_t n)
+noexcept
+{
+  m_end += std::min(n, m_capacity - m_end);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telegram_buffer::consume(std::size_t n)
+noexcept
+{
+  m_begin += std::min(n, size());
+  if (m_begin == m_end)
+  {
+    m_begin = 0;
+    m_end = 0;
+    release();
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telegram_buffer::release()
+noexcept
+{
+  if (m_pool and m_storage)
+  {
+    m_pool->release(m_storage);
+    m_storage = nullptr;
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+
+#include <boost/asio/buffer.hpp>
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+class buffer_pool;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A contiguous buffer of received bytes, with an upper bound on its size
+///
+/// Bytes are appended with prepare() and commit(), and removed from the front with consume().
+/// Storage is only obtained at the first prepare(). When it comes from a buffer_pool, it is given
+/// back as soon as the buffer becomes empty, thus idle devices don't hold any memory.
+class telegram_buffer final
+{
+public:
+
+  /// @brief Can't copy-construct a telegram_buffer
+  telegram_buffer(const telegram_buffer&) = delete;
+
+  /// @brief Can't copy a telegram_buffer
+  telegram_buffer& operator=(const telegram_buffer&) = delete;
+
+  /// @brief Constructor
+  /// @param capacity The maximal number of bytes, when storage doesn't come from a pool
+  /// @param pool Where to get storage from, nullptr to allocate it once and keep it
+  telegram_buffer(std::size_t capacity, buffer_pool* pool);
+
+  /// @brief Destructor
+  ~telegram_buffer();
+
+  /// @brief The first received byte
+  const char*
+  data()
+  const noexcept;
+
+  /// @brief Number of received bytes
+  std::size_t
+  size()
+  const noexcept;
+
+  /// @brief The maximal number of bytes
+  std::size_t
+  max_size()
+  const noexcept;
+
+  /// @brief Get space for at most n more bytes
+  ///
+  /// The returned space may be smaller than n, or empty if the buffer is full.
+  boost::asio::mutable_buffers_1
+  prepare(std::size_t n);
+
+  /// @brief Append n bytes written to the space returned by prepare()
+  void
+  commit(std::size_t n)
+  noexcept;
+
+  /// @brief Remove n bytes from the front
+  void
+  consume(std::size_t n)
+  noexcept;
+
+private:
+
+  /// @brief Give storage back to the pool, if any
+  void
+  release()
+  noexcept;
+
+private:
+
+  /// @brief Where to get storage from
+  buffer_pool* m_pool;
+
+  /// @brief The maximal number of bytes
+  std::size_t m_capacity;
+
+  /// @brief Storage allocated when there is no pool
+  std::unique_ptr<char[]> m_own;
+
+  /// @brief The current storage, nullptr until the first prepare()
+  char* m_storage;
+
+  /// @brief Offset of the first received byte
+  std::size_t m_begin;
+
+  /// @brief Offset after the last received byte
+  std::size_t m_end;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,245 @@
+#include "lms1xx/lms1xx.hh"
+#include "lms1xx/telemetry.hh"
+
+namespace lms1xx {
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The bin of a value
+std::size_t
+bin(std::uint64_t value)
+noexcept
+{
+  if (value == 0)
+  {
+    return 0;
+  }
+  const auto b = static_cast<std::size_t>(64 - __builtin_clzll(value));
+  return b < histogram_bins ? b : histogram_bins - 1;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Microseconds elapsed since a timestamp of the device, 0 if it is in the future
+std::uint64_t
+latency_us(const scan_timestamp& t)
+noexcept
+{
+  const auto scan_us = microseconds_since_epoch(t);
+  const auto now_us = std::chrono::duration_cast<std::chrono::microseconds>(
+                        std::chrono::system_clock::now().time_since_epoch()).count();
+  return now_us > scan_us ? static_cast<std::uint64_t>(now_us - scan_us) : 0;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+double
+histogram_snapshot::mean()
+const noexcept
+{
+  return count == 0 ? 0 : static_cast<double>(sum) / static_cast<double>(count);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+std::uint64_t
+histogram_snapshot::percentile(double p)
+const noexcept
+{
+  const auto rank = static_cast<double>(count) * p / 100.0;
+  auto seen = std::uint64_t{0};
+  for (auto i = std::size_t{0}; i < histogram_bins - 1; ++i)
+  {
+    seen += bins[i];
+    if (seen > 0 and static_cast<double>(seen) >= rank)
+    {
+      const auto upper = i == 0 ? 0 : (std::uint64_t{1} << i) - 1;
+      return upper < max ? upper : max;
+    }
+  }
+  return max;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+histogram::histogram()
+noexcept
+  : m_count{0}
+  , m_sum{0}
+  , m_max{0}
+{
+  for (auto& b : m_bins)
+  {
+    b.store(0, std::memory_order_relaxed);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+histogram::record(std::uint64_t value)
+noexcept
+{
+  m_bins[bin(value)].fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(value, std::memory_order_relaxed);
+  auto max = m_max.load(std::memory_order_relaxed);
+  while (value > max and not m_max.compare_exchange_weak(max, value, std::memory_order_relaxed))
+  {}
+  m_count.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+histogram_snapshot
+histogram::snapshot()
+const noexcept
+{
+  auto s = histogram_snapshot{};
+  s.count = m_count.load(std::memory_order_relaxed);
+  s.sum = m_sum.load(std::memory_order_relaxed);
+  s.max = m_max.load(std::memory_order_relaxed);
+  for (auto i = std::size_t{0}; i < histogram_bins; ++i)
+  {
+    s.bins[i] = m_bins[i].load(std::memory_order_relaxed);
+  }
+  return s;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+histogram::reset()
+noexcept
+{
+  m_count.store(0, std::memory_order_relaxed);
+  m_sum.store(0, std::memory_order_relaxed);
+  m_max.store(0, std::memory_order_relaxed);
+  for (auto& b : m_bins)
+  {
+    b.store(0, std::memory_order_relaxed);
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+telemetry::telemetry()
+noexcept
+  : m_scans{0}
+  , m_lost_scans{0}
+  , m_framing_errors{0}
+  , m_bytes_received{0}
+  , m_cpu_time{0}
+  , m_counter_gaps{}
+  , m_parse_time{}
+  , m_latency{}
+  , m_has_last_counter{false}
+  , m_last_counter{0}
+{}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telemetry::received(std::size_t bytes)
+noexcept
+{
+  m_bytes_received.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telemetry::framing_error()
+noexcept
+{
+  m_framing_errors.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telemetry::scan(const scan_header& header, std::chrono::nanoseconds parse_time)
+noexcept
+{
+  m_scans.fetch_add(1, std::memory_order_relaxed);
+  m_parse_time.record(static_cast<std::uint64_t>(parse_time.count()));
+
+  if (m_has_last_counter)
+  {
+    const auto lost = static_cast<std::uint16_t>(header.message_counter - m_last_counter - 1);
+    // A counter going back by a small amount is a duplicate or a restart of the device.
+    if (lost != 0 and lost < 0x8000)
+    {
+      m_lost_scans.fetch_add(lost, std::memory_order_relaxed);
+      m_counter_gaps.record(lost);
+    }
+  }
+  m_has_last_counter = true;
+  m_last_counter = header.message_counter;
+
+  if (header.has_timestamp)
+  {
+    m_latency.record(latency_us(header.timestamp));
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telemetry::cpu_time(std::chrono::nanoseconds time)
+noexcept
+{
+  m_cpu_time.fetch_add(static_cast<std::uint64_t>(time.count()), std::memory_order_relaxed);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telemetry::restart()
+noexcept
+{
+  m_has_last_counter = false;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+statistics
+telemetry::snapshot()
+const noexcept
+{
+  auto s = statistics{};
+  s.scans = m_scans.load(std::memory_order_relaxed);
+  s.lost_scans = m_lost_scans.load(std::memory_order_relaxed);
+  s.framing_errors = m_framing_errors.load(std::memory_order_relaxed);
+  s.bytes_received = m_bytes_received.load(std::memory_order_relaxed);
+  s.cpu_time = m_cpu_time.load(std::memory_order_relaxed);
+  s.counter_gaps = m_counter_gaps.snapshot();
+  s.parse_time = m_parse_time.snapshot();
+  s.latency = m_latency.snapshot();
+  return s;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+void
+telemetry::reset()
+noexcept
+{
+  m_scans.store(0, std::memory_order_relaxed);
+  m_lost_scans.store(0, std::memory_order_relaxed);
+  m_framing_errors.store(0, std::memory_order_relaxed);
+  m_bytes_received.store(0, std::memory_order_relaxed);
+  m_cpu_time.store(0, std::memory_order_relaxed);
+  m_counter_gaps.reset();
+  m_parse_time.reset();
+  m_latency.reset();
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace lms1xx {
+
+/*------------------------------------------------------------------------------------------------*/
+
+struct scan_header;
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Number of bins of a histogram
+static constexpr auto histogram_bins = std::size_t{32};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief The values recorded by a histogram at some point in time
+struct histogram_snapshot
+{
+  /// @brief Number of recorded values
+  std::uint64_t count;
+
+  /// @brief Sum of recorded values
+  std::uint64_t sum;
+
+  /// @brief Greatest recorded value
+  std::uint64_t max;
+
+  /// @brief Number of recorded values in each bin
+  ///
+  /// Bin 0 counts zeros, bin i counts values from 2^(i-1) to 2^i - 1. The last bin also counts
+  /// all greater values.
+  std::uint64_t bins[histogram_bins];
+
+  /// @brief The average of recorded values, 0 if there are none
+  double
+  mean()
+  const noexcept;
+
+  /// @brief An upper bound of the given percentile of recorded values
+  /// @param p From 0 to 100
+  ///
+  /// The result is the upper bound of the bin which contains the percentile, or max if it is
+  /// lower.
+  std::uint64_t
+  percentile(double p)
+  const noexcept;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A histogram of powers of two, which can be read while values are recorded
+///
+/// Values may be recorded from several threads, a snapshot taken meanwhile may then be slightly
+/// inconsistent.
+class histogram final
+{
+public:
+
+  /// @brief Constructor
+  histogram()
+  noexcept;
+
+  /// @brief Record a value
+  void
+  record(std::uint64_t value)
+  noexcept;
+
+  /// @brief Get the recorded values
+  histogram_snapshot
+  snapshot()
+  const noexcept;
+
+  /// @brief Forget all recorded values
+  void
+  reset()
+  noexcept;
+
+private:
+
+  /// @brief Number of recorded values
+  std::atomic<std::uint64_t> m_count;
+
+  /// @brief Sum of recorded values
+  std::atomic<std::uint64_t> m_sum;
+
+  /// @brief Greatest recorded value
+  std::atomic<std::uint64_t> m_max;
+
+  /// @brief Number of recorded values in each bin
+  std::atomic<std::uint64_t> m_bins[histogram_bins];
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Statistics about the scans received from a device
+struct statistics
+{
+  /// @brief Number of decoded scans
+  std::uint64_t scans;
+
+  /// @brief Number of scans sent by the device, but never decoded
+  ///
+  /// Detected from the gaps of the message counter of scan headers.
+  std::uint64_t lost_scans;
+
+  /// @brief Number of invalid telegrams and of skipped garbage bytes sequences
+  std::uint64_t framing_errors;
+
+  /// @brief Number of bytes received from the device
+  std::uint64_t bytes_received;
+
+  /// @brief CPU time spent to receive and decode scans while streaming, including scan handlers,
+  /// in nanoseconds
+  std::uint64_t cpu_time;
+
+  /// @brief Number of scans lost at each gap of the message counter
+  histogram_snapshot counter_gaps;
+
+  /// @brief Time spent to decode each scan, in nanoseconds
+  histogram_snapshot parse_time;
+
+  /// @brief Time between the timestamp of each scan and its decoding, in microseconds
+  ///
+  /// Only scans with a timestamp are recorded, and the clock of the device should be synchronized
+  /// with the one of the host. Scans timestamped in the future are recorded with no latency.
+  histogram_snapshot latency;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Collect statistics about the scans received from a device
+///
+/// Statistics are recorded by the thread which reads from the device, and can be read from any
+/// other thread.
+class telemetry final
+{
+public:
+
+  /// @brief Can't copy-construct a telemetry
+  telemetry(const telemetry&) = delete;
+
+  /// @brief Can't copy a telemetry
+  telemetry& operator=(const telemetry&) = delete;
+
+  /// @brief Constructor
+  telemetry()
+  noexcept;
+
+  /// @brief Record bytes received from the device
+  void
+  received(std::size_t bytes)
+  noexcept;
+
+  /// @brief Record an invalid telegram, or garbage bytes between telegrams
+  void
+  framing_error()
+  noexcept;
+
+  /// @brief Record a decoded scan
+  /// @param header The header of the scan
+  /// @param parse_time The time spent to decode the scan
+  void
+  scan(const scan_header& header, std::chrono::nanoseconds parse_time)
+  noexcept;
+
+  /// @brief Record CPU time spent by the thread which reads from the device
+  void
+  cpu_time(std::chrono::nanoseconds time)
+  noexcept;
+
+  /// @brief Forget the message counter of the last scan, when the connection is restarted
+  void
+  restart()
+  noexcept;
+
+  /// @brief Get all statistics
+  statistics
+  snapshot()
+  const noexcept;
+
+  /// @brief Reset all statistics
+  void
+  reset()
+  noexcept;
+
+private:
+
+  /// @brief Number of decoded scans
+  std::atomic<std::uint64_t> m_scans;
+
+  /// @brief Number of lost scans
+  std::atomic<std::uint64_t> m_lost_scans;
+
+  /// @brief Number of framing errors
+  std::atomic<std::uint64_t> m_framing_errors;
+
+  /// @brief Number of bytes received
+  std::atomic<std::uint64_t> m_bytes_received;
+
+  /// @brief CPU time in nanoseconds
+  std::atomic<std::uint64_t> m_cpu_time;
+
+  /// @brief Number of scans lost at each gap
+  histogram m_counter_gaps;
+
+  /// @brief Decoding times in nanoseconds
+  histogram m_parse_time;
+
+  /// @brief Latencies in microseconds
+  histogram m_latency;
+
+  /// @brief True if m_last_counter has been set since the last restart
+  bool m_has_last_counter;
+
+  /// @brief The message counter of the last scan
+  std::uint16_t m_last_counter;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace lms1xx
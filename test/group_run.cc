@@ -0,0 +1,60 @@
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "lms1xx/device_group.hh"
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 4)
+  {
+    std::cerr << "Usage: " << argv[0] << " nb_threads host port [port...]\n";
+    return 1;
+  }
+
+  const auto nb_threads = static_cast<std::size_t>(std::atoi(argv[1]));
+  const auto host = std::string{argv[2]};
+
+  try
+  {
+    lms1xx::device_group group{nb_threads};
+    for (auto i = 3; i < argc; ++i)
+    {
+      auto& laser = group.add(host, argv[i]);
+      laser.scan_continous(true);
+    }
+
+    std::atomic<std::size_t> errors{0};
+    group.start( [](std::size_t, const lms1xx::scan_data&){}
+               , [&](std::size_t device, std::exception_ptr)
+                 {
+                   std::cerr << "Device " << device << " stopped\n";
+                   ++errors;
+                 });
+
+    while (errors != group.size())
+    {
+      std::this_thread::sleep_for(std::chrono::seconds{1});
+      auto total = 0.0;
+      auto cpu = 0.0;
+      for (const auto& l : group.load())
+      {
+        total += l.scans_per_second;
+        cpu += l.cpu_load;
+      }
+      std::cout << std::fixed << std::setprecision(0) << total << " scans/s, "
+                << std::setprecision(2) << (cpu * 100) << "% CPU, "
+                << group.pool().allocated() << " buffers\n";
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "An error happened: " << e.what() << '\n';
+    return 1;
+  }
+}
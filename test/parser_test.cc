@@ -0,0 +1,737 @@
+#include <algorithm> // equal, min
+#include <cstdint>
+#include <cstdio> // sscanf
+#include <cstdlib> // strtol
+#include <cstring> // strcmp, strlen, strtok
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include "lms1xx/compact_scan.hh"
+#include "lms1xx/hex.hh"
+#include "lms1xx/lms1xx.hh"
+#include "lms1xx/parser.hh"
+#include "lms1xx/scan_view.hh"
+#include "lms1xx/sector_reduction.hh"
+
+#include "bench/corpus.hh"
+
+/// @file
+/// Check the decoding of LMDscandata telegrams against the strtok parser which get_data() used
+/// before the parser of the library, on the telegrams of bench/corpus in CoLa-A and CoLa-B.
+
+/*------------------------------------------------------------------------------------------------*/
+
+namespace /* unnamed */ {
+
+using corpus::telegram;
+
+/*------------------------------------------------------------------------------------------------*/
+
+const lms1xx::channel channels[] = { lms1xx::channel::dist1, lms1xx::channel::dist2
+                                   , lms1xx::channel::rssi1, lms1xx::channel::rssi2};
+
+/// @brief The MeasuredDataContent field of each channel
+const char* const contents[] = {"DIST1", "DIST2", "RSSI1", "RSSI2"};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Throw if a condition doesn't hold
+void
+check(bool condition, const std::string& what)
+{
+  if (not condition)
+  {
+    throw std::runtime_error{what};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief A telegram decoded by the strtok parser
+struct reference
+{
+  /// @brief The samples; the header isn't decoded
+  lms1xx::scan_data data;
+
+  /// @brief Angle of the first sample of each channel, in 1/10000 degree
+  int start_angle[lms1xx::compact_scan::nb_channels];
+
+  /// @brief Angular step of each channel, in 1/10000 degree
+  int step[lms1xx::compact_scan::nb_channels];
+
+  /// @brief Offset of the end of the last sample in the telegram
+  std::size_t channels_end;
+};
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode a CoLa-A telegram as get_data() did before the parser of the library
+///
+/// Angles of channels and the end of the last sample are also kept, the rest is unchanged.
+std::unique_ptr<reference>
+decode_reference(const std::string& bytes)
+{
+  auto res = std::unique_ptr<reference>{new reference{}};
+  auto& data = res->data;
+  auto buf = std::vector<char>(bytes.begin(), bytes.end());
+  buf[buf.size() - 1] = '\0';
+
+  char* tok;
+  strtok(buf.data(), " "); // Type of command
+  for (auto i = 0; i < 17; ++i)
+  {
+    strtok(nullptr, " "); // Command, then header
+  }
+  tok = strtok(nullptr, " "); // NumberEncoders
+  int nb_encoders;
+  sscanf(tok, "%d", &nb_encoders);
+  for (auto i = 0; i < nb_encoders; ++i)
+  {
+    strtok(nullptr, " "); // EncoderPosition
+    strtok(nullptr, " "); // EncoderSpeed
+  }
+
+  for (auto bits = 0; bits < 2; ++bits) // 16-bit, then 8-bit channels
+  {
+    tok = strtok(nullptr, " "); // NumberChannels16Bit or NumberChannels8Bit
+    int nb_channels;
+    sscanf(tok, "%d", &nb_channels);
+    for (auto i = 0; i < nb_channels; ++i)
+    {
+      auto type = -1; // 0 DIST1 1 DIST2 2 RSSI1 3 RSSI2
+      char content[6];
+      tok = strtok(nullptr, " "); // MeasuredDataContent
+      sscanf(tok, "%5s", content);
+      for (auto c = 0; c < 4; ++c)
+      {
+        if (not std::strcmp(content, contents[c]))
+        {
+          type = c;
+        }
+      }
+      strtok(nullptr, " "); // ScalingFactor
+      strtok(nullptr, " "); // ScalingOffset
+      tok = strtok(nullptr, " "); // Starting angle
+      const auto start_angle = static_cast<std::int32_t>(std::strtoul(tok, nullptr, 16));
+      tok = strtok(nullptr, " "); // Angular step width
+      const auto step = static_cast<int>(std::strtol(tok, nullptr, 16));
+      tok = strtok(nullptr, " "); // NumberData
+      int nb_data;
+      sscanf(tok, "%X", &nb_data);
+
+      auto samples = static_cast<std::uint16_t*>(nullptr);
+      switch (type)
+      {
+        case 0: data.dist_len1 = nb_data; samples = data.dist1; break;
+        case 1: data.dist_len2 = nb_data; samples = data.dist2; break;
+        case 2: data.rssi_len1 = nb_data; samples = data.rssi1; break;
+        case 3: data.rssi_len2 = nb_data; samples = data.rssi2; break;
+      }
+      if (type != -1)
+      {
+        res->start_angle[type] = start_angle;
+        res->step[type] = step;
+      }
+      for (auto j = 0; j < nb_data; ++j)
+      {
+        tok = strtok(nullptr, " "); // data
+        const auto dat = std::strtol(tok, nullptr, 16);
+        if (samples != nullptr)
+        {
+          samples[j] = static_cast<std::uint16_t>(dat);
+        }
+        res->channels_end = static_cast<std::size_t>(tok - buf.data()) + std::strlen(tok);
+      }
+    }
+  }
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+lms1xx::channel_span
+get(const lms1xx::scan_data& data, lms1xx::channel c)
+{
+  switch (c)
+  {
+    case lms1xx::channel::dist1: return {data.dist1, static_cast<std::size_t>(data.dist_len1)};
+    case lms1xx::channel::dist2: return {data.dist2, static_cast<std::size_t>(data.dist_len2)};
+    case lms1xx::channel::rssi1: return {data.rssi1, static_cast<std::size_t>(data.rssi_len1)};
+    default:                     return {data.rssi2, static_cast<std::size_t>(data.rssi_len2)};
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+lms1xx::channel_span
+get(const lms1xx::compact_scan& data, lms1xx::channel c)
+{
+  return data.get(c);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+bool
+same(const lms1xx::channel_span& lhs, const lms1xx::channel_span& rhs)
+{
+  return lhs.size == rhs.size and std::equal(lhs.data, lhs.data + lhs.size, rhs.data);
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check that all channels of a decoded scan have the samples of the reference
+template <typename Scan>
+void
+check_samples(const reference& expected, const Scan& data, const std::string& what)
+{
+  for (const auto c : channels)
+  {
+    check(same(get(expected.data, c), get(data, c)), what + ": other samples");
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode fields as the scalar kernel of hex::decode_fields()
+std::size_t
+reference_decode_fields(const char*& pos, const char* last, std::uint16_t* out, std::size_t n)
+{
+  const auto digit = [](char c)
+  {
+    return c >= '0' and c <= '9' ? c - '0'
+         : c >= 'A' and c <= 'F' ? c - 'A' + 10
+         : c >= 'a' and c <= 'f' ? c - 'a' + 10
+         : -1;
+  };
+  auto decoded = std::size_t{0};
+  auto p = pos;
+  while (decoded != n)
+  {
+    while (p != last and *p == ' ')
+    {
+      ++p;
+    }
+    auto value = 0u;
+    auto len = 0;
+    for (; p != last and digit(*p) != -1 and len <= 4; ++p, ++len)
+    {
+      value = value << 4 | static_cast<unsigned>(digit(*p));
+    }
+    if (len == 0 or len > 4 or p == last or *p != ' ')
+    {
+      break;
+    }
+    out[decoded++] = static_cast<std::uint16_t>(value);
+    pos = ++p;
+  }
+  return decoded;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Skip fields as the scalar kernel of hex::skip_fields()
+std::size_t
+reference_skip_fields(const char*& pos, const char* last, std::size_t n)
+{
+  auto skipped = std::size_t{0};
+  auto p = pos;
+  while (skipped != n)
+  {
+    while (p != last and *p == ' ')
+    {
+      ++p;
+    }
+    const auto field = p;
+    while (p != last and *p != ' ' and *p != '\x03')
+    {
+      ++p;
+    }
+    if (p == field or p == last or *p != ' ')
+    {
+      break;
+    }
+    ++skipped;
+    pos = ++p;
+  }
+  return skipped;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Skip the spaces after a position
+const char*
+skip_spaces(const char* pos, const char* last)
+{
+  while (pos != last and *pos == ' ')
+  {
+    ++pos;
+  }
+  return pos;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check the SIMD kernels of hex::decode_fields() and hex::skip_fields() against the
+/// scalar ones, on random fields
+///
+/// Fields of 1 to 4 digits are separated by 1 or 2 spaces, some of them are invalid, and the
+/// fields start at all the positions of 16 and 32 byte blocks. The last fields are followed by
+/// the end of the telegram or by the end of the bytes, where the kernels hand over to scalar
+/// code. SIMD kernels may stop after the spaces which follow the last field, rather than after the
+/// first one.
+void
+check_kernels()
+{
+  const auto digits = std::string{"0123456789ABCDEFabcdef"};
+  auto rng = std::mt19937{42};
+  const auto draw = [&](unsigned n)
+  {
+    return static_cast<unsigned>(rng() % n);
+  };
+
+  for (auto round = 0; round < 20000; ++round)
+  {
+    const auto offset = draw(64);
+    auto bytes = std::string(offset, 'A');
+    const auto nb_fields = draw(80);
+    for (auto i = 0u; i < nb_fields; ++i)
+    {
+      const auto kind = draw(100);
+      if (kind == 0) // 5 digits
+      {
+        bytes += "12345";
+      }
+      else if (kind == 1) // Not a number
+      {
+        bytes += "DIST1";
+      }
+      else
+      {
+        for (auto len = 1 + draw(4); len > 0; --len)
+        {
+          bytes += digits[draw(static_cast<unsigned>(digits.size()))];
+        }
+      }
+      bytes += draw(8) == 0 ? "  " : " ";
+    }
+    if (draw(2) == 0)
+    {
+      bytes += "0\x03";
+    }
+
+    const auto first = bytes.data() + offset;
+    const auto last = bytes.data() + bytes.size();
+    const auto n = 1 + draw(100);
+    const auto what = std::string{"hex kernel "} + lms1xx::hex::kernel_name() + " on \""
+                    + std::string{first, last} + "\"";
+
+    auto expected = std::vector<std::uint16_t>(n);
+    auto decoded = std::vector<std::uint16_t>(n);
+    auto expected_pos = first;
+    auto pos = first;
+    const auto nb_expected = reference_decode_fields(expected_pos, last, expected.data(), n);
+    const auto nb_decoded = lms1xx::hex::decode_fields(pos, last, decoded.data(), n);
+    check( nb_decoded == nb_expected and skip_spaces(pos, last) == skip_spaces(expected_pos, last)
+         and std::equal(expected.begin(), expected.begin() + nb_expected, decoded.begin())
+         , what + " decodes fields wrongly");
+
+    expected_pos = first;
+    pos = first;
+    check(    lms1xx::hex::skip_fields(pos, last, n) == reference_skip_fields(expected_pos, last, n)
+          and skip_spaces(pos, last) == skip_spaces(expected_pos, last)
+         , what + " skips fields wrongly");
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check the parsers against the strtok parser
+void
+check_parsers(const telegram& t, const reference& expected)
+{
+  for (const auto bytes : {&t.bytes, &t.binary})
+  {
+    const auto first = bytes->data();
+    const auto last = first + bytes->size();
+    const auto what = t.name + (bytes == &t.binary ? " (CoLa-B)" : " (CoLa-A)");
+
+    auto data = std::unique_ptr<lms1xx::scan_data>{new lms1xx::scan_data{}};
+    lms1xx::parse_scan_data(first, last, *data);
+    check_samples(expected, *data, what + " parse_scan_data");
+
+    auto compact = lms1xx::compact_scan{lms1xx::max_samples};
+    lms1xx::parse_scan_data(first, last, compact);
+    check_samples(expected, compact, what + " parse_scan_data, compact_scan");
+
+    auto ec = std::error_code{};
+    lms1xx::parse_scan_data(first, last, compact, {}, ec);
+    check(not ec, what + " parse_scan_data failed");
+    check_samples(expected, compact, what + " parse_scan_data, error_code");
+
+    for (const auto p : {lms1xx::protocol::cola_a, lms1xx::protocol::cola_b})
+    {
+      const auto parser = lms1xx::layout_parser{t.configuration, p};
+      parser.parse(first, last, *data);
+      check_samples(expected, *data, what + " layout_parser");
+      parser.parse(first, last, compact, ec);
+      check(not ec, what + " layout_parser failed");
+      check_samples(expected, compact, what + " layout_parser, compact_scan");
+    }
+
+    auto view = lms1xx::scan_view{};
+    view.reset(first, last);
+    for (const auto c : channels)
+    {
+      check(view.size(c) == get(expected.data, c).size, what + " scan_view: other size");
+      check(same(view.get(c), get(expected.data, c)), what + " scan_view: other samples");
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check a layout parser selected for the layout of another telegram
+///
+/// Telegrams of another layout are decoded by the generic parser.
+void
+check_other_layout(const telegram& t, const reference& expected, const telegram& other)
+{
+  for (const auto bytes : {&t.bytes, &t.binary})
+  {
+    for (const auto p : {lms1xx::protocol::cola_a, lms1xx::protocol::cola_b})
+    {
+      const auto parser = lms1xx::layout_parser{other.configuration, p};
+      auto compact = lms1xx::compact_scan{lms1xx::max_samples};
+      auto ec = std::error_code{};
+      parser.parse(bytes->data(), bytes->data() + bytes->size(), compact, ec);
+      check(not ec, t.name + " layout_parser of " + other.name + " failed");
+      check_samples(expected, compact, t.name + " layout_parser of " + other.name);
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check filters against a selection of the samples of the strtok parser
+void
+check_filters(const telegram& t, const reference& expected)
+{
+  const auto dist1 = lms1xx::channel_bit(lms1xx::channel::dist1);
+  const auto rssi1 = lms1xx::channel_bit(lms1xx::channel::rssi1);
+  const auto all = 0xFu;
+  const lms1xx::scan_filter filters[]
+    = { {0, 900000, 2, dist1}
+      , {-450000, 2250000, 1, all}
+      , {-450000, 2250000, 0, all}
+      , {100001, 100000, 1, dist1 | rssi1}
+      , {-100000000, 100000000, 7, all}
+      , {3000000, 3100000, 1, all}
+      , {500000, 400000, 1, all}
+      , {0, 0, 3, all}};
+
+  for (const auto& filter : filters)
+  {
+    for (const auto bytes : {&t.bytes, &t.binary})
+    {
+      auto compact = lms1xx::compact_scan{lms1xx::max_samples};
+      const auto first = bytes->data();
+      lms1xx::parse_scan_data(first, first + bytes->size(), compact, {&filter, nullptr});
+      for (const auto c : channels)
+      {
+        const auto i = static_cast<std::size_t>(c);
+        const auto all_samples = get(expected.data, c);
+        auto kept = std::vector<std::uint16_t>{};
+        if ((filter.channels & lms1xx::channel_bit(c)) != 0)
+        {
+          const auto stride = filter.stride == 0 ? 1u : filter.stride;
+          auto first = -1;
+          for (auto j = 0; j < static_cast<int>(all_samples.size); ++j)
+          {
+            const auto angle = static_cast<long>(expected.start_angle[i])
+                             + static_cast<long>(expected.step[i]) * j;
+            if (angle < filter.start_angle or angle > filter.stop_angle)
+            {
+              continue;
+            }
+            if (first == -1)
+            {
+              first = j;
+            }
+            if ((j - first) % static_cast<int>(stride) == 0)
+            {
+              kept.push_back(all_samples.data[j]);
+            }
+          }
+        }
+        check( same(compact.get(c), {kept.data(), kept.size()})
+             , t.name + " filter [" + std::to_string(filter.start_angle) + ", "
+               + std::to_string(filter.stop_angle) + "] / " + std::to_string(filter.stride)
+               + ": other samples");
+      }
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check sector reductions against the closest echoes of the samples of the strtok parser
+void
+check_sectors(const telegram& t, const reference& expected)
+{
+  const auto sectors
+    = std::vector<lms1xx::sector>{ {-450000, -150001}, {0, 900000}, {100000, 200000}
+                                 , {2200000, 2300000}, {-900000, -500000}, {450000, 450000}};
+  auto reported = std::vector<lms1xx::sector_minimum>{};
+  lms1xx::sector_reduction reduction
+    { sectors
+    , [&](const lms1xx::scan_header&, const lms1xx::sector_minimum& m){reported.push_back(m);}};
+
+  for (const auto bytes : {&t.bytes, &t.binary})
+  {
+    reported.clear();
+    auto compact = lms1xx::compact_scan{lms1xx::max_samples};
+    const auto first = bytes->data();
+    lms1xx::parse_scan_data(first, first + bytes->size(), compact, {nullptr, &reduction});
+    check_samples(expected, compact, t.name + " sector_reduction");
+    check(reported.size() == sectors.size(), t.name + " sector_reduction: missing sectors");
+
+    const auto dist1 = get(expected.data, lms1xx::channel::dist1);
+    const auto start = static_cast<long>(expected.start_angle[0]);
+    const auto step = static_cast<long>(expected.step[0]);
+    for (auto k = std::size_t{0}; k < reported.size(); ++k)
+    {
+      const auto& m = reported[k];
+      const auto& s = sectors[m.sector];
+      if (k != 0)
+      {
+        check( sectors[reported[k - 1].sector].stop_angle <= s.stop_angle
+             , t.name + " sector_reduction: sectors not reported as they are complete");
+      }
+      auto distance = 0u;
+      auto sample = std::size_t{0};
+      for (auto j = std::size_t{0}; j < dist1.size; ++j)
+      {
+        const auto angle = start + step * static_cast<long>(j);
+        if (    angle >= s.start_angle and angle <= s.stop_angle and dist1.data[j] != 0
+            and (distance == 0 or dist1.data[j] < distance))
+        {
+          distance = dist1.data[j];
+          sample = j;
+        }
+      }
+      check(    m.distance == distance
+            and (    distance == 0
+                 or (m.sample == sample and m.angle == start + step * static_cast<long>(sample)))
+           , t.name + " sector_reduction: other closest echo in sector "
+             + std::to_string(m.sector));
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Decode with every parser, through the non-throwing functions
+/// @return The first error, the samples of the generic parser in data
+std::error_code
+decode_all( const char* first, const char* last, const lms1xx::scan_data_configuration& cfg
+          , lms1xx::compact_scan& data)
+{
+  auto ec = std::error_code{};
+  auto res = std::error_code{};
+  const auto keep = [&]
+  {
+    if (ec and not res)
+    {
+      res = ec;
+    }
+  };
+
+  auto other = lms1xx::compact_scan{lms1xx::max_samples};
+  for (const auto p : {lms1xx::protocol::cola_a, lms1xx::protocol::cola_b})
+  {
+    lms1xx::layout_parser{cfg, p}.parse(first, last, other, ec);
+    keep();
+  }
+
+  const auto filter = lms1xx::scan_filter{0, 900000, 2, 0xF};
+  lms1xx::sector_reduction reduction{{{0, 450000}, {450000, 900000}}, nullptr};
+  lms1xx::parse_scan_data(first, last, other, {&filter, &reduction}, ec);
+  keep();
+
+  auto view = lms1xx::scan_view{};
+  view.reset(first, last, ec);
+  keep();
+  if (not ec)
+  {
+    for (const auto c : channels)
+    {
+      view.get(c, ec);
+      keep();
+    }
+  }
+
+  lms1xx::parse_scan_data(first, last, data, {}, ec);
+  keep();
+  return res;
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check that truncated telegrams are reported as invalid
+///
+/// CoLa-B telegrams have a length and a checksum, they are invalid as soon as a byte is missing.
+/// In CoLa-A, the fields which follow the samples (position, name, comment, timestamp) are
+/// optional: a telegram is only invalid if it stops before the end of the samples.
+void
+check_truncated(const telegram& t, const reference& expected)
+{
+  auto data = lms1xx::compact_scan{lms1xx::max_samples};
+  for (const auto bytes : {&t.bytes, &t.binary})
+  {
+    const auto binary = bytes == &t.binary;
+    const auto what = t.name + (binary ? " (CoLa-B)" : " (CoLa-A)") + " truncated at ";
+    const auto required = binary ? bytes->size() : expected.channels_end;
+    for (auto len = std::size_t{0}; len < bytes->size(); ++len)
+    {
+      // Most lengths in the middle of the samples are skipped, for the test to stay short.
+      if (len > 512 and len + 512 < bytes->size() and len % 67 > 2)
+      {
+        continue;
+      }
+      const auto first = bytes->data();
+      const auto last = first + len;
+      const auto ec = decode_all(first, last, t.configuration, data);
+      if (len < required)
+      {
+        check(ec == lms1xx::errc::invalid_telegram, what + std::to_string(len) + ": not reported");
+        if (len % 16 == 0)
+        {
+          try
+          {
+            lms1xx::parse_scan_data(first, last, data);
+            check(false, what + std::to_string(len) + ": not thrown");
+          }
+          catch (const lms1xx::invalid_telegram_error&)
+          {}
+        }
+      }
+      else if (not ec)
+      {
+        check_samples(expected, data, what + std::to_string(len));
+      }
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Check that garbage is reported as invalid, and that damaged telegrams don't crash
+void
+check_garbage(const std::vector<telegram>& telegrams)
+{
+  auto rng = std::mt19937{7};
+  auto data = lms1xx::compact_scan{lms1xx::max_samples};
+  const auto& cfg = telegrams.front().configuration;
+
+  // Random bytes, after a CoLa-A or a CoLa-B prefix or not.
+  const auto prefixes
+    = std::vector<std::string>{"", "\x02", "\x02sSN LMDscandata ", "\x02\x02\x02\x02"};
+  for (auto round = 0; round < 4000; ++round)
+  {
+    auto bytes = prefixes[rng() % prefixes.size()];
+    for (auto len = rng() % 300; len > 0; --len)
+    {
+      bytes += static_cast<char>(rng() % 256);
+    }
+    const auto ec = decode_all(bytes.data(), bytes.data() + bytes.size(), cfg, data);
+    check(ec == lms1xx::errc::invalid_telegram, "garbage not reported");
+  }
+
+  // Random fields after the header of a telegram.
+  const auto fields = std::vector<std::string>{ "0", "1", "2", "4", "FFFF", "10000", "DIST1"
+                                              , "RSSI2", "3F800000", "-1", "+5", "G", ""};
+  const auto header = telegrams.front().bytes.substr(0, 80);
+  for (auto round = 0; round < 4000; ++round)
+  {
+    auto bytes = header;
+    for (auto len = rng() % 40; len > 0; --len)
+    {
+      bytes += fields[rng() % fields.size()] + (rng() % 8 == 0 ? "  " : " ");
+    }
+    bytes += "\x03";
+    decode_all(bytes.data(), bytes.data() + bytes.size(), cfg, data);
+  }
+
+  // Telegrams with a damaged byte.
+  for (const auto& t : telegrams)
+  {
+    for (const auto original : {&t.bytes, &t.binary})
+    {
+      for (auto round = 0; round < 200; ++round)
+      {
+        auto bytes = *original;
+        bytes[rng() % bytes.size()] = static_cast<char>(rng() % 256);
+        decode_all(bytes.data(), bytes.data() + bytes.size(), t.configuration, data);
+      }
+    }
+  }
+
+  // A channel with more samples than the capacity of the scan.
+  const auto& t = telegrams.front();
+  auto small = lms1xx::compact_scan{100};
+  for (const auto bytes : {&t.bytes, &t.binary})
+  {
+    const auto first = bytes->data();
+    const auto last = first + bytes->size();
+    auto ec = std::error_code{};
+    lms1xx::parse_scan_data(first, last, small, {}, ec);
+    check(ec == lms1xx::errc::invalid_telegram, t.name + " overflowing channel not reported");
+    lms1xx::layout_parser{t.configuration, lms1xx::protocol::cola_b}.parse(first, last, small, ec);
+    check(ec == lms1xx::errc::invalid_telegram, t.name + " overflowing channel not reported");
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+/*------------------------------------------------------------------------------------------------*/
+
+int
+main(int argc, char** argv)
+{
+  const auto corpus_dir = std::string{argc > 1 ? argv[1] : LMS1XX_TEST_CORPUS};
+
+  try
+  {
+    check_kernels();
+
+    const auto telegrams = corpus::load(corpus_dir);
+    for (const auto& t : telegrams)
+    {
+      const auto expected = decode_reference(t.bytes);
+      check_parsers(t, *expected);
+      for (const auto& other : telegrams)
+      {
+        check_other_layout(t, *expected, other);
+      }
+      check_filters(t, *expected);
+      check_sectors(t, *expected);
+      check_truncated(t, *expected);
+    }
+    check_garbage(telegrams);
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Test failed: " << e.what() << '\n';
+    return 1;
+  }
+  std::cout << "All tests passed (hex kernel: " << lms1xx::hex::kernel_name() << ")\n";
+  return 0;
+}
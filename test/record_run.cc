@@ -0,0 +1,48 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+
+#include "lms1xx/lms1xx.hh"
+#include "lms1xx/recording.hh"
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 5)
+  {
+    std::cerr << "Usage: " << argv[0] << " host port file nb_scans\n";
+    return 1;
+  }
+
+  const auto nb_scans = std::strtoul(argv[4], nullptr, 10);
+
+  try
+  {
+    lms1xx::LMS1xx laser{argv[1], argv[2], boost::posix_time::seconds{30}};
+    laser.scan_continous(true);
+
+    lms1xx::recorder recorder{argv[3]};
+    std::unique_ptr<lms1xx::scan_data> data{new lms1xx::scan_data};
+    for (auto i = 0ul; i < nb_scans; ++i)
+    {
+      laser.get_data(*data);
+      recorder.record(*data);
+    }
+    recorder.close();
+    laser.scan_continous(false);
+
+    lms1xx::recording recording{argv[3]};
+    if (recording.size() != 0)
+    {
+      std::cout << recording.size() << " scans recorded over "
+                << (recording[recording.size() - 1].time() - recording[0].time()) / 1000
+                << " ms\n";
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "An error happened: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
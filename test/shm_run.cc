@@ -0,0 +1,99 @@
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "lms1xx/lms1xx.hh"
+#include "lms1xx/scan_publisher.hh"
+
+namespace /* unnamed */ {
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Publish the scans of a device until streaming stops
+void
+publish(const std::string& host, const std::string& port, const std::string& name)
+{
+  lms1xx::LMS1xx laser{host, port, boost::posix_time::seconds{30}};
+  laser.scan_continous(true);
+
+  lms1xx::scan_publisher publisher{name, 64};
+  std::atomic<bool> stopped{false};
+  laser.start_stream(lms1xx::publish_to(publisher), [&](std::exception_ptr){ stopped = true; });
+  while (not stopped)
+  {
+    std::this_thread::sleep_for(std::chrono::seconds{1});
+    std::cout << publisher.written() << " scans published\n";
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+/// @brief Read the scans of a publisher and report every second
+void
+subscribe(const std::string& name)
+{
+  lms1xx::scan_subscriber subscriber{name};
+  auto scans = 0ul;
+  auto samples = 0ul;
+  auto next_report = std::chrono::steady_clock::now() + std::chrono::seconds{1};
+  while (true)
+  {
+    if (const auto data = subscriber.try_acquire_read())
+    {
+      const auto nb_samples = data->dist_len1 + data->dist_len2 + data->rssi_len1 + data->rssi_len2;
+      if (subscriber.release_read())
+      {
+        ++scans;
+        samples += nb_samples;
+      }
+    }
+    else
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds{1});
+    }
+
+    if (std::chrono::steady_clock::now() >= next_report)
+    {
+      std::cout << scans << " scans/s, " << samples << " samples/s, " << subscriber.overruns()
+                << " overruns\n";
+      scans = 0;
+      samples = 0;
+      next_report += std::chrono::seconds{1};
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------------------------*/
+
+} // namespace unnamed
+
+int
+main(int argc, char** argv)
+{
+  if (argc != 2 and argc != 4)
+  {
+    std::cerr << "Usage: " << argv[0] << " host port name\n"
+              << "       " << argv[0] << " name\n";
+    return 1;
+  }
+
+  try
+  {
+    if (argc == 4)
+    {
+      publish(argv[1], argv[2], argv[3]);
+    }
+    else
+    {
+      subscribe(argv[1]);
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "An error happened: " << e.what() << '\n';
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,54 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "lms1xx/simulator.hh"
+
+int
+main(int argc, char** argv)
+{
+  if (argc < 2)
+  {
+    std::cerr << "Usage: " << argv[0]
+              << " nb_devices [first_port] [frequency (Hz)] [resolution (1/10000 degree)]\n";
+    return 1;
+  }
+
+  const auto nb_devices = std::atoi(argv[1]);
+  const auto first_port = argc > 2 ? std::atoi(argv[2]) : 0;
+  const auto frequency = argc > 3 ? std::atoi(argv[3]) : 50;
+  const auto resolution = argc > 4 ? std::atoi(argv[4]) : 5000;
+
+  try
+  {
+    auto devices = std::vector<std::unique_ptr<lms1xx::simulator>>{};
+    for (auto i = 0; i < nb_devices; ++i)
+    {
+      const auto port = first_port == 0 ? 0 : first_port + i;
+      devices.emplace_back(new lms1xx::simulator{static_cast<unsigned short>(port)});
+      devices.back()->set_scan_configuration({frequency * 100, resolution, -450000, 2250000});
+      std::cout << "Simulated device listening on 127.0.0.1:" << devices.back()->port() << '\n';
+    }
+
+    auto previous = std::size_t{0};
+    while (true)
+    {
+      std::this_thread::sleep_for(std::chrono::seconds{1});
+      auto sent = std::size_t{0};
+      for (const auto& device : devices)
+      {
+        sent += device->scans_sent();
+      }
+      std::cout << (sent - previous) << " scans/s\n";
+      previous = sent;
+    }
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "An error happened: " << e.what() << '\n';
+    return 1;
+  }
+}
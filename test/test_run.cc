@@ -1,6 +1,6 @@
 #include <chrono>
 #include <iostream>
-#include <thread>
+#include <system_error>
 
 #include "lms1xx/lms1xx.hh"
 
@@ -19,49 +19,52 @@ main()
   try
   {
     lms1xx::LMS1xx laser{"192.168.0.1", "2111", boost::posix_time::seconds{30}};
-    laser.login();
-
-    laser.set_scan_data_configuration(cc);
-
-    laser.start_measurements();
-
-    while (laser.status() != lms1xx::device_status::ready_for_measurement)
+    const auto report = laser.bring_up(cc);
+    const auto ms = [](std::chrono::nanoseconds d)
     {
-      std::cout << "Waiting for device\n";
-      std::this_thread::sleep_for(std::chrono::seconds{1});
-    }
-
-    laser.start_device();
-    laser.scan_continous(true);
+      return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+    std::cout << "Device started in " << ms(report.total) << " ms (configuration "
+              << ms(report.configuration) << " ms, ready " << ms(report.ready) << " ms after "
+              << report.status_polls << " polls, start " << ms(report.start) << " ms)\n";
 
+    auto data = lms1xx::scan_data{};
+    auto ec = std::error_code{};
     for (auto i = 0ul; i < 999; ++i)
     {
-      try
+      laser.get_data(data, ec);
+      if (ec == lms1xx::errc::invalid_telegram)
       {
-        const auto& data = laser.get_data();
-        // std::cout << data.dist_len1 << " " << data.rssi_len1 <<  '\n';
-
-        auto range = 0.0;
-        for (int i = 0; i < data.dist_len1; i++)
-        {
-          // scan_msg.ranges[i] = data.dist1[i] * 0.001;
-          // std::cout << data.dist1[i] * 0.001 << '\n';
-          range += data.dist1[i] * 0.001;
-        }
+        std::cerr << "Invalid telegram, retrying.";
+        continue;
+      }
+      if (ec == lms1xx::errc::timeout)
+      {
+        std::cout << "Connection lost after 30s\n";
+        return 0;
+      }
+      if (ec)
+      {
+        throw std::system_error{ec};
+      }
+      // std::cout << data.dist_len1 << " " << data.rssi_len1 <<  '\n';
 
-        auto inten = uint16_t{};
-        for (int i = 0; i < data.rssi_len1; i++)
-        {
-          // scan_msg.intensities[i] = data.rssi1[i];
-          // std::cout << data.rssi1[i] << '\n';
-          inten += data.rssi1[i];
-        }
-        std::cout << range << "  " << inten << std::endl;
+      auto range = 0.0;
+      for (int i = 0; i < data.dist_len1; i++)
+      {
+        // scan_msg.ranges[i] = data.dist1[i] * 0.001;
+        // std::cout << data.dist1[i] * 0.001 << '\n';
+        range += data.dist1[i] * 0.001;
       }
-      catch (const lms1xx::invalid_telegram_error&)
+
+      auto inten = uint16_t{};
+      for (int i = 0; i < data.rssi_len1; i++)
       {
-        std::cerr << "Invalid telegram, retrying.";
+        // scan_msg.intensities[i] = data.rssi1[i];
+        // std::cout << data.rssi1[i] << '\n';
+        inten += data.rssi1[i];
       }
+      std::cout << range << "  " << inten << std::endl;
     }
 
     laser.login();